@@ -37,7 +37,6 @@ static mmu_pte *pgtable = NULL;
 
 /* MMU operations (stolen from NewOS's stage2) */
 static int mmu_init(kernel_args_t *ka, uint32 *next_physaddr);
-static void mmu_map_page(uint32 virt_addr, uint32 phys_addr);
 
 /* ELF */
 static void load_elf_image(void *elf_data, uint32 *next_physaddr, addr_range_t *range, uint32 *entry_addr);
@@ -187,6 +186,12 @@ _start(uint32 memsize, void *ext_mem_block, uint32 ext_mem_count,
     kargs->arch_args.virt_pgdir = next_virtaddr;
     next_virtaddr += PAGE_SIZE;
 
+    /* time stamp counter frequency */
+    kargs->arch_args.tsc_time_cv_factor = calibrate_tsc();
+
+    /* detect and start other processors */
+    smp_boot(kargs, kentry, &next_physaddr, &next_virtaddr);
+
     /* store VESA VBE params in kargs (for more details refer to VBE standard) */
     if(in_vesa) {
         ModeInfoBlock_t *mode_info = (ModeInfoBlock_t *)(vesa_ptr + 0x200);
@@ -340,7 +345,6 @@ _start(uint32 memsize, void *ext_mem_block, uint32 ext_mem_count,
 #endif
 
     /* save remaining kernel args */
-    kargs->num_cpus = 1;
     kargs->cons_line = screenOffset / SCREEN_WIDTH;
     kargs->magic = KARGS_MAGIC;  /* magic field */
 
@@ -502,13 +506,24 @@ static int mmu_init(kernel_args_t *ka, uint32 *next_physaddr)
 /* can only map the 4 meg region right after KERNEL_BASE, may fix this later
  * if need arises.
 */
-static void mmu_map_page(uint32 virt_addr, uint32 phys_addr)
+static void mmu_map_page_flags(uint32 virt_addr, uint32 phys_addr, uint32 flags)
 {
     if(virt_addr < KERNEL_BASE || virt_addr >= (KERNEL_BASE + 4096*1024))
         panic("mmu_map_page: asked to map invalid page!\n");
 
     phys_addr &= ~(PAGE_SIZE-1);
-    pgtable[(virt_addr % (PAGE_SIZE * 1024)) / PAGE_SIZE].raw.dword0 = phys_addr | DEFAULT_PAGE_FLAGS;
+    pgtable[(virt_addr % (PAGE_SIZE * 1024)) / PAGE_SIZE].raw.dword0 = phys_addr | flags;
+}
+
+void mmu_map_page(uint32 virt_addr, uint32 phys_addr)
+{
+    mmu_map_page_flags(virt_addr, phys_addr, DEFAULT_PAGE_FLAGS);
+}
+
+/* map memory-mapped I/O page with caching disabled */
+void mmu_map_io_page(uint32 virt_addr, uint32 phys_addr)
+{
+    mmu_map_page_flags(virt_addr, phys_addr, IO_PAGE_FLAGS);
 }
 
 /* loads ELF image to next_physaddr and returns occupied virtual addresses range and
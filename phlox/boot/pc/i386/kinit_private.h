@@ -12,8 +12,25 @@
 /* address of bootfs image */
 #define BTFS_IMAGE ((void *)0x100000)
 
+/* SMP startup params */
+#define SMP_TRAMPOLINE_ADDR  0x9000  /* physical address of AP startup code (< 1Mb, page aligned) */
+#define SMP_AP_START_WAIT    100     /* AP startup wait time (in milliseconds) */
+
+/* Offsets of AP startup args (see struct smp_trampoline_args below) */
+#define SMP_TARGS_STARTED    0
+#define SMP_TARGS_PGDIR      4
+#define SMP_TARGS_KSTACK     8
+#define SMP_TARGS_KENTRY     12
+#define SMP_TARGS_KARGS      16
+#define SMP_TARGS_CPU        20
+#define SMP_TARGS_GDT        26
+#define SMP_TARGS_IDT        34
+
 /* MMU params */
 #define DEFAULT_PAGE_FLAGS (X86_PG_ATB_P | X86_PG_ATB_W)
+#define IO_PAGE_FLAGS      (DEFAULT_PAGE_FLAGS | X86_PG_ATB_PCD | X86_PG_ATB_PWT)
+
+#ifndef __ASSEMBLY__
 
 /* memory structure returned by int 0x15, ax 0xe820 */
 struct ext_mem_struct {
@@ -28,6 +45,88 @@ struct ext_mem_struct {
     uint64 filler;
 } _PACKED;
 
+/* MP Floating Pointer Structure (Intel MP Spec. 1.4) */
+struct mp_flt_struct {
+    uint32 signature;      /* "_MP_" */
+    uint32 mpc;            /* physical address of MP configuration table */
+    uint8  mpc_len;        /* length of this struct in 16 bytes units */
+    uint8  mp_rev;         /* MP specification revision */
+    uint8  checksum;       /* checksum of this struct */
+    uint8  mp_feature1;    /* nonzero if default configuration used */
+    uint8  mp_feature2;    /* IMCR presence bit */
+    uint8  mp_feature3;    /* reserved */
+    uint8  mp_feature4;    /* reserved */
+    uint8  mp_feature5;    /* reserved */
+} _PACKED;
+
+/* MP Configuration Table header */
+struct mp_config_table {
+    uint32 signature;      /* "PCMP" */
+    uint16 base_table_len; /* length of base table including header */
+    uint8  spec_rev;       /* MP specification revision */
+    uint8  checksum;       /* checksum of base table */
+    char   oem[8];         /* OEM id */
+    char   product[12];    /* product id */
+    uint32 oem_table_ptr;  /* OEM table pointer */
+    uint16 oem_table_len;  /* OEM table length */
+    uint16 num_entries;    /* entries count in base table */
+    uint32 apic;           /* physical address of local APICs */
+    uint16 ext_table_len;  /* extended table length */
+    uint8  ext_table_checksum;
+    uint8  reserved;
+} _PACKED;
+
+/* Args passed to AP startup code. Must be in sync with SMP_TARGS_* offsets. */
+struct smp_trampoline_args {
+    volatile uint32 started;  /* set by AP when it leaves trampoline */
+    uint32 pgdir;             /* physical address of page directory */
+    uint32 kstack;            /* kernel stack top (virtual) */
+    uint32 kentry;            /* kernel entry point */
+    uint32 kargs;             /* kernel args pointer */
+    uint32 cpu;               /* logical number of started cpu */
+    uint16 gdt_pad;
+    uint16 gdt_limit;         /* GDT pointer for lgdt */
+    uint32 gdt_base;
+    uint16 idt_pad;
+    uint16 idt_limit;         /* IDT pointer for lidt */
+    uint32 idt_base;
+} _PACKED;
+
+/* MP Configuration Table entry types */
+#define MP_BASE_PROCESSOR  0  /* 20 bytes length */
+#define MP_BASE_BUS        1  /* 8 bytes length  */
+#define MP_BASE_IO_APIC    2  /* 8 bytes length  */
+#define MP_BASE_IO_INT     3  /* 8 bytes length  */
+#define MP_BASE_LOCAL_INT  4  /* 8 bytes length  */
+
+/* Processor entry */
+struct mp_base_processor {
+    uint8  type;           /* MP_BASE_PROCESSOR */
+    uint8  apic_id;        /* local APIC id */
+    uint8  apic_version;   /* local APIC version */
+    uint8  cpu_flags;      /* bit 0 - enabled, bit 1 - bootstrap processor */
+    uint32 signature;      /* stepping, model and family */
+    uint32 features;       /* CPUID feature flags */
+    uint32 reserved[2];
+} _PACKED;
+
+/* Processor entry flags */
+#define MP_CPU_ENABLED  0x01
+#define MP_CPU_BSP      0x02
+
+/* I/O APIC entry */
+struct mp_base_ioapic {
+    uint8  type;           /* MP_BASE_IO_APIC */
+    uint8  ioapic_id;      /* I/O APIC id */
+    uint8  ioapic_version; /* I/O APIC version */
+    uint8  ioapic_flags;   /* bit 0 - enabled */
+    uint32 addr;           /* physical address */
+} _PACKED;
+
+/* MP structures signatures */
+#define MP_FLT_SIGNATURE  '_PM_'  /* "_MP_" */
+#define MP_CTH_SIGNATURE  'PMCP'  /* "PCMP" */
+
 extern void _start(uint32 memsize, void *ext_mem_block, uint32 ext_mem_count,
                    int in_vesa, uint32 vesa_ptr, uint32 console_ptr);
 extern void clearscreen(void);
@@ -35,4 +134,22 @@ extern int puts(const char *str);
 extern int dprintf(const char *fmt, ...);
 extern int panic(const char *fmt, ...);
 
+/* Busy wait delays and time stamp counter calibration (see timing.c) */
+extern void pit_delay_usec(uint32 usec);
+extern void pit_delay_msec(uint32 msec);
+extern uint32 calibrate_tsc(void);
+
+/* Detects additional processors and starts them (see smp_boot.c) */
+extern void smp_boot(kernel_args_t *ka, uint32 kentry, uint32 *next_physaddr, uint32 *next_virtaddr);
+/* Map pages into kernel's virtual space (see kinit.c) */
+extern void mmu_map_page(uint32 virt_addr, uint32 phys_addr);
+extern void mmu_map_io_page(uint32 virt_addr, uint32 phys_addr);
+
+/* AP startup code (see smp_trampoline.S) */
+extern void smp_trampoline(void);
+extern void smp_trampoline_end(void);
+extern uint32 smp_trampoline_args;
+
+#endif /* #ifndef __ASSEMBLY__ */
+
 #endif
@@ -0,0 +1,337 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <string.h>
+#include <arch/cpu.h>
+#include <arch/arch_bits.h>
+#include <arch/arch_data.h>
+#include <phlox/types.h>
+#include <phlox/kernel.h>
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+#include <phlox/arch/i386/processor.h>
+#include "kinit_private.h"
+
+/* controls additional info output */
+#define PRINT_SMP_SUMMARY 1
+
+/* STARTUP IPI vector selects trampoline page */
+#define SMP_STARTUP_VECTOR (SMP_TRAMPOLINE_ADDR >> 12)
+
+/* BIOS Data Area word with segment of Extended BIOS Data Area */
+static uint16 * volatile bda_ebda_segment = (uint16 *)0x40e;
+
+/* APIC virtual address (valid only after mapping) */
+static uint32 *apic = NULL;
+
+/* MP tables lookup and parsing */
+static struct mp_flt_struct *smp_find_mp_flt(void);
+static struct mp_flt_struct *smp_scan_mp_flt(uint32 base, uint32 limit);
+static int smp_parse_config(kernel_args_t *ka, struct mp_config_table *mpc);
+
+/* APIC routines */
+static uint32 smp_calibrate_apic_timer(void);
+static void smp_send_ipi(uint32 apic_id, uint32 flags);
+static bool smp_start_ap(kernel_args_t *ka, struct smp_trampoline_args *args, uint32 cpu);
+
+
+/*
+ * Detects application processors using Intel MP Specification tables,
+ * maps APIC into kernel space, calibrates APIC timer and starts all
+ * enabled APs. Each started AP jumps into kernel entry and waits there
+ * until bootstrap processor completes its part of kernel initialization.
+ * If only one processor found, APIC is left untouched.
+ */
+void smp_boot(kernel_args_t *ka, uint32 kentry, uint32 *next_physaddr, uint32 *next_virtaddr)
+{
+    struct smp_trampoline_args *args;
+    struct mp_flt_struct *mpf;
+    uint32 num_found, i, tmp;
+
+    /* bootstrap processor is always here */
+    ka->num_cpus = 1;
+
+    /* look for MP floating pointer */
+    mpf = smp_find_mp_flt();
+    if(mpf == NULL) {
+        dprintf("smp: MP tables not found, uniprocessor mode.\n");
+        return;
+    }
+
+    /* only explicit configuration tables are supported */
+    if(mpf->mp_feature1 != 0 || mpf->mpc == 0) {
+        dprintf("smp: default MP configuration, uniprocessor mode.\n");
+        return;
+    }
+
+    /* fill cpu info from MP configuration table */
+    num_found = smp_parse_config(ka, (struct mp_config_table *)mpf->mpc);
+    if(num_found < 2) {
+        dprintf("smp: single processor found, uniprocessor mode.\n");
+        return;
+    }
+
+    /* map APIC and IO APIC into kernel space */
+    mmu_map_io_page(*next_virtaddr, ka->arch_args.apic_phys);
+    ka->arch_args.apic = (uint32 *)*next_virtaddr;
+    *next_virtaddr += PAGE_SIZE;
+    if(ka->arch_args.ioapic_phys) {
+        mmu_map_io_page(*next_virtaddr, ka->arch_args.ioapic_phys);
+        ka->arch_args.ioapic = (uint32 *)*next_virtaddr;
+        *next_virtaddr += PAGE_SIZE;
+    }
+    apic = ka->arch_args.apic;
+
+    /* make bootstrap processor the cpu number 0 */
+    tmp = (apic_read(apic, APIC_ID) >> APIC_ID_SHIFT) & APIC_ID_MASK;
+    for(i = 0; i < num_found; i++) {
+        if(ka->arch_args.cpu_apic_id[i] == tmp) {
+            uint32 ver = ka->arch_args.cpu_apic_version[i];
+            ka->arch_args.cpu_apic_id[i]      = ka->arch_args.cpu_apic_id[0];
+            ka->arch_args.cpu_apic_version[i] = ka->arch_args.cpu_apic_version[0];
+            ka->arch_args.cpu_apic_id[0]      = tmp;
+            ka->arch_args.cpu_apic_version[0] = ver;
+            break;
+        }
+    }
+
+    /* software enable local APIC of bootstrap processor */
+    tmp = apic_read(apic, APIC_SVR) & ~APIC_SVR_VECTOR_MASK;
+    apic_write(apic, APIC_SVR, tmp | APIC_SVR_ENABLE | 0xff);
+
+    /* get APIC timer frequency */
+    ka->arch_args.apic_time_cv_factor = smp_calibrate_apic_timer();
+
+    /* copy startup code into low memory */
+    memcpy((void *)SMP_TRAMPOLINE_ADDR, (void *)&smp_trampoline,
+           (uint32)&smp_trampoline_end - (uint32)&smp_trampoline);
+    args = (struct smp_trampoline_args *)((uint32)&smp_trampoline_args -
+                                          (uint32)&smp_trampoline +
+                                          SMP_TRAMPOLINE_ADDR);
+
+    /* fill common startup args */
+    args->pgdir     = ka->arch_args.phys_pgdir;
+    args->kentry    = kentry;
+    args->kargs     = (uint32)ka;
+    args->gdt_limit = MAX_GDT_LIMIT-1;
+    args->gdt_base  = ka->arch_args.virt_gdt;
+    args->idt_limit = MAX_IDT_LIMIT-1;
+    args->idt_base  = ka->arch_args.virt_idt;
+
+    /* start application processors one by one */
+    for(i = 1; i < num_found; i++) {
+        uint32 cpu = ka->num_cpus;
+
+        /* slots of failed processors are reused */
+        ka->arch_args.cpu_apic_id[cpu]      = ka->arch_args.cpu_apic_id[i];
+        ka->arch_args.cpu_apic_version[cpu] = ka->arch_args.cpu_apic_version[i];
+
+        /* allocate kernel stack aligned to its size boundary,
+         * that is important for threading model.
+         */
+        if(ka->phys_cpu_kstack[cpu].size == 0) {
+            *next_virtaddr = ROUNDUP(*next_virtaddr, KERNEL_STACK_SIZE*PAGE_SIZE);
+            ka->phys_cpu_kstack[cpu].start = *next_physaddr;
+            ka->virt_cpu_kstack[cpu].start = *next_virtaddr;
+            for(tmp = 0; tmp < KERNEL_STACK_SIZE; tmp++) {
+                mmu_map_page(*next_virtaddr, *next_physaddr);
+                *next_physaddr += PAGE_SIZE;
+                *next_virtaddr += PAGE_SIZE;
+            }
+            ka->phys_cpu_kstack[cpu].size = KERNEL_STACK_SIZE*PAGE_SIZE;
+            ka->virt_cpu_kstack[cpu].size = KERNEL_STACK_SIZE*PAGE_SIZE;
+        }
+
+        if(smp_start_ap(ka, args, cpu))
+            ka->num_cpus++;
+        else
+            dprintf("smp: cpu with APIC id %d failed to start.\n",
+                    ka->arch_args.cpu_apic_id[cpu]);
+    }
+
+    /* unused stack of the last failed cpu must not be reported */
+    if(ka->num_cpus < SYSCFG_MAX_CPUS && ka->phys_cpu_kstack[ka->num_cpus].size) {
+        ka->phys_cpu_kstack[ka->num_cpus].size = 0;
+        ka->virt_cpu_kstack[ka->num_cpus].size = 0;
+    }
+
+#if PRINT_SMP_SUMMARY
+    dprintf("smp: %d processors started, APIC at 0x%08X, IO APIC at 0x%08X\n",
+            ka->num_cpus, ka->arch_args.apic_phys, ka->arch_args.ioapic_phys);
+    dprintf("smp: APIC timer runs at %d ticks per second\n",
+            ka->arch_args.apic_time_cv_factor);
+#endif
+}
+
+/* search MP floating pointer at locations defined by MP specification */
+static struct mp_flt_struct *smp_find_mp_flt(void)
+{
+    struct mp_flt_struct *mpf;
+    uint32 ebda;
+
+    /* first kilobyte of Extended BIOS Data Area */
+    ebda = (uint32)(*bda_ebda_segment) << 4;
+    if(ebda) {
+        mpf = smp_scan_mp_flt(ebda, ebda + 0x400);
+        if(mpf) return mpf;
+    }
+
+    /* last kilobyte of base memory */
+    mpf = smp_scan_mp_flt(0x9fc00, 0xa0000);
+    if(mpf) return mpf;
+
+    /* BIOS ROM */
+    return smp_scan_mp_flt(0xf0000, 0x100000);
+}
+
+/* scan memory range for MP floating pointer */
+static struct mp_flt_struct *smp_scan_mp_flt(uint32 base, uint32 limit)
+{
+    struct mp_flt_struct *mpf;
+    uint8 *p, sum;
+    uint32 i;
+
+    for(; base + sizeof(struct mp_flt_struct) <= limit; base += 16) {
+        mpf = (struct mp_flt_struct *)base;
+        if(mpf->signature != MP_FLT_SIGNATURE)
+            continue;
+
+        /* verify checksum */
+        p = (uint8 *)mpf;
+        for(sum = 0, i = 0; i < mpf->mpc_len * 16; i++)
+            sum += p[i];
+        if(sum == 0)
+            return mpf;
+    }
+
+    return NULL;
+}
+
+/* parse MP configuration table, returns number of found processors */
+static int smp_parse_config(kernel_args_t *ka, struct mp_config_table *mpc)
+{
+    uint8 *ptr, *p, sum;
+    uint32 i, num_cpus = 0;
+
+    if(mpc->signature != MP_CTH_SIGNATURE)
+        return 0;
+
+    /* verify checksum */
+    p = (uint8 *)mpc;
+    for(sum = 0, i = 0; i < mpc->base_table_len; i++)
+        sum += p[i];
+    if(sum != 0)
+        return 0;
+
+    ka->arch_args.apic_phys = mpc->apic ? mpc->apic : APIC_DEFAULT_PHYS_BASE;
+
+    /* walk through base table entries */
+    ptr = (uint8 *)(mpc + 1);
+    for(i = 0; i < mpc->num_entries; i++) {
+        switch(*ptr) {
+            case MP_BASE_PROCESSOR:
+            {
+                struct mp_base_processor *cpu = (struct mp_base_processor *)ptr;
+
+                if((cpu->cpu_flags & MP_CPU_ENABLED) && num_cpus < SYSCFG_MAX_CPUS) {
+                    ka->arch_args.cpu_apic_id[num_cpus]      = cpu->apic_id;
+                    ka->arch_args.cpu_apic_version[num_cpus] = cpu->apic_version;
+                    num_cpus++;
+                }
+                ptr += sizeof(struct mp_base_processor);
+                break;
+            }
+
+            case MP_BASE_IO_APIC:
+            {
+                struct mp_base_ioapic *io = (struct mp_base_ioapic *)ptr;
+
+                /* only first one is used */
+                if(ka->arch_args.ioapic_phys == 0)
+                    ka->arch_args.ioapic_phys = io->addr;
+                ptr += sizeof(struct mp_base_ioapic);
+                break;
+            }
+
+            case MP_BASE_BUS:
+            case MP_BASE_IO_INT:
+            case MP_BASE_LOCAL_INT:
+                ptr += 8;
+                break;
+
+            default:
+                /* unknown entry, stop parsing */
+                return num_cpus;
+        }
+    }
+
+    return num_cpus;
+}
+
+/* returns APIC timer ticks per second */
+static uint32 smp_calibrate_apic_timer(void)
+{
+    uint32 elapsed;
+
+    /* one-shot masked timer */
+    apic_write(apic, APIC_TIMER_DCR, APIC_TIMER_DIV_DEFAULT);
+    apic_write(apic, APIC_LVT_TIMER, APIC_LVT_MASKED | 0xff);
+
+    /* count down during 10 msec */
+    apic_write(apic, APIC_TIMER_ICR, 0xffffffff);
+    pit_delay_msec(10);
+    elapsed = 0xffffffff - apic_read(apic, APIC_TIMER_CCR);
+
+    /* stop timer */
+    apic_write(apic, APIC_TIMER_ICR, 0);
+
+    return elapsed * 100;
+}
+
+/* send interprocessor interrupt to specified APIC and wait until it delivered */
+static void smp_send_ipi(uint32 apic_id, uint32 flags)
+{
+    uint32 tmp;
+
+    tmp = apic_read(apic, APIC_ICR_HIGH) & 0x00ffffff;
+    apic_write(apic, APIC_ICR_HIGH, tmp | (apic_id << APIC_ICR_DEST_SHIFT));
+
+    tmp = apic_read(apic, APIC_ICR_LOW) & 0xfff32000;
+    apic_write(apic, APIC_ICR_LOW, tmp | flags);
+
+    while(apic_read(apic, APIC_ICR_LOW) & APIC_ICR_DS_PENDING)
+        ;
+}
+
+/* start application processor using INIT-SIPI-SIPI sequence */
+static bool smp_start_ap(kernel_args_t *ka, struct smp_trampoline_args *args, uint32 cpu)
+{
+    uint32 apic_id = ka->arch_args.cpu_apic_id[cpu];
+    uint32 i;
+
+    /* per-cpu startup args */
+    args->started = 0;
+    args->kstack  = ka->virt_cpu_kstack[cpu].start + ka->virt_cpu_kstack[cpu].size;
+    args->cpu     = cpu;
+
+    /* INIT: assert and deassert */
+    smp_send_ipi(apic_id, APIC_ICR_TRIGGER_LEVEL | APIC_ICR_LEVEL_ASSERT | APIC_ICR_DM_INIT);
+    smp_send_ipi(apic_id, APIC_ICR_TRIGGER_LEVEL | APIC_ICR_DM_INIT);
+    pit_delay_msec(10);
+
+    /* integrated APICs require STARTUP IPIs, 82489DX ones start on INIT */
+    if(ka->arch_args.cpu_apic_version[cpu] & 0xf0) {
+        for(i = 0; i < 2; i++) {
+            apic_write(apic, APIC_ESR, 0);
+            smp_send_ipi(apic_id, APIC_ICR_DM_STARTUP | SMP_STARTUP_VECTOR);
+            pit_delay_usec(200);
+        }
+    }
+
+    /* wait for AP */
+    for(i = 0; i < SMP_AP_START_WAIT && !args->started; i++)
+        pit_delay_msec(1);
+
+    return (args->started != 0);
+}
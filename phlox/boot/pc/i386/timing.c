@@ -0,0 +1,91 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <arch/cpu.h>
+#include <arch/arch_bits.h>
+#include <arch/arch_data.h>
+#include <phlox/types.h>
+#include <phlox/kernel.h>
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+#include <phlox/arch/i386/processor.h>
+#include "kinit_private.h"
+
+/* PIT is used for delays before kernel gets its own timer */
+#define PIT_CHANNEL2_PORT  0x42
+#define PIT_CONTROL_PORT   0x43
+#define PIT_GATE_PORT      0x61
+#define PIT_TICKS_PER_MSEC 1193   /* 1193182 Hz */
+#define PIT_MAX_DELAY_MSEC 50     /* max delay at once (counter is 16-bit) */
+
+/* TSC calibration period */
+#define TSC_CALIBRATION_MSEC 10
+
+/* EFLAGS bit showing CPUID instruction support */
+#define EFLAGS_ID  0x00200000
+
+
+/* busy wait using PIT channel 2 */
+void pit_delay_usec(uint32 usec)
+{
+    uint32 count = usec * PIT_TICKS_PER_MSEC / 1000;
+
+    if(count == 0) count = 1;
+
+    /* gate low, speaker off */
+    out8(PIT_GATE_PORT, (in8(PIT_GATE_PORT) & ~0x03));
+    /* channel 2, lobyte/hibyte, mode 0 (interrupt on terminal count) */
+    out8(PIT_CONTROL_PORT, 0xb0);
+    out8(PIT_CHANNEL2_PORT, count & 0xff);
+    out8(PIT_CHANNEL2_PORT, (count >> 8) & 0xff);
+    /* gate high starts counting */
+    out8(PIT_GATE_PORT, (in8(PIT_GATE_PORT) & ~0x02) | 0x01);
+
+    /* wait for output goes high */
+    while(!(in8(PIT_GATE_PORT) & 0x20))
+        ;
+}
+
+void pit_delay_msec(uint32 msec)
+{
+    while(msec > PIT_MAX_DELAY_MSEC) {
+        pit_delay_usec(PIT_MAX_DELAY_MSEC * 1000);
+        msec -= PIT_MAX_DELAY_MSEC;
+    }
+    pit_delay_usec(msec * 1000);
+}
+
+/* returns true if processor has time stamp counter */
+static bool tsc_supported(void)
+{
+    uint32 f1, f2, eax, ebx, ecx, edx;
+
+    /* CPUID is supported if ID flag may be changed */
+    asm volatile("pushfl; popl %0; movl %0, %1; xorl %2, %0;"
+                 "pushl %0; popfl; pushfl; popl %0; pushl %1; popfl"
+                 : "=&r" (f1), "=&r" (f2) : "i" (EFLAGS_ID));
+    if(!((f1 ^ f2) & EFLAGS_ID))
+        return false;
+
+    /* check features */
+    asm volatile("cpuid" : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx) : "a" (1));
+
+    return (edx & X86_CPUID_TSC) != 0;
+}
+
+/* returns time stamp counter ticks per millisecond, or 0 if no TSC */
+uint32 calibrate_tsc(void)
+{
+    uint32 start, end, hi;
+
+    if(!tsc_supported())
+        return 0;
+
+    /* low dword is enough for short calibration period */
+    asm volatile("rdtsc" : "=a" (start), "=d" (hi));
+    pit_delay_msec(TSC_CALIBRATION_MSEC);
+    asm volatile("rdtsc" : "=a" (end), "=d" (hi));
+
+    return (end - start) / TSC_CALIBRATION_MSEC;
+}
@@ -39,6 +39,33 @@ ulong __syscall4(ulong sys_no, ulong arg0, ulong arg1, ulong arg2, ulong arg3);
 #ifndef INVALID_PROCESSID
 #  define INVALID_PROCESSID ((proc_id)0)   /* Invalid process ID */
 #endif
+#ifndef _THREAD_TIMES_T_DEFINED
+#define _THREAD_TIMES_T_DEFINED
+/* Thread and process execution times (in microseconds) */
+typedef struct {
+    bigtime_t thread_kernel_time;   /* Thread kernel-side time */
+    bigtime_t thread_user_time;     /* Thread user-side time */
+    bigtime_t process_kernel_time;  /* Process kernel-side time */
+    bigtime_t process_user_time;    /* Process user-side time */
+} thread_times_t;
+#endif
+#ifndef _TIME_PAGE_T_DEFINED
+#define _TIME_PAGE_T_DEFINED
+/* Shared time page. Updated by kernel and mapped read-only into
+ * each user address space. Fields are consistent if sequence
+ * was even and did not change while reading them.
+ */
+typedef struct {
+    volatile unsigned seq;    /* update sequence, odd while updating */
+    unsigned cycles_khz;      /* cycles counter frequency in kHz (0 if not used) */
+    bigtime_t cycles_base;    /* cycles counter value at system boot */
+    bigtime_t ticks;          /* timer ticks since system boot */
+    bigtime_t nsec_per_tick;  /* timer tick length in nanoseconds */
+} time_page_t;
+#endif
+#ifndef USER_TIME_PAGE_BASE
+#  define USER_TIME_PAGE_BASE 0xBFFFD000  /* Shared time page address */
+#endif
 
 
 /* NULL system call  */
@@ -182,6 +209,118 @@ void* sys_virtmem_alloc(ulong size);
 */
 status_t sys_virtmem_free(void *ptr);
 
+/*
+ * Get thread and its process execution times
+ *
+ * Arguments:
+ *   tid    - thread id (0 for current thread);
+ *   times  - returned times.
+*/
+status_t sys_thread_times(thread_id tid, thread_times_t *times);
+
+/*
+ * Set thread scheduling class
+ *
+ * Arguments:
+ *   tid          - thread id (0 for current thread);
+ *   sched_class  - scheduling class;
+ *   rt_prio      - real-time priority (0-31, higher is more urgent).
+*/
+status_t sys_thread_set_sched(thread_id tid, int sched_class, int rt_prio);
+
+/* Scheduling classes for sys_thread_set_sched() routine */
+enum {
+    SYS_SCHED_NORMAL = 0,  /* Dynamic priorities */
+    SYS_SCHED_FIFO   = 1,  /* Real-time first in, first out */
+    SYS_SCHED_RR     = 2   /* Real-time round-robin */
+};
+
+/*
+ * Block current thread while word keeps expected value
+ *
+ * Arguments:
+ *   addr          - address of the word;
+ *   val           - expected value;
+ *   timeout_msec  - timeout in milliseconds (0 to wait forever).
+*/
+status_t sys_futex_wait(volatile int *addr, int val, unsigned timeout_msec);
+
+/*
+ * Wake up threads blocked on word
+ *
+ * Arguments:
+ *   addr   - address of the word;
+ *   count  - maximum count of threads to wake up.
+ *
+ * Returns count of threads woken up.
+*/
+int sys_futex_wake(volatile int *addr, unsigned count);
+
+/*
+ * Count down by one any of semaphores
+ *
+ * Arguments:
+ *   ids           - semaphores ids;
+ *   count         - semaphores count (up to 16);
+ *   timeout_msec  - timeout if specified in flags;
+ *   flags         - same flags as for sys_sem_down().
+ *
+ * Returns index of semaphore counted down or negative error code.
+*/
+int sys_sem_down_any(const sem_id *ids, unsigned count, unsigned timeout_msec, flags_t flags);
+
+/*
+ * Count one semaphore up by one and then count down another one by one.
+ * Thread woken up by count up runs next on current CPU.
+ *
+ * Arguments:
+ *   up_id         - semaphore to count up;
+ *   down_id       - semaphore to count down;
+ *   timeout_msec  - timeout if specified in flags;
+ *   flags         - same flags as for sys_sem_down().
+*/
+status_t sys_sem_up_and_down(sem_id up_id, sem_id down_id, unsigned timeout_msec, flags_t flags);
+
+/*
+ * Get time since system booted up
+ *
+ * Arguments:
+ *   nsec - returned nanoseconds count.
+*/
+status_t sys_system_time(bigtime_t *nsec);
+
+/*
+ * Put thread to sleep with high resolution
+ *
+ * Arguments:
+ *   usec - microseconds to sleep.
+*/
+void sys_thread_usleep(unsigned usec);
+
+/*
+ * Set thread timer slack. Thread sleeps may last longer by up to
+ * slack time, so they are coalesced with other timer events.
+ *
+ * Arguments:
+ *   tid   - thread id (0 for current thread);
+ *   usec  - slack in microseconds.
+*/
+status_t sys_thread_set_timer_slack(thread_id tid, unsigned usec);
+
+/*
+ * Print statistics of most contended kernel spinlocks into kernel
+ * log. Available to system services if kernel was built with
+ * spinlocks statistics, ERR_SCL_NOT_IMPLEMENTED is returned otherwise.
+ *
+ * Arguments:
+ *   count  - maximum count of locks to print;
+ *   flags  - SYS_SPIN_STATS_RESET to reset statistics after printing.
+*/
+status_t sys_spin_stats(unsigned count, flags_t flags);
+
+/* Flags for sys_spin_stats() routine */
+#define SYS_SPIN_STATS_RESET  0x1
+
 
 #ifdef __cplusplus
 }
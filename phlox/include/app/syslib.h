@@ -35,6 +35,11 @@ int klog_printf(const char *fmt, ...);
 */
 status_t service_load(const char *path);
 
+/*
+ * Get nanoseconds since system booted up
+*/
+bigtime_t system_time(void);
+
 /*
  * Suspend execution of current thread
 */
@@ -89,6 +94,27 @@ status_t semaphore_try_down(sem_id id, unsigned count);
 */
 status_t semaphore_down_timeout(sem_id id, unsigned count, unsigned timeout_msec);
 
+/*
+ * Count down by one any of semaphores.
+ * Returns index of semaphore counted down or negative error code.
+ *
+ * Arguments:
+ *   ids    - semaphores ids;
+ *   count  - semaphores count.
+*/
+int semaphore_down_any(const sem_id *ids, unsigned count);
+
+/*
+ * Count down by one any of semaphores with timeout.
+ * Returns index of semaphore counted down or negative error code.
+ *
+ * Arguments:
+ *   ids           - semaphores ids;
+ *   count         - semaphores count;
+ *   timeout_msec  - timeout in milliseconds.
+*/
+int semaphore_down_any_timeout(const sem_id *ids, unsigned count, unsigned timeout_msec);
+
 /*
  * Semaphore count up
  *
@@ -98,6 +124,17 @@ status_t semaphore_down_timeout(sem_id id, unsigned count, unsigned timeout_msec
 */
 status_t semaphore_up(sem_id id, unsigned count);
 
+/*
+ * Count one semaphore up by one and wait for another one.
+ * Thread woken up by count up runs next, so synchronous
+ * request and reply costs single context switch.
+ *
+ * Arguments:
+ *   up_id    - semaphore to count up;
+ *   down_id  - semaphore to count down.
+*/
+status_t semaphore_up_and_down(sem_id up_id, sem_id down_id);
+
 /*
  * Get public semaphore by its name
  *
@@ -106,6 +143,160 @@ status_t semaphore_up(sem_id id, unsigned count);
 */
 sem_id semaphore_get_by_name(const char *name);
 
+/*
+ * Atomically writes set_to to *a if *a is equal to test_val.
+ * Returns non-zero if *a was changed.
+*/
+int atomic_cmpxchg(volatile int *a, int set_to, int test_val);
+
+/*
+ * Atomically adds v to *a and returns previous value of *a.
+*/
+int atomic_fetch_add(volatile int *a, int v);
+
+/*
+ * Returns current value of processor cycles counter.
+*/
+bigtime_t read_cycles_counter(void);
+
+/* User space semaphore.
+ * Uncontended count down and count up are done without entering
+ * the kernel, it is entered only to block or wake up threads.
+ * Semaphore is private to process, it must be in process memory.
+ */
+typedef struct {
+    volatile int count;    /* current count, never negative */
+    volatile int waiters;  /* threads blocked or going to block */
+} usem_t;
+
+/*
+ * Init user space semaphore
+ *
+ * Arguments:
+ *   sem         - semaphore;
+ *   init_count  - initial count.
+*/
+void usem_init(usem_t *sem, unsigned init_count);
+
+/*
+ * User space semaphore count down
+ *
+ * Arguments:
+ *   sem    - semaphore.
+*/
+status_t usem_down(usem_t *sem);
+
+/*
+ * Try to count down user space semaphore
+ *
+ * Arguments:
+ *   sem    - semaphore.
+*/
+status_t usem_try_down(usem_t *sem);
+
+/*
+ * User space semaphore count down with timeout
+ *
+ * Arguments:
+ *   sem           - semaphore;
+ *   timeout_msec  - timeout in milliseconds.
+*/
+status_t usem_down_timeout(usem_t *sem, unsigned timeout_msec);
+
+/*
+ * User space semaphore count up
+ *
+ * Arguments:
+ *   sem    - semaphore;
+ *   count  - value to count up.
+*/
+status_t usem_up(usem_t *sem, unsigned count);
+
+/* User space condition variable.
+ * Used together with user space semaphore initialized
+ * with count 1 as mutex.
+ */
+typedef struct {
+    volatile int seq;      /* signals sequence number */
+    volatile int waiters;  /* threads blocked or going to block */
+} ucond_t;
+
+/*
+ * Init user space condition variable
+*/
+void ucond_init(ucond_t *cond);
+
+/*
+ * Release mutex, wait for signal and acquire mutex back
+ *
+ * Arguments:
+ *   cond  - condition variable;
+ *   mtx   - semaphore used as mutex, must be held by caller.
+*/
+status_t ucond_wait(ucond_t *cond, usem_t *mtx);
+
+/*
+ * Same as above, but with timeout. Returns ERR_CND_TIMEOUT
+ * if timeout expired. Mutex is acquired back anyway.
+ *
+ * Arguments:
+ *   cond          - condition variable;
+ *   mtx           - semaphore used as mutex, must be held by caller;
+ *   timeout_msec  - timeout in milliseconds.
+*/
+status_t ucond_wait_timeout(ucond_t *cond, usem_t *mtx, unsigned timeout_msec);
+
+/*
+ * Wake up single thread waiting on condition variable
+*/
+status_t ucond_signal(ucond_t *cond);
+
+/*
+ * Wake up all threads waiting on condition variable
+*/
+status_t ucond_broadcast(ucond_t *cond);
+
+/* User space event.
+ * Set manual-reset event releases all waiters and stays set,
+ * auto-reset event releases single waiter and resets.
+ */
+typedef struct {
+    volatile int state;    /* 1 if set */
+    volatile int waiters;  /* threads blocked or going to block */
+    int          manual;   /* manual-reset event */
+} uevent_t;
+
+/*
+ * Init user space event
+ *
+ * Arguments:
+ *   ev            - event;
+ *   manual_reset  - non-zero for manual-reset event;
+ *   init_state    - non-zero if event is initially set.
+*/
+void uevent_init(uevent_t *ev, int manual_reset, int init_state);
+
+/*
+ * Wait until event is set
+*/
+status_t uevent_wait(uevent_t *ev);
+
+/*
+ * Wait until event is set with timeout. Returns ERR_CND_TIMEOUT
+ * if timeout expired.
+*/
+status_t uevent_wait_timeout(uevent_t *ev, unsigned timeout_msec);
+
+/*
+ * Set event
+*/
+status_t uevent_set(uevent_t *ev);
+
+/*
+ * Reset event
+*/
+void uevent_reset(uevent_t *ev);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,75 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_ARCH_I386_APIC_BITS_H_
+#define _PHLOX_ARCH_I386_APIC_BITS_H_
+
+/*
+* Local APIC registers.
+* Offsets are given in bytes from the APIC base address,
+* all registers are 32-bit wide and 16 bytes aligned.
+*/
+#define APIC_ID               0x020  /* Local APIC ID                 */
+#define APIC_VERSION          0x030  /* Local APIC Version            */
+#define APIC_TPR              0x080  /* Task Priority                 */
+#define APIC_EOI              0x0b0  /* End Of Interrupt              */
+#define APIC_LDR              0x0d0  /* Logical Destination           */
+#define APIC_DFR              0x0e0  /* Destination Format            */
+#define APIC_SVR              0x0f0  /* Spurious Interrupt Vector     */
+#define APIC_ESR              0x280  /* Error Status                  */
+#define APIC_ICR_LOW          0x300  /* Interrupt Command (bits 0-31) */
+#define APIC_ICR_HIGH         0x310  /* Interrupt Command (32-63)     */
+#define APIC_LVT_TIMER        0x320  /* LVT Timer                     */
+#define APIC_LVT_LINT0        0x350  /* LVT LINT0                     */
+#define APIC_LVT_LINT1        0x360  /* LVT LINT1                     */
+#define APIC_LVT_ERROR        0x370  /* LVT Error                     */
+#define APIC_TIMER_ICR        0x380  /* Timer Initial Count           */
+#define APIC_TIMER_CCR        0x390  /* Timer Current Count           */
+#define APIC_TIMER_DCR        0x3e0  /* Timer Divide Configuration    */
+
+/* APIC ID register */
+#define APIC_ID_SHIFT         24
+#define APIC_ID_MASK          0xff
+
+/* Spurious Interrupt Vector register */
+#define APIC_SVR_ENABLE       0x00000100  /* APIC software enable */
+#define APIC_SVR_VECTOR_MASK  0x000000ff
+
+/* Interrupt Command register (low dword) */
+#define APIC_ICR_VECTOR_MASK      0x000000ff
+#define APIC_ICR_DM_FIXED         0x00000000  /* Delivery mode: fixed   */
+#define APIC_ICR_DM_NMI           0x00000400  /* Delivery mode: NMI     */
+#define APIC_ICR_DM_INIT          0x00000500  /* Delivery mode: INIT    */
+#define APIC_ICR_DM_STARTUP       0x00000600  /* Delivery mode: STARTUP */
+#define APIC_ICR_DS_PENDING       0x00001000  /* Delivery status        */
+#define APIC_ICR_LEVEL_ASSERT     0x00004000  /* Level: assert          */
+#define APIC_ICR_TRIGGER_LEVEL    0x00008000  /* Trigger: level         */
+#define APIC_ICR_DEST_FIELD       0x00000000  /* Shorthand: no          */
+#define APIC_ICR_DEST_SELF        0x00040000  /* Shorthand: self        */
+#define APIC_ICR_DEST_ALL         0x00080000  /* Shorthand: all         */
+#define APIC_ICR_DEST_ALL_BUT_SELF 0x000c0000 /* Shorthand: all but self */
+
+/* Interrupt Command register (high dword) */
+#define APIC_ICR_DEST_SHIFT   24
+
+/* Local Vector Table entries */
+#define APIC_LVT_VECTOR_MASK  0x000000ff
+#define APIC_LVT_DM_EXTINT    0x00000700  /* Delivery mode: ExtINT */
+#define APIC_LVT_MASKED       0x00010000  /* Interrupt masked      */
+#define APIC_LVT_TIMER_PERIODIC 0x00020000 /* Periodic timer mode  */
+
+/* Timer Divide Configuration register */
+#define APIC_TIMER_DIV_1      0x0000000b
+#define APIC_TIMER_DIV_16     0x00000003
+#define APIC_TIMER_DIV_DEFAULT  APIC_TIMER_DIV_16  /* used for calibration */
+
+/* Default physical addresses */
+#define APIC_DEFAULT_PHYS_BASE    0xfee00000
+#define IOAPIC_DEFAULT_PHYS_BASE  0xfec00000
+
+/* APIC register read/write via mapped base */
+#define apic_read(base, reg)        ( *(volatile uint32 *)((addr_t)(base) + (reg)) )
+#define apic_write(base, reg, val)  ( *(volatile uint32 *)((addr_t)(base) + (reg)) = (val) )
+
+#endif
@@ -8,5 +8,6 @@
 #include "cpu_bits.h"
 #include "mmu_bits.h"
 #include "fpu_bits.h"
+#include "apic_bits.h"
 
 #endif
@@ -19,6 +19,9 @@ void interrupt40(void);  void interrupt41(void);  void interrupt42(void);
 void interrupt43(void);  void interrupt44(void);  void interrupt45(void);
 void interrupt46(void);  void interrupt47(void);
 
+/* local APIC interrupt entries */
+void interrupt240(void); void interrupt241(void); void interrupt255(void);
+
 /* dummy interrupt handler */
 void dummy_interrupt();
 
@@ -18,8 +18,9 @@ typedef struct {
     uint32 virt_pgdir;    /* virtual address of page directory */
     uint32 num_pgtables;  /* number of allocated page tables */
     uint32 phys_pgtables[MAX_BOOT_PTABLES]; /* physical addresses of page tables */
+    uint32 tsc_time_cv_factor; /* TSC ticks per millisecond (0 if no TSC) */
 
-    /* SMP stuff (currently not used) */
+    /* SMP stuff (filled by kinit if more than one cpu found) */
     uint32 apic_time_cv_factor; /* apic ticks per second */
     uint32 apic_phys;
     uint32 *apic;
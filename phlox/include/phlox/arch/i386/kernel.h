@@ -37,6 +37,9 @@
 /* User space top address */
 #define USER_TOP (USER_BASE + USER_SIZE - 1)
 
+/* Shared time page address, page below user stub table */
+#define USER_TIME_PAGE_BASE (USER_BASE + USER_SIZE - 0x2000)
+
 /* User stack size (in pages) */
 #define USER_STACK_SIZE 256
 
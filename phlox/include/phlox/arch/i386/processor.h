@@ -90,9 +90,9 @@ typedef struct {
  * Memory barriers
  */
 /* Mandatory barriers */
-#define arch_mb()   __asm__ __volatile__ ("lock; addl $0,0(%esp);")  /* memory barrier       */
-#define arch_rmb()  __asm__ __volatile__ ("lock; addl $0,0(%esp);")  /* read memory barrier  */
-#define arch_wmb()  __asm__ __volatile__ ("lock; addl $0,0(%esp);")  /* write memory barrier */
+#define arch_mb()   __asm__ __volatile__ ("lock; addl $0,0(%%esp);": : :"memory")  /* memory barrier       */
+#define arch_rmb()  __asm__ __volatile__ ("lock; addl $0,0(%%esp);": : :"memory")  /* read memory barrier  */
+#define arch_wmb()  __asm__ __volatile__ ("lock; addl $0,0(%%esp);": : :"memory")  /* write memory barrier */
 
 /* SMP barriers */
 #if SYSCFG_SMP_SUPPORT
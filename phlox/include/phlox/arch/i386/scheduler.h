@@ -5,5 +5,14 @@
 #ifndef _PHLOX_ARCH_I386_SCHEDULER_H_
 #define _PHLOX_ARCH_I386_SCHEDULER_H_
 
+/* find index of most significant set bit in non-zero 32-bit word */
+#define arch_sched_find_msb(w) ({ \
+    uint32 __dummy; \
+    __asm__ ( \
+        "bsrl %1, %0;" \
+        :"=r" (__dummy) \
+        :"rm" ((uint32)(w))); \
+    __dummy; \
+})
 
 #endif
@@ -0,0 +1,22 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_ARCH_I386_SMP_H_
+#define _PHLOX_ARCH_I386_SMP_H_
+
+/* Interrupt vectors used by local APIC */
+#define I386_SMP_ICI_VECTOR       0xf0  /* inter-CPU interrupt */
+#define I386_SMP_TIMER_VECTOR     0xf1  /* local APIC timer */
+#define I386_SMP_SPURIOUS_VECTOR  0xff  /* spurious interrupt */
+
+/* First vector handled by SMP module */
+#define I386_SMP_BASE_VECTOR      I386_SMP_ICI_VECTOR
+
+/*
+ * Handles local APIC interrupts.
+ * Returns interrupt handling flags.
+*/
+flags_t i386_smp_handle_interrupt(uint32 vector);
+
+#endif
@@ -0,0 +1,38 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_ARCH_SMP_H_
+#define _PHLOX_ARCH_SMP_H_
+
+#include INC_ARCH(phlox/arch,smp.h)
+
+
+/*
+ * Architecture-specific SMP init.
+ * Called by bootstrap processor.
+*/
+status_t arch_smp_init(kernel_args_t *kargs);
+
+/*
+ * Architecture-specific per CPU SMP init.
+*/
+status_t arch_smp_init_per_cpu(kernel_args_t *kargs, uint curr_cpu);
+
+/*
+ * Returns number of current processor.
+*/
+uint arch_smp_get_current_cpu(void);
+
+/*
+ * Sends inter-CPU interrupt to given processor.
+*/
+void arch_smp_send_ici(uint cpu);
+
+/*
+ * Stops or restarts local timer ticks of current processor.
+*/
+void arch_smp_set_local_timer(bool enable);
+
+
+#endif
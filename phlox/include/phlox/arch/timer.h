@@ -14,5 +14,27 @@
 */
 status_t arch_timer_init(kernel_args_t *kargs);
 
+/*
+ * Returns current value of processor cycles counter.
+ * Returns 0 if processor has no cycles counter.
+*/
+bigtime_t arch_timer_get_cycles(void);
+
+/*
+ * Returns processor cycles counter frequency in kHz.
+ * Returns 0 if processor has no cycles counter.
+*/
+uint32 arch_timer_get_cycles_khz(void);
+
+/*
+ * Converts processor cycles count into microseconds.
+*/
+bigtime_t arch_timer_cycles_to_usec(bigtime_t cycles);
+
+/*
+ * Converts processor cycles count into nanoseconds.
+*/
+bigtime_t arch_timer_cycles_to_nsec(bigtime_t cycles);
+
 
 #endif
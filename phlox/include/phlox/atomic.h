@@ -185,4 +185,22 @@ int  atomic_inc_and_tests(atomic_t *a);
  */
 int  atomic_dec_and_tests(atomic_t *a);
 
+/*
+ * Atomically increments the value of *a if it is not zero
+ *
+ * Returns true if the value of *a was changed
+ */
+static inline int atomic_inc_not_zero(atomic_t *a)
+{
+    int val;
+
+    do {
+        val = *a;
+        if(!val)
+            return 0;
+    } while(!atomic_test_and_set(a, val + 1, val));
+
+    return 1;
+}
+
 #endif
@@ -0,0 +1,93 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_COND_H
+#define _PHLOX_COND_H
+
+#include <phlox/types.h>
+#include <phlox/list.h>
+#include <phlox/spinlock.h>
+#include <phlox/mutex.h>
+
+
+/* Condition variable type */
+typedef struct {
+    spinlock_t lock;     /* Access lock */
+    xlist_t    waiters;  /* Waiting threads */
+} cond_t;
+
+/* Event flags */
+enum {
+    EVENT_FLAG_NOFLAGS      = 0x0,  /* Auto-reset event, initially reset */
+    EVENT_FLAG_MANUAL_RESET = 0x1,  /* Event stays set until reset */
+    EVENT_FLAG_SET          = 0x2   /* Event is initially set */
+};
+
+/* Event type.
+ * Set manual-reset event releases all waiters and stays set,
+ * auto-reset event releases single waiter and resets.
+ */
+typedef struct {
+    spinlock_t lock;     /* Access lock */
+    bool       manual;   /* Manual-reset event */
+    bool       state;    /* Event is set */
+    xlist_t    waiters;  /* Waiting threads */
+} event_t;
+
+
+/*
+ * Init condition variable
+*/
+void cond_init(cond_t *cond);
+
+/*
+ * Release mutex, wait for condition signal and acquire mutex back.
+ * Mutex must be held by caller.
+*/
+status_t cond_wait(cond_t *cond, mutex_t *mtx);
+
+/*
+ * Same as above, but returns ERR_CND_TIMEOUT if condition is
+ * not signaled within timeout. Mutex is acquired back anyway.
+*/
+status_t cond_wait_timeout(cond_t *cond, mutex_t *mtx, uint timeout_msec);
+
+/*
+ * Wake up single waiting thread
+*/
+void cond_signal(cond_t *cond);
+
+/*
+ * Wake up all waiting threads
+*/
+void cond_broadcast(cond_t *cond);
+
+/*
+ * Init event
+*/
+void event_init(event_t *ev, flags_t flags);
+
+/*
+ * Wait until event is set
+*/
+status_t event_wait(event_t *ev);
+
+/*
+ * Wait until event is set, returns ERR_CND_TIMEOUT
+ * if event is not set within timeout.
+*/
+status_t event_wait_timeout(event_t *ev, uint timeout_msec);
+
+/*
+ * Set event
+*/
+void event_set(event_t *ev);
+
+/*
+ * Reset event
+*/
+void event_reset(event_t *ev);
+
+
+#endif
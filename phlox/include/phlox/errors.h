@@ -87,6 +87,23 @@ enum PhloxMutexesErrors {
     ERR_MTX_GENERAL_LIMIT
 };
 
+/* Futexes errors */
+enum PhloxFutexesErrors {
+    ERR_FTX_GENERAL_BASE = (int)0x83200000,
+    ERR_FTX_GENERAL = ERR_FTX_GENERAL_BASE,
+    ERR_FTX_WOULD_BLOCK,
+    ERR_FTX_TIMEOUT,
+    ERR_FTX_GENERAL_LIMIT
+};
+
+/* Condition variables and events errors */
+enum PhloxCondErrors {
+    ERR_CND_GENERAL_BASE = (int)0x83300000,
+    ERR_CND_GENERAL = ERR_CND_GENERAL_BASE,
+    ERR_CND_TIMEOUT,
+    ERR_CND_GENERAL_LIMIT
+};
+
 /* System calls errors */
 enum SystemCallsErrors {
     ERR_SCL_GENERAL_BASE = (int)0x84000000,
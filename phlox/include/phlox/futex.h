@@ -0,0 +1,48 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_FUTEX_H
+#define _PHLOX_FUTEX_H
+
+#include <phlox/types.h>
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+
+
+/*
+ * Fast user space locks support.
+ *
+ * User space keeps synchronization state in a plain memory word
+ * and changes it with atomic instructions. Kernel is entered only
+ * to block thread while word keeps expected value, or to wake up
+ * threads blocked on the word. Waiters are keyed by owner process
+ * and word's user space address.
+*/
+
+
+/*
+ * Called only at system startup for futexes initialization.
+*/
+status_t futex_init(kernel_args_t *kargs);
+
+/*
+ * Block current thread while word at uaddr is equal to val
+ * Params:
+ *   uaddr        - user space address of the word;
+ *   val          - expected value of the word;
+ *   timeout_msec - wait timeout in msec, 0 to wait forever.
+ *
+ * Returns NO_ERROR if woken up, ERR_FTX_WOULD_BLOCK if word value
+ * differs from expected one or ERR_FTX_TIMEOUT if timeout expired.
+*/
+status_t futex_wait(addr_t uaddr, int val, uint timeout_msec);
+
+/*
+ * Wake up to count threads blocked on word at uaddr.
+ * Returns count of threads woken up or negative error code.
+*/
+int futex_wake(addr_t uaddr, uint count);
+
+
+#endif
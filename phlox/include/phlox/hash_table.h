@@ -113,6 +113,9 @@ void *hash_table_find(hash_table_t table, const void *elem);
 
 /*
  * Search in hash table for element with specified key.
+ * Lookup may run concurrently with insert and remove inside RCU
+ * read-side critical section. In this case removed elements must be
+ * freed after grace period and table must not be resized.
 */
 void *hash_table_lookup(hash_table_t table, const void *key);
 
@@ -0,0 +1,46 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_MPSC_QUEUE_H
+#define _PHLOX_MPSC_QUEUE_H
+
+#include <phlox/types.h>
+
+/*
+ * Lock-free multi-producer single-consumer queue.
+ *
+ * Producers push elements with single compare-and-swap and never
+ * wait for consumer, so queue may be filled from interrupt handlers.
+ * Consumer takes all pushed elements at once and extracts them in
+ * order of pushing. Only one consumer may work with queue at a time,
+ * consumers must be serialized by caller.
+ */
+
+/* queue element */
+typedef struct mpsc_queue_element {
+    struct mpsc_queue_element *next;  /* next element */
+} mpsc_queue_elem_t;
+
+/* queue */
+typedef struct {
+    mpsc_queue_elem_t * volatile in;  /* pushed elements, latest first */
+    mpsc_queue_elem_t *out;           /* consumer side, earliest first */
+} mpsc_queue_t;
+
+
+/* init queue */
+void mpsc_queue_init(mpsc_queue_t *q);
+
+/* push element into queue (producer side).
+ * returns true if queue was empty before push.
+ */
+bool mpsc_queue_push(mpsc_queue_t *q, mpsc_queue_elem_t *e);
+
+/* extract earliest element (consumer side) */
+mpsc_queue_elem_t *mpsc_queue_pop(mpsc_queue_t *q);
+
+/* returns true if queue is empty (consumer side) */
+bool mpsc_queue_isempty(mpsc_queue_t *q);
+
+#endif
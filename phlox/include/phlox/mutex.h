@@ -6,21 +6,51 @@
 #define _PHLOX_MUTEX_H
 
 #include <phlox/types.h>
+#include <phlox/spinlock.h>
 
 
-/* Mutex type */
+/* Priority inheritance data.
+ * Holder of mutex runs with priority of most important
+ * blocked thread until it releases all its mutexes.
+ */
 typedef struct {
-    thread_id holder;  /* Mutex holding thread */
-    sem_id    sem;     /* Underlying semaphore */
+    spinlock_t lock;     /* Access lock */
+    int        waiters;  /* Blocked or spinning threads count */
+    int        prio;     /* Highest priority of blocked threads */
+} mutex_pi_t;
+
+/* Mutex type.
+ * Free mutex is acquired and released with single atomic operation
+ * on holder word. Contending thread spins while holder runs on other
+ * cpu and sleeps on semaphore otherwise.
+ */
+typedef struct {
+    atomic_t       holder;         /* Mutex holding thread id, 0 if free */
+    struct thread *holder_thread;  /* Mutex holding thread */
+    sem_id         sem;            /* Semaphore for sleeping waiters */
+    mutex_pi_t     pi;             /* Priority inheritance data */
 } mutex_t;
 
 /* Recursive mutex type */
 typedef struct {
-    thread_id holder;  /* Mutex holding thread */
-    sem_id    sem;     /* Underlying semaphore */
-    unsigned  recurs;  /* Recursion depth */
+    mutex_t        mtx;            /* Underlying mutex */
+    unsigned       recurs;         /* Recursion depth */
 } rmutex_t;
 
+/* Reader-writer mutex type.
+ * Lock is handed off to sleeping threads on release, waiting
+ * writer blocks new readers.
+ */
+typedef struct {
+    spinlock_t     lock;           /* Access lock */
+    int            readers;        /* Active readers count */
+    bool           writer;         /* Held by writer */
+    int            wait_readers;   /* Sleeping readers count */
+    int            wait_writers;   /* Sleeping writers count */
+    sem_id         rsem;           /* Semaphore for sleeping readers */
+    sem_id         wsem;           /* Semaphore for sleeping writers */
+} rwmutex_t;
+
 
 /*
  * Init mutex structure
@@ -88,5 +118,38 @@ status_t rmutex_trylock(rmutex_t *mtx);
 */
 status_t rmutex_unlock(rmutex_t *mtx);
 
+/*
+ * Create reader-writer mutex
+ *
+ * Name will be assigned to writers semaphore,
+ * it can be NULL.
+*/
+status_t rwmutex_create(rwmutex_t *mtx, const char *name);
+
+/*
+ * Destroy reader-writer mutex
+*/
+status_t rwmutex_destroy(rwmutex_t *mtx);
+
+/*
+ * Acquire reader-writer mutex for reading
+*/
+status_t rwmutex_read_lock(rwmutex_t *mtx);
+
+/*
+ * Release reader-writer mutex acquired for reading
+*/
+status_t rwmutex_read_unlock(rwmutex_t *mtx);
+
+/*
+ * Acquire reader-writer mutex for writing
+*/
+status_t rwmutex_write_lock(rwmutex_t *mtx);
+
+/*
+ * Release reader-writer mutex acquired for writing
+*/
+status_t rwmutex_write_unlock(rwmutex_t *mtx);
+
 
 #endif
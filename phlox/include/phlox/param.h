@@ -30,5 +30,10 @@
  */
 #define SYS_MAX_SEM_COUNT      8192
 
+/*
+ * Max. objects count waited by single thread at once
+ */
+#define SYS_MAX_WAIT_OBJECTS   16
+
 
 #endif
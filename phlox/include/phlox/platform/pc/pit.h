@@ -114,6 +114,18 @@ uint32 pit_init(void);
 */
 uint32 pit_set_counter(uint8 counter, uint8 mode, uint16 value);
 
+/*
+ * Reads current counter value.
+ * This routine acquires spinlock before accessing PIT ports.
+ *
+ * Input: counter = 0 - 2;
+ *        status - if not NULL, receives counter status byte
+ *                 (see PIT_RBCMD_STAT_* bits).
+ *
+ * Returns: current counter value.
+*/
+uint16 pit_get_counter(uint8 counter, uint8 *status);
+
 /*
  * Plugs or unplugs counter 2 output to/from
  * PC speaker. Input is true or false respectively.
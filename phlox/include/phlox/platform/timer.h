@@ -14,5 +14,41 @@
 */
 status_t platform_timer_init(kernel_args_t *kargs);
 
+#if SYSCFG_DYNAMIC_TICK
+
+/*
+ * Returns max ticks count one-shot mode may last.
+*/
+uint platform_timer_oneshot_max(void);
+
+/*
+ * Switches system timer into one-shot mode. Timer interrupt
+ * occurs once after given count of ticks.
+*/
+void platform_timer_oneshot(uint ticks);
+
+/*
+ * Switches system timer into one-shot mode. Timer interrupt occurs
+ * once after given count of nanoseconds, but not later than one-shot
+ * mode may last. If timer is in one-shot mode already, it is
+ * reprogrammed unless its interrupt was triggered.
+*/
+void platform_timer_oneshot_nsec(bigtime_t nsec);
+
+/*
+ * Returns count of ticks elapsed since one-shot mode started.
+ * expired is set to true if one-shot interrupt was triggered.
+*/
+uint platform_timer_oneshot_elapsed(bool *expired);
+
+/*
+ * Switches system timer back into periodic mode.
+ * Returns count of ticks elapsed in one-shot mode, expired
+ * is set to true if one-shot interrupt was triggered.
+*/
+uint platform_timer_periodic(bool *expired);
+
+#endif
+
 
 #endif
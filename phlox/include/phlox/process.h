@@ -103,5 +103,12 @@ aspace_id proc_get_aspace_id(process_t *proc);
 */
 vm_address_space_t *proc_get_aspace(process_t *proc);
 
+/*
+ * Returns execution times (in cycles) of exited threads plus
+ * times of all live threads of the process.
+ * Process must have reference count incremented.
+*/
+void proc_get_times(process_t *proc, bigtime_t *kernel_time, bigtime_t *user_time);
+
 
 #endif
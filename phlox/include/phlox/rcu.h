@@ -0,0 +1,72 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_RCU_H_
+#define _PHLOX_RCU_H_
+
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+
+/* Deferred reclamation callback head.
+ * Embedded into object which is freed after grace period.
+ */
+typedef struct rcu_head {
+    struct rcu_head *next;                  /* Next callback in queue */
+    void (*func)(struct rcu_head *head);    /* Reclamation routine */
+} rcu_head_t;
+
+
+/*
+ * Read-copy-update (RCU) style deferred reclamation.
+ *
+ * Readers traverse shared structures inside read-side critical
+ * section without taking locks. Writers unlink elements under their
+ * own locks and defer freeing until grace period elapses, i.e. until
+ * each processor passed quiescent state. Context switch is a quiescent
+ * state, as well as running idle thread outside of read-side section.
+ * Read-side critical sections are executed with interrupts disabled
+ * and must not block.
+ */
+
+/*
+ * Init RCU module
+*/
+status_t rcu_init(kernel_args_t *kargs);
+
+/*
+ * Start reclamation thread. Called after threading init.
+*/
+status_t rcu_init_after_threading(kernel_args_t *kargs);
+
+/*
+ * Enter read-side critical section.
+ * Returns previous interrupt requests state.
+*/
+unsigned long rcu_read_lock(void);
+
+/*
+ * Leave read-side critical section and restore previously
+ * saved interrupt requests state.
+*/
+void rcu_read_unlock(unsigned long irqs_state);
+
+/*
+ * Note quiescent state of processor. Called by scheduler
+ * on each reschedule, idle is true if idle thread selected.
+*/
+void rcu_note_context_switch(uint cpu, bool idle);
+
+/*
+ * Queue routine to be called after grace period.
+ * Routine is called in context of reclamation thread.
+*/
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+/*
+ * Block caller until grace period elapses, so all read-side
+ * critical sections started before are completed.
+*/
+void synchronize_rcu(void);
+
+#endif
@@ -0,0 +1,73 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_RWLOCK_H_
+#define _PHLOX_RWLOCK_H_
+
+#include <phlox/atomic.h>
+
+/* Reader-writer spinlock state bits */
+#define RWLOCK_WRITER   0x40000000  /* held by writer */
+#define RWLOCK_WAITING  0x20000000  /* writer is waiting */
+#define RWLOCK_READERS  0x1FFFFFFF  /* readers count mask */
+
+/* Reader-writer spinlock typedef.
+ * Any number of readers or single writer may hold the lock.
+ * Waiting writer blocks new readers, so writers are not starved.
+ * Zero is unlocked state.
+ */
+typedef struct {
+    atomic_t state;  /* Lock state bits and readers count */
+} rwlock_t;
+
+/*
+ * Set lock to initial state
+*/
+void rw_init(rwlock_t *l);
+
+/*
+ * Acquire lock for reading
+*/
+void rw_read_lock(rwlock_t *l);
+
+/*
+ * Acquire lock for reading with disabled interrupt requests.
+ * Returns previous interrupt requests state.
+*/
+unsigned long rw_read_lock_irqsave(rwlock_t *l);
+
+/*
+ * Release lock acquired for reading
+*/
+void rw_read_unlock(rwlock_t *l);
+
+/*
+ * Release lock acquired for reading and restore previously
+ * saved interrupt requests state.
+*/
+void rw_read_unlock_irqrstor(rwlock_t *l, unsigned long irqs_state);
+
+/*
+ * Acquire lock for writing
+*/
+void rw_write_lock(rwlock_t *l);
+
+/*
+ * Acquire lock for writing with disabled interrupt requests.
+ * Returns previous interrupt requests state.
+*/
+unsigned long rw_write_lock_irqsave(rwlock_t *l);
+
+/*
+ * Release lock acquired for writing
+*/
+void rw_write_unlock(rwlock_t *l);
+
+/*
+ * Release lock acquired for writing and restore previously
+ * saved interrupt requests state.
+*/
+void rw_write_unlock_irqrstor(rwlock_t *l, unsigned long irqs_state);
+
+#endif
@@ -14,24 +14,59 @@
 
 /*
  * Called only from timer interrupt handler.
+ * ticks is count of timer ticks elapsed since previous call.
  * Returns true if reschedule needed, false if not.
 */
-bool scheduler_timer(void);
+bool scheduler_timer(uint ticks);
 
 /*
- * Performs rescheduling and context switch.
- * Note1: Scheduling lock must be acquired before call.
- * Note2: The routine also enables local interrupts and
- *        releases scheduling lock.
+ * Returns true if there are ready threads in runqueue
+ * of current cpu. Used by idle thread.
 */
-void sched_reschedule(void);
+bool sched_cpu_has_work(void);
+
+/*
+ * Returns true if higher priority thread became ready on
+ * current cpu and current thread should be preempted.
+ * Checked on interrupt and system call return paths.
+*/
+bool sched_need_resched(void);
 
 /*
- * Acquire / release scheduling lock.
+ * Asks current cpu to switch to specified thread on next reschedule
+ * (directed yield). Request is ignored if thread is not queued on
+ * current cpu, hint is dropped when thread leaves runqueue. Thread
+ * never goes ahead of more significant ready threads. Thread must
+ * not be locked by caller.
 */
-void sched_lock_acquire(void);
-void sched_lock_release(void);
-bool sched_lock_tryacquire(void);
+void sched_yield_to(thread_t *thread);
+
+/*
+ * Changes scheduling class and real-time priority of thread.
+ * rt_prio is ignored for THREAD_SCHED_NORMAL class.
+ * Note: Thread must be locked before call.
+*/
+status_t sched_set_thread_class(thread_t *thread, int sched_class, int rt_prio);
+
+/*
+ * Boosts dynamic priority of thread up to prio (priority inheritance).
+ * Boost lasts until sched_restore_priority() call.
+ * Note: Thread must be locked before call.
+*/
+void sched_inherit_priority(thread_t *thread, int prio);
+
+/*
+ * Drops priority inherited by thread.
+ * Note: Thread must be locked before call.
+*/
+void sched_restore_priority(thread_t *thread);
+
+/*
+ * Performs rescheduling and context switch.
+ * Note1: Local interrupts must be disabled before call.
+ * Note2: The routine also enables local interrupts.
+*/
+void sched_reschedule(void);
 
 /*
  * Capture cpu by current thread. Thread cannot be rescheduled.
@@ -21,38 +21,86 @@
 #define SCHED_TICK_TYPES_MASK  (SCHED_TICK_TYPES_COUNT-1)
 #define SCHED_ESTIMATION_TICK  (SCHED_TICK_TYPES_COUNT-1)
 
+/* Note: tuning parameters below may be overridden at compile time,
+ * scheduler simulator (sandbox/scheduler/sched_sim) uses this.
+ */
+
 /* Quanta reestimation threshold (power of 2) */
+#ifndef SCHED_QUANTA_THRESHOLD2
 #define SCHED_QUANTA_THRESHOLD2  1
+#endif
 
 /* Priority recalculation factor parameters */
 #define SCHED_FACTOR_BASE   (THREAD_DEFAULT_QUANTA)
+#ifndef SCHED_FACTOR_A
 #define SCHED_FACTOR_A      200
+#endif
+#ifndef SCHED_FACTOR_BTHR
 #define SCHED_FACTOR_BTHR    50
+#endif
+#ifndef SCHED_FACTOR_BMAX
 #define SCHED_FACTOR_BMAX     8
+#endif
 
 /* Per priority queue bonus threshold (power of 2) */
+#ifndef SCHED_QUEUE_BONUS_THRESHOLD2
 #define SCHED_QUEUE_BONUS_THRESHOLD2  4
-/* Better thread lookahead depth */
-#define SCHED_QUEUE_LOOKAHEAD_DEPTH  10
+#endif
+
+/* Total count of priority queues: dynamic and real-time ones */
+#define SCHED_NUM_QUEUES  (THREAD_NUM_PRIORITY_LEVELS + THREAD_NUM_RT_PRIORITY_LEVELS)
+
+/* Subqueues count in each priority queue: one per scheduling policy */
+#define SCHED_NUM_SUBQUEUES  SCHED_POLICIES_COUNT
+
+/* Words count in priority queues bitmap */
+#define SCHED_PRIO_BITMAP_WORDS  ((SCHED_NUM_QUEUES + 31) / 32)
+
+/* Load balancing parameters */
+#define SCHED_BALANCE_PERIOD       100  /* periodic balancing interval (msec) */
+#define SCHED_IMBALANCE_THRESHOLD    2  /* ready threads count difference to start migration */
+#define SCHED_MIGRATE_MAX            4  /* max threads migrated at once */
 
 /* Maximum thread bonus and penalty */
 #define SCHED_MAX_THREAD_BONUS     8
 #define SCHED_MAX_THREAD_PENALTY   8
 
 
-/* Redefinition for convenience */
-typedef xlist_t sched_queue_t;
+/* Priority queue split into scheduling policies subqueues */
+typedef struct {
+    uint     count;                      /* Threads count in all subqueues */
+    uint32   subq_mask;                  /* Non-empty subqueues mask */
+    xlist_t  subq[SCHED_NUM_SUBQUEUES];  /* Subqueues, index is scheduling policy */
+} sched_queue_t;
 
 /* Per CPU run queue */
 typedef struct {
     spinlock_t     lock;                               /* Access lock */
     uint           cpu_num;                            /* CPU number */
     uint           total_count;                        /* Total threads count */
-    sched_queue_t  queue[THREAD_NUM_PRIORITY_LEVELS];  /* Priority queues */
+    thread_t      *curr;                               /* Thread running on CPU */
+    thread_t      *prev;                               /* Thread being switched out */
+    thread_t      *handoff;                            /* Queued thread to run next (directed yield hint) */
+    volatile bool  need_resched;                       /* Current thread must be preempted */
+    int            tick_type;                          /* Current tick type */
+    int            quanta;                             /* Current time quanta */
+    uint           shuffle_factor;                     /* Current shuffle factor */
+    uint           balance_ticks;                      /* Ticks left until load balancing */
+    uint32         prio_summary;                       /* Non-empty bitmap words mask */
+    uint32         prio_bitmap[SCHED_PRIO_BITMAP_WORDS]; /* Non-empty priority queues bitmap */
+    sched_queue_t  queue[SCHED_NUM_QUEUES];            /* Priority queues */
 } runqueue_t;
 
 
 /* check for possible constants errors */
+#if SCHED_PRIO_BITMAP_WORDS > 32
+#  error SCHED_NUM_QUEUES is too large for two-level priority bitmap!
+#endif
+
+#if SCHED_NUM_SUBQUEUES > 32
+#  error SCHED_NUM_SUBQUEUES is too large for subqueues mask!
+#endif
+
 #if !SCHED_MSEC2TICKS(THREAD_DEFAULT_QUANTA)
 #  error THREAD_DEFAULT_QUANTA has 0 ticks length! Increase HZ or change THREAD_DEFAULT_QUANTA!
 #endif
@@ -65,6 +113,10 @@ typedef struct {
 #  error THREAD_QUANTA_GRANULARITY has 0 ticks length! Increase HZ or change THREAD_QUANTA_GRANULARITY!
 #endif
 
+#if !SCHED_MSEC2TICKS(SCHED_BALANCE_PERIOD)
+#  error SCHED_BALANCE_PERIOD has 0 ticks length! Increase HZ or change SCHED_BALANCE_PERIOD!
+#endif
+
 #if !SCHED_MSEC2TICKS(SCHED_FACTOR_BASE)
 #  error SCHED_FACTOR_BASE has 0 ticks length! Increase HZ or change SCHED_FACTOR_BASE!
 #endif
@@ -54,6 +54,19 @@ enum {
     SEMF_TRY     = 0x2   /* Try to count down */
 };
 
+/*
+ * Count down by one any of semaphores
+ * Params:
+ *   ids          - semaphores ids;
+ *   count        - semaphores count (up to SYS_MAX_WAIT_OBJECTS);
+ *   timeout_msec - wait timeout in msec;
+ *   flags        - same flags as for sem_down_ex().
+ *
+ * Returns index of semaphore counted down or negative error code.
+ * Semaphores are checked in order, so lower indexes are preferred.
+*/
+int sem_down_any(const sem_id *ids, uint count, uint timeout_msec, flags_t flags);
+
 /*
  * Count semaphore up
  * Params:
@@ -62,6 +75,18 @@ enum {
 */
 status_t sem_up(sem_id id, uint count);
 
+/*
+ * Count one semaphore up by one and then count down another one by one.
+ * Thread woken up by count up runs next on current CPU, so synchronous
+ * request and reply costs single context switch.
+ * Params:
+ *   up_id        - semaphore to count up;
+ *   down_id      - semaphore to count down;
+ *   timeout_msec - wait timeout in msec;
+ *   flags        - same flags as for sem_down_ex().
+*/
+status_t sem_up_and_down(sem_id up_id, sem_id down_id, uint timeout_msec, flags_t flags);
+
 /*
  * Find semaphore by name
 */
@@ -0,0 +1,85 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_SMP_H_
+#define _PHLOX_SMP_H_
+
+#include <phlox/types.h>
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+#include <phlox/arch/smp.h>
+
+
+/* Inter-CPU interrupt messages */
+#define SMP_MSG_INVALIDATE_TLB        1  /* invalidate whole TLB */
+#define SMP_MSG_INVALIDATE_TLB_ENTRY  2  /* invalidate single TLB entry (data = address) */
+
+
+/*
+ * SMP module init. Called by bootstrap processor
+ * during kernel start up.
+*/
+status_t smp_init(kernel_args_t *kargs);
+
+/*
+ * Per CPU init. Called by each processor after
+ * threading initialized.
+*/
+status_t smp_init_per_cpu(kernel_args_t *kargs, uint curr_cpu);
+
+/*
+ * Non-boot processors spin here until bootstrap processor
+ * completes kernel initialization stages which cannot be
+ * executed in parallel.
+*/
+void smp_trap_non_boot_cpus(uint curr_cpu);
+
+/*
+ * Release non-boot processors trapped by smp_trap_non_boot_cpus().
+*/
+void smp_wake_up_non_boot_cpus(void);
+
+/*
+ * Returns count of processors running kernel.
+*/
+uint smp_get_num_cpus(void);
+
+/*
+ * Returns true if given cpu completed its initialization
+ * and is able to run threads.
+*/
+bool smp_cpu_is_active(uint cpu);
+
+/*
+ * Requests reschedule on given cpu.
+*/
+void smp_send_reschedule(uint cpu);
+
+/*
+ * Stops or restarts local timer ticks of current processor.
+ * Does nothing on processors driven by system timer.
+*/
+void smp_set_local_timer(bool enable);
+
+/*
+ * Sends message to all other processors and waits
+ * until all of them processed it.
+*/
+void smp_send_broadcast_ici(uint msg, addr_t data);
+
+/*
+ * Handles broadcast message pending for current cpu, if any.
+ * Also called from spinning loops to avoid deadlock with
+ * processor waiting for message being handled.
+*/
+void smp_process_pending_ici(void);
+
+/*
+ * Handles inter-CPU interrupt. Called from arch layer.
+ * Returns interrupt handling flags.
+*/
+flags_t smp_handle_ici(void);
+
+
+#endif
@@ -5,14 +5,30 @@
 #ifndef _PHLOX_SPINLOCK_H_
 #define _PHLOX_SPINLOCK_H_
 
+#include <phlox/ktypes.h>
 #include <phlox/atomic.h>
 
-/* Spinlock states */
-#define SPIN_LOCKED    1
-#define SPIN_UNLOCKED  0
+/* Spinlock contention statistics */
+typedef struct {
+    uint64   acquired;     /* Acquisitions count */
+    uint64   contended;    /* Acquisitions which had to spin */
+    uint64   spin_cycles;  /* Cycles spent spinning */
+    addr_t   caller;       /* Last contended acquisition caller */
+    atomic_t registered;   /* Lock is in statistics table */
+} spinlock_stats_t;
 
-/* Spinlock typedef */
-typedef atomic_t spinlock_t;
+/* Spinlock typedef.
+ * Ticket lock: acquirer takes next ticket and spins until owner
+ * counter reaches it, so lock is granted in FIFO order and spinning
+ * cpus only read shared cache line. All zeroes is unlocked state.
+ */
+typedef struct {
+    atomic_t next;   /* Next ticket to hand out */
+    atomic_t owner;  /* Ticket of lock holder */
+#if SYSCFG_SPINLOCK_STATS
+    spinlock_stats_t stats;  /* Contention statistics */
+#endif
+} spinlock_t;
 
 /*
  * Set spinlock variable to initial state
@@ -67,6 +83,23 @@ void spin_wait(spinlock_t *s);
 */
 int spin_locked(spinlock_t *s);
 
+#if SYSCFG_SPINLOCK_STATS
+/*
+ * Print statistics of most contended spinlocks into kernel log.
+ * Locks are ordered by spin cycles. Lock is listed after
+ * its first contended acquisition.
+*/
+void spin_stats_dump(uint count);
+
+/*
+ * Reset collected statistics
+*/
+void spin_stats_reset(void);
+#endif
+
+/* Flags of spinlocks statistics system call */
+#define SPIN_STATS_FLAG_RESET  0x1  /* reset statistics after printing */
+
 /*
  * SMP-specific stuff. Must only be used to control SMP effects.
  */
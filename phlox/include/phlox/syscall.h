@@ -24,9 +24,19 @@
 #define SYSCALL_SEM_GET_BY_NAME             14
 #define SYSCALL_VIRTMEM_ALLOC               15
 #define SYSCALL_VIRTMEM_FREE                16
+#define SYSCALL_THREAD_TIMES                17
+#define SYSCALL_THREAD_SET_SCHED            18
+#define SYSCALL_FUTEX_WAIT                  19
+#define SYSCALL_FUTEX_WAKE                  20
+#define SYSCALL_SEM_DOWN_ANY                21
+#define SYSCALL_SEM_UP_AND_DOWN             22
+#define SYSCALL_SYSTEM_TIME                 23
+#define SYSCALL_THREAD_USLEEP               24
+#define SYSCALL_THREAD_SET_TIMER_SLACK      25
+#define SYSCALL_SPIN_STATS                  26
 
 /* Number of system calls */
-#define NR_SYSCALLS                         17
+#define NR_SYSCALLS                         27
 
 /* Reserved system call value */
 #define INVALID_SYSCALL                     -1
@@ -16,15 +16,33 @@
 /* Defines internal kernel timer frequency */
 #define SYSCFG_KERNEL_HZ  250 /* Hz */
 
+/* Stop timer ticks on idle cpus (dynamic tick) */
+#define SYSCFG_DYNAMIC_TICK  1
+
+/* Default timer slack of threads, sleeps may last longer by
+ * this time to be coalesced with other timer events.
+ */
+#define SYSCFG_TIMER_SLACK_NSEC  50000 /* nsec */
+
+/* Default slack is shorter than timer tick, so tick based sleeps
+ * of threads with nonzero slack get extra slack proportional to
+ * sleep length: ticks >> SHIFT, but not more than MAX_MSEC.
+ */
+#define SYSCFG_TIMER_SLACK_TICKS_SHIFT  3
+#define SYSCFG_TIMER_SLACK_MAX_MSEC     100 /* msec */
+
 /* Defines kernel log config */
 #define SYSCFG_KLOG_NROWS  128  /* Rows number */
 #define SYSCFG_KLOG_NCOLS   64  /* Cols number */
 
-/* Compile in support for SMP or not (not supported for now) */
-#define SYSCFG_SMP_SUPPORT 0
+/* Compile in support for SMP or not */
+#define SYSCFG_SMP_SUPPORT 1
+
+/* Collect spinlocks contention statistics */
+#define SYSCFG_SPINLOCK_STATS 0
 
-/* Maximum number of supported cpus */
-#define SYSCFG_MAX_CPUS 32
+/* Maximum number of supported cpus (limited by per CPU TSS selectors in GDT) */
+#define SYSCFG_MAX_CPUS 8
 
 #if !SYSCFG_SMP_SUPPORT
 #undef  SYSCFG_MAX_CPUS
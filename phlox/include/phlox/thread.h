@@ -11,6 +11,7 @@
 #include <phlox/syscall.h>
 #include <phlox/thread_types.h>
 #include <phlox/arch/thread.h>
+#include <phlox/arch/timer.h>
 
 
 /* Reserved ID */
@@ -106,6 +107,43 @@ static inline int thread_syscall_no(void)
     return thread_get_current_thread()->in_syscall;
 }
 
+/*
+ * Charge cycles elapsed since last accounting point to
+ * thread's user-side or kernel-side execution time.
+ * Called with local interrupts disabled.
+*/
+static inline void thread_account_time(thread_t *thread, bool user)
+{
+    bigtime_t now = arch_timer_get_cycles();
+
+    if(user)
+        thread->user_time += now - thread->time_stamp;
+    else
+        thread->kernel_time += now - thread->time_stamp;
+
+    thread->time_stamp = now;
+}
+
+/*
+ * Returns thread and its process execution times.
+ * Thread with id = 0 means current thread.
+*/
+status_t thread_get_times(thread_id tid, thread_times_t *times);
+
+/*
+ * Set scheduling class and real-time priority for thread.
+ * Thread with id = 0 means current thread. Real-time classes
+ * are allowed only for kernel and service processes.
+*/
+status_t thread_set_sched_class(thread_id tid, int sched_class, int rt_prio);
+
+/*
+ * Set timer slack for thread. Thread sleeps may expire later by up
+ * to slack nanoseconds, so they are coalesced with other timer events.
+ * Thread with id = 0 means current thread.
+*/
+status_t thread_set_timer_slack(thread_id tid, bigtime_t nsec);
+
 /*
  * Create new kernel-side thread of execution.
  * Returns new thread id or INVALID_THREADID on error.
@@ -140,6 +178,12 @@ thread_id thread_create_user_thread(const char *name, process_t *proc, addr_t en
 */
 void thread_yield(void);
 
+/*
+ * Transfer control to specified thread if it is ready to run on
+ * current CPU, otherwise acts as thread_yield() (directed yield).
+*/
+void thread_yield_to(thread_t *thread);
+
 /*
  * Terminate current thread with specified exit code
 */
@@ -166,6 +210,13 @@ status_t thread_resume(thread_id tid);
 */
 void thread_sleep(uint msec);
 
+/*
+ * Put current thread into bed for a given count of
+ * nanoseconds. Thread is woken up using high-resolution
+ * timer, but not later than its timer slack allows.
+*/
+void thread_sleep_nsec(bigtime_t nsec);
+
 /*
  * Put thread into bed by its id.
 */
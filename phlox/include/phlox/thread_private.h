@@ -29,15 +29,26 @@
 */
 
 /* Per thread time quanta params in milliseconds */
+#ifndef THREAD_DEFAULT_QUANTA
 #define THREAD_DEFAULT_QUANTA      60  /* Default quanta size */
+#endif
+#ifndef THREAD_MINIMUM_QUANTA
 #define THREAD_MINIMUM_QUANTA      20  /* Minimum quanta size */
+#endif
+#ifndef THREAD_QUANTA_GRANULARITY
 #define THREAD_QUANTA_GRANULARITY  10  /* Quanta granularity  */
+#endif
 
 /* Priorities constants */
 #define THREAD_NUM_PRIORITY_LEVELS  128
 #define THREAD_LOWEST_PIORITY         0
 #define THREAD_HIGHEST_PRIORITY     (THREAD_NUM_PRIORITY_LEVELS-1)
 
+/* Real-time priorities are placed above all dynamic priorities */
+#define THREAD_NUM_RT_PRIORITY_LEVELS  32
+#define THREAD_RT_PRIORITY_BASE        THREAD_NUM_PRIORITY_LEVELS
+#define THREAD_RR_QUANTA               20  /* Round-robin quanta size */
+
 /* Additional priority levels added to thread depending on process role */
 #define PROCESS_ROLE_PRIORITY_SHIFT_KERNEL   8
 #define PROCESS_ROLE_PRIORITY_SHIFT_SERVICE  4
@@ -91,6 +102,13 @@ void sched_add_idle_thread(thread_t *thread, uint cpu);
 */
 void sched_add_thread(thread_t *thread);
 
+/*
+ * Add thread for scheduling on current CPU and switch to it
+ * on next reschedule (hand-off wakeup). Used by waker which
+ * is going to block right after wake up.
+*/
+void sched_add_thread_handoff(thread_t *thread);
+
 /*
  * Remove thread from scheduling.
 */
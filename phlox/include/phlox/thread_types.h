@@ -7,7 +7,9 @@
 
 #include <phlox/ktypes.h>
 #include <phlox/list.h>
+#include <phlox/mpsc_queue.h>
 #include <phlox/avl_tree.h>
+#include <phlox/hash_table.h>
 #include <phlox/vm_types.h>
 #include <phlox/processor.h>
 #include <phlox/spinlock.h>
@@ -78,13 +80,20 @@ typedef struct thread {
     int              jiffies;            /* Current jiffies count */
     int              ijiffies;           /* Initial jiffies count */
     sched_policy_t   sched_policy;       /* Scheduling policy */
+    int              sched_class;        /* Scheduling class */
+    int              rt_prio;            /* Real-time priority */
     int              s_prio;             /* Static priority */
     int              d_prio;             /* Current dynamic priority */
+    int              sched_subqueue;     /* Priority subqueue index */
+    int              pi_prio;            /* Inherited priority, 0 if not inherited */
+    int              pi_locks;           /* Held priority inheriting locks count */
     bigtime_t        sched_stamp;        /* Scheduler's timestamp */
     int              carrots_sticks;     /* Carrots and Sticks Policy value */
     /* Thread timing */
     bigtime_t        kernel_time;        /* Kernel-side execution time */
     bigtime_t        user_time;          /* User-side execution time */
+    bigtime_t        time_stamp;         /* Cycles count at last accounting */
+    bigtime_t        timer_slack;        /* Allowed sleep expiration delay, nsec */
     /* Entry */
     addr_t           entry;              /* Entry point address */
     void             *data;              /* Optional data passed to thread */
@@ -92,9 +101,11 @@ typedef struct thread {
     xlist_t          term_cbs_list;      /* Termination callbacks list */
     /* List nodes */
     list_elem_t      threads_list_node;  /* Threads list node */
-    avl_tree_node_t  threads_tree_node;  /* Threads tree node */
+    hash_node_t      threads_hash_node;  /* Threads hash table node */
     list_elem_t      proc_list_node;     /* Process threads list node */
     list_elem_t      sched_list_node;    /* List node for execution scheduling */
+    mpsc_queue_elem_t death_queue_node;  /* Death threads queue node */
+    rcu_head_t       rcu;                /* Deferred recycling callback */
     /* Hardware-dependend data */
     arch_thread_t    arch;               /* Architecture-dependend data */
 /* TODO: Semaphores */
@@ -112,6 +123,13 @@ enum {
   THREAD_STATE_DEAD        /* Thread is dead */
 };
 
+/* Thread scheduling classes */
+enum {
+  THREAD_SCHED_NORMAL = 0,  /* Dynamic priorities */
+  THREAD_SCHED_FIFO,        /* Real-time, runs until blocks or yields */
+  THREAD_SCHED_RR           /* Real-time, round-robin within priority */
+};
+
 /* Thread flags */
 enum {
   THREAD_FLAG_NONE        = 0x0,  /* No flags set */
@@ -151,9 +169,10 @@ typedef struct process {
     xlist_t             children;         /* List of child processes */
     list_elem_t         sibling_node;     /* Node in parent process */
     xlist_t             semaphores;       /* Owned semaphores list */
-    /* Node of global processes list and tree */
+    /* Node of global processes list and hash table */
     list_elem_t         procs_list_node;  /* Processes list node */
-    avl_tree_node_t     procs_tree_node;  /* Processes tree node */
+    hash_node_t         procs_hash_node;  /* Processes hash table node */
+    rcu_head_t          rcu;              /* Deferred free callback */
     /* Hardware-dependend data */
     arch_process_t      arch;             /* Architecture-dependend data */
 } process_t;
@@ -188,5 +207,16 @@ typedef struct thread_cbd {
     list_elem_t list_node;             /* List node */
 } thread_cbd_t;
 
+/* Thread and process execution times (in microseconds) */
+#ifndef _THREAD_TIMES_T_DEFINED
+#define _THREAD_TIMES_T_DEFINED
+typedef struct {
+    bigtime_t thread_kernel_time;   /* Thread kernel-side time */
+    bigtime_t thread_user_time;     /* Thread user-side time */
+    bigtime_t process_kernel_time;  /* Process kernel-side time */
+    bigtime_t process_user_time;    /* Process user-side time */
+} thread_times_t;
+#endif
+
 
 #endif
@@ -27,8 +27,24 @@
 #define TIMER_TIME_TO_TICKS(time,u)  ( (time) * HZ / ((u)+(u)%HZ) )
 #define TIMER_TICKS_TO_MSEC(a)       TIMER_TICKS_TO_TIME(a, TIMER_MSEC_PER_SEC)
 #define TIMER_MSEC_TO_TICKS(a)       TIMER_TIME_TO_TICKS(a, TIMER_MSEC_PER_SEC)
+#define TIMER_NSEC_PER_TICK          TIMER_TICKS_TO_TIME(1LL, TIMER_NSEC_PER_SEC)
 
 
+#ifndef _TIME_PAGE_T_DEFINED
+#define _TIME_PAGE_T_DEFINED
+/* Shared time page. Updated by kernel and mapped read-only into
+ * each user address space. Fields are consistent if sequence
+ * was even and did not change while reading them.
+ */
+typedef struct {
+    volatile unsigned seq;    /* update sequence, odd while updating */
+    unsigned cycles_khz;      /* cycles counter frequency in kHz (0 if not used) */
+    bigtime_t cycles_base;    /* cycles counter value at system boot */
+    bigtime_t ticks;          /* timer ticks since system boot */
+    bigtime_t nsec_per_tick;  /* timer tick length in nanoseconds */
+} time_page_t;
+#endif
+
 /* timeout routine type definition */
 typedef void (*timeout_routine_t)(timeout_id,void*);
 
@@ -46,12 +62,35 @@ status_t timer_init(kernel_args_t *kargs);
 status_t timer_init_after_threading(kernel_args_t *kargs);
 
 
+/*
+ * Map shared time page into user address space.
+ * Called on user process creation.
+*/
+status_t timer_map_time_page(aspace_id aid);
+
 /*
  * Called on timer tick. Do not call directly.
 */
 flags_t timer_tick(void);
 
 
+#if SYSCFG_DYNAMIC_TICK
+
+/*
+ * Called by idle thread before halting cpu, with interrupts disabled.
+ * Stops timer ticks until next timer event or other interrupt.
+*/
+void timer_idle_enter(void);
+
+/*
+ * Called with interrupts disabled when cpu leaves idle state.
+ * Restarts timer ticks and processes ticks elapsed while idle.
+ * Returns true if reschedule is needed.
+*/
+bool timer_idle_exit(void);
+
+#endif
+
 /*
  * Returns count of timer ticks counted since system booted up.
 */
@@ -62,14 +101,30 @@ bigtime_t timer_get_ticks(void);
 */
 bigtime_t timer_get_time(void);
 
+/*
+ * Returns count of nanoseconds since system booted up.
+ * Clock is monotonic and has resolution of processor cycles
+ * counter if it is available, or timer tick resolution otherwise.
+*/
+bigtime_t timer_get_time_nsec(void);
+
 /*
  * Suspends thread for a given amount of timer ticks.
  * Thread must be locked before call and be in RUNNING
  * or READY state. After reschedule thread will be in
- * a SLEEPING state.
+ * a SLEEPING state. Expiration may be delayed within thread
+ * timer slack to be coalesced with other events.
 */
 status_t timer_lull_thread(thread_t *thread, uint ticks);
 
+/*
+ * Same as above, but sleep time is given in nanoseconds.
+ * System timer is programmed to expire exactly at the deadline,
+ * so use it for short sleeps where tick resolution is too coarse.
+ * Deadline is moved to already queued one within thread timer slack.
+*/
+status_t timer_lull_thread_nsec(thread_t *thread, bigtime_t nsec);
+
 /*
  * Schedule timeout call after given count of timer ticks.
  *
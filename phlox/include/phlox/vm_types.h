@@ -8,6 +8,8 @@
 #include <phlox/ktypes.h>
 #include <phlox/list.h>
 #include <phlox/avl_tree.h>
+#include <phlox/hash_table.h>
+#include <phlox/rcu.h>
 #include <phlox/spinlock.h>
 #include <phlox/arch/vm_translation_map.h>
 
@@ -78,7 +80,8 @@ typedef struct vm_address_space {
     vm_translation_map_t  tmap;          /* Translation map */
     struct vm_memory_map  mmap;          /* Memory map */
     list_elem_t           list_node;     /* Node of address spaces list */
-    avl_tree_node_t       tree_node;     /* Node of address spaces AVL tree */
+    hash_node_t           hash_node;     /* Node of address spaces hash table */
+    rcu_head_t            rcu;           /* Deferred free callback */
 } vm_address_space_t;
 
 /* Address space states */
@@ -101,7 +104,8 @@ typedef struct vm_object {
     avl_tree_t       upages_tree;    /* Universal pages AVL tree */
     xlist_t          mappings_list;  /* Mappings list */
     list_elem_t      list_node;      /* Node of objects list */
-    avl_tree_node_t  tree_node;      /* Node of objects AVL tree */
+    hash_node_t      hash_node;      /* Node of objects hash table */
+    rcu_head_t       rcu;            /* Deferred free callback */
 } vm_object_t;
 
 /* Object states */
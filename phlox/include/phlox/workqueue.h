@@ -0,0 +1,73 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_WORKQUEUE_H_
+#define _PHLOX_WORKQUEUE_H_
+
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+#include <phlox/atomic.h>
+#include <phlox/mpsc_queue.h>
+
+/* Deferred work priorities */
+enum {
+  WORK_PRIORITY_NORMAL = 0,  /* Executed by ordinary kernel worker */
+  WORK_PRIORITY_HIGH,        /* Executed by real-time worker */
+  /* Count of work priorities */
+  WORK_PRIORITIES_COUNT
+};
+
+/* Deferred work item.
+ * Embedded into object which owns the work.
+ */
+typedef struct work {
+    mpsc_queue_elem_t queue_node;     /* Worker queue node */
+    void (*func)(struct work *work);  /* Work routine */
+    int priority;                     /* Work priority */
+    atomic_t pending;                 /* Queued, but not started yet */
+} work_t;
+
+
+/*
+ * Deferred work (workqueue) subsystem.
+ *
+ * Each processor has its own worker thread for each work priority.
+ * Work is queued without locking, so it may be queued from interrupt
+ * handlers. Works queued to the same worker are executed one after
+ * another in order of queueing, works of different workers are
+ * executed independently, so slow routine delays only its own worker.
+ * Work routines are called in thread context and may block.
+ */
+
+/*
+ * Create worker threads. Called after threading init.
+*/
+status_t workqueue_init(kernel_args_t *kargs);
+
+/*
+ * Init work item before first use.
+*/
+void work_init(work_t *work, void (*func)(work_t *work), int priority);
+
+/*
+ * Queue work to worker of current processor.
+ * Returns false if work is already pending.
+*/
+bool work_queue(work_t *work);
+
+/*
+ * Queue work to worker of given processor.
+ * Returns false if work is already pending.
+*/
+bool work_queue_on(work_t *work, uint cpu);
+
+/*
+ * Returns true if work is queued, but not started yet.
+*/
+static inline bool work_is_pending(work_t *work)
+{
+    return work->pending != 0;
+}
+
+#endif
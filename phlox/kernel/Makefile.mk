@@ -16,7 +16,12 @@ PHLOXK_SRC +=                 \
 	$(LOCDIR)/process.c   \
 	$(LOCDIR)/scheduler.c \
 	$(LOCDIR)/thread.c    \
+	$(LOCDIR)/smp.c       \
 	$(LOCDIR)/sem.c       \
+	$(LOCDIR)/futex.c     \
+	$(LOCDIR)/cond.c      \
+	$(LOCDIR)/rcu.c       \
+	$(LOCDIR)/workqueue.c \
 	$(LOCDIR)/elf_file.c  \
 	$(LOCDIR)/syscall.c   \
 	$(LOCDIR)/imgload.c   \
@@ -16,6 +16,7 @@
 #include <phlox/scheduler.h>
 #include <phlox/thread.h>
 #include <phlox/interrupt.h>
+#include <phlox/smp.h>
 
 
 /* Interrupt Descriptors Table */
@@ -27,9 +28,6 @@ static cpu_tss doublefault_tss;
 #define DOUBLEFAULT_STACKSTART  (uint32)(doublefault_stack + DOUBLEFAULT_STACKSIZE)
 static uint32 doublefault_stack[DOUBLEFAULT_STACKSIZE];
 
-/* =true if previous reschedule operation was skiped. */
-static bool resched_pending = false;
-
 
 /*
  * Set of locally used routines
@@ -135,6 +133,12 @@ status_t arch_interrupt_init(kernel_args_t *kargs)
     i386_set_intr_gate(45,  &interrupt45);
     i386_set_intr_gate(46,  &interrupt46);
     i386_set_intr_gate(47,  &interrupt47);
+#if SYSCFG_SMP_SUPPORT
+    /* local APIC interrupts */
+    i386_set_intr_gate(I386_SMP_ICI_VECTOR,      &interrupt240);
+    i386_set_intr_gate(I386_SMP_TIMER_VECTOR,    &interrupt241);
+    i386_set_intr_gate(I386_SMP_SPURIOUS_VECTOR, &interrupt255);
+#endif
 
     /* system call */
     i386_set_syscall_gate(0xc0, &system_call);
@@ -228,7 +232,7 @@ void i386_handle_interrupt(i386_int_frame_t *frame); /* lets compiler be happy *
 void i386_handle_interrupt(i386_int_frame_t *frame)
 {
     thread_t *th = NULL;
-    bool resched_needed = resched_pending; resched_pending = false;
+    bool resched_needed = false;
 
     /* get current thread only if kernel startup stage completed,
      * which means threading is up and running.
@@ -236,6 +240,10 @@ void i386_handle_interrupt(i386_int_frame_t *frame)
     if(is_kernel_ready())
         th = thread_get_current_thread();
 
+    /* charge time spent in user space */
+    if(th && (frame->cs & 3))
+        thread_account_time(th, true);
+
     /* if entering exception */
     if(th && frame->vector <= 19)
         ++th->in_exception;
@@ -421,6 +429,16 @@ void i386_handle_interrupt(i386_int_frame_t *frame)
                 /* leaving hardware interrupt */
                 if(th) --th->in_interrupt;
             }
+#if SYSCFG_SMP_SUPPORT
+            /* local APIC interrupts */
+            else if(frame->vector >= I386_SMP_BASE_VECTOR) {
+                if(th) ++th->in_interrupt;
+                res = i386_smp_handle_interrupt(frame->vector);
+                if(res & INT_FLAGS_RESCHED)
+                    resched_needed = true;
+                if(th) --th->in_interrupt;
+            }
+#endif
         }
          break;
     }
@@ -429,11 +447,13 @@ void i386_handle_interrupt(i386_int_frame_t *frame)
     if(th && frame->vector <= 19)
         --th->in_exception;
 
-    /* reschedule if needed */
-    if(resched_needed) {
-        if(sched_lock_tryacquire())
-            sched_reschedule();
-        else
-            resched_pending = true;
-    }
+    /* charge time spent in handler */
+    if(th && (frame->cs & 3))
+        thread_account_time(th, false);
+
+    /* reschedule if needed or if higher priority
+     * thread was woken up on this cpu.
+     */
+    if(resched_needed || (th && sched_need_resched()))
+        sched_reschedule();
 }
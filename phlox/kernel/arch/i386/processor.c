@@ -408,6 +408,15 @@ status_t arch_processor_init_after_vm(arch_processor_t *ap, kernel_args_t *kargs
      "    ltr  %%ax;      "
         : : "r" (seg) : "eax");
 
+    /* bootstrap cpu turns Global bit on during translation map init,
+     * others do it here. also drop TLB entries left from kinit.
+     */
+    if(curr_cpu != BOOTSTRAP_CPU) {
+        if(ap->features[I386_FEATURE_D] & X86_CPUID_PGE)
+            write_cr4(read_cr4() | X86_CR4_PGE);
+        invalidate_TLB();
+    }
+
     return NO_ERROR;
 }
 
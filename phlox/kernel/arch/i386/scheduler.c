@@ -5,6 +5,7 @@
 #include <phlox/errors.h>
 #include <phlox/processor.h>
 #include <phlox/scheduler.h>
+#include <phlox/thread.h>
 #include <phlox/thread_private.h>
 
 
@@ -32,6 +33,10 @@ void arch_sched_context_switch(thread_t *t_from, thread_t *t_to)
     if(t_from == t_to)
         return;
 
+    /* charge outgoing thread and start accounting for incoming one */
+    thread_account_time(t_from, false);
+    t_to->time_stamp = t_from->time_stamp;
+
     /* switch page directory if switching to
      * new address space
      */
@@ -0,0 +1,153 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <arch/cpu.h>
+#include <arch/arch_bits.h>
+#include <phlox/errors.h>
+#include <phlox/kernel.h>
+#include <phlox/param.h>
+#include <phlox/processor.h>
+#include <phlox/interrupt.h>
+#include <phlox/scheduler.h>
+#include <phlox/smp.h>
+
+
+/* Local APIC (mapped by kinit, NULL on uniprocessor systems) */
+static uint32 *apic = NULL;
+
+/* APIC IDs to cpu numbers mapping and vice versa */
+static uint8 apic_id_to_cpu[APIC_ID_MASK + 1];
+static uint8 cpu_to_apic_id[SYSCFG_MAX_CPUS];
+
+/* APIC timer initial count for HZ frequency */
+static uint32 apic_timer_count = 0;
+
+
+/* arch-specific SMP init */
+status_t arch_smp_init(kernel_args_t *kargs)
+{
+    uint i;
+
+    /* APIC is not used on uniprocessor systems */
+    if(kargs->num_cpus < 2)
+        return NO_ERROR;
+
+    apic = kargs->arch_args.apic;
+
+    for(i = 0; i < kargs->num_cpus; i++) {
+        cpu_to_apic_id[i] = kargs->arch_args.cpu_apic_id[i];
+        apic_id_to_cpu[cpu_to_apic_id[i]] = i;
+    }
+
+    apic_timer_count = kargs->arch_args.apic_time_cv_factor / HZ;
+
+    return NO_ERROR;
+}
+
+/* arch-specific per cpu SMP init */
+status_t arch_smp_init_per_cpu(kernel_args_t *kargs, uint curr_cpu)
+{
+    uint32 tmp;
+
+    if(apic == NULL)
+        return NO_ERROR;
+
+    /* software enable APIC and set spurious interrupt vector */
+    tmp = apic_read(apic, APIC_SVR) & ~APIC_SVR_VECTOR_MASK;
+    apic_write(apic, APIC_SVR, tmp | APIC_SVR_ENABLE | I386_SMP_SPURIOUS_VECTOR);
+
+    /* accept all interrupts */
+    apic_write(apic, APIC_TPR, 0);
+
+    /* errors are not handled */
+    apic_write(apic, APIC_LVT_ERROR, APIC_LVT_MASKED);
+
+    if(curr_cpu == BOOTSTRAP_CPU) {
+        /* system timer drives scheduler on bootstrap cpu.
+         * LINT0 is left as BIOS set it, so PIC interrupts
+         * are still delivered to bootstrap cpu.
+         */
+        apic_write(apic, APIC_LVT_TIMER, APIC_LVT_MASKED | I386_SMP_TIMER_VECTOR);
+    } else {
+        /* PIC interrupts are handled by bootstrap cpu only */
+        apic_write(apic, APIC_LVT_LINT0, APIC_LVT_MASKED | APIC_LVT_DM_EXTINT);
+
+        /* local APIC timer drives scheduler on other cpus */
+        apic_write(apic, APIC_TIMER_DCR, APIC_TIMER_DIV_DEFAULT);
+        apic_write(apic, APIC_LVT_TIMER, APIC_LVT_TIMER_PERIODIC | I386_SMP_TIMER_VECTOR);
+        apic_write(apic, APIC_TIMER_ICR, apic_timer_count);
+    }
+
+    return NO_ERROR;
+}
+
+/* returns current cpu number */
+uint arch_smp_get_current_cpu(void)
+{
+    if(apic == NULL)
+        return BOOTSTRAP_CPU;
+
+    return apic_id_to_cpu[(apic_read(apic, APIC_ID) >> APIC_ID_SHIFT) & APIC_ID_MASK];
+}
+
+/* send inter-CPU interrupt */
+void arch_smp_send_ici(uint cpu)
+{
+    unsigned long irqs_state;
+    uint32 tmp;
+
+    if(apic == NULL)
+        return;
+
+    local_irqs_save_and_disable(irqs_state);
+
+    /* wait until previous interrupt delivered */
+    while(apic_read(apic, APIC_ICR_LOW) & APIC_ICR_DS_PENDING)
+        cpu_relax();
+
+    /* set destination */
+    tmp = apic_read(apic, APIC_ICR_HIGH) & ~(APIC_ID_MASK << APIC_ICR_DEST_SHIFT);
+    apic_write(apic, APIC_ICR_HIGH, tmp | (cpu_to_apic_id[cpu] << APIC_ICR_DEST_SHIFT));
+
+    /* and send (writing low dword triggers interrupt) */
+    tmp = apic_read(apic, APIC_ICR_LOW) & 0xfff32000;  /* keep reserved bits */
+    apic_write(apic, APIC_ICR_LOW, tmp | APIC_ICR_DM_FIXED | APIC_ICR_LEVEL_ASSERT |
+                                   APIC_ICR_DEST_FIELD | I386_SMP_ICI_VECTOR);
+
+    local_irqs_restore(irqs_state);
+}
+
+/* stop or restart local APIC timer */
+void arch_smp_set_local_timer(bool enable)
+{
+    /* bootstrap cpu is driven by system timer */
+    if(apic == NULL || arch_smp_get_current_cpu() == BOOTSTRAP_CPU)
+        return;
+
+    if(enable) {
+        apic_write(apic, APIC_LVT_TIMER, APIC_LVT_TIMER_PERIODIC | I386_SMP_TIMER_VECTOR);
+        apic_write(apic, APIC_TIMER_ICR, apic_timer_count);
+    } else {
+        apic_write(apic, APIC_LVT_TIMER, APIC_LVT_MASKED | I386_SMP_TIMER_VECTOR);
+        apic_write(apic, APIC_TIMER_ICR, 0);
+    }
+}
+
+/* handle local APIC interrupt */
+flags_t i386_smp_handle_interrupt(uint32 vector)
+{
+    switch(vector) {
+        case I386_SMP_ICI_VECTOR:
+            apic_write(apic, APIC_EOI, 0);
+            return smp_handle_ici();
+
+        case I386_SMP_TIMER_VECTOR:
+            apic_write(apic, APIC_EOI, 0);
+            return scheduler_timer(1) ? INT_FLAGS_RESCHED : INT_FLAGS_NOFLAGS;
+
+        /* spurious interrupts must not be acknowledged */
+        default:
+            return INT_FLAGS_NOFLAGS;
+    }
+}
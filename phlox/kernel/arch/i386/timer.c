@@ -2,12 +2,59 @@
 * Copyright 2007-2009, Stepan V.Karpenko. All rights reserved.
 * Distributed under the terms of the PhloxOS License.
 */
+#include <arch/cpu.h>
 #include <phlox/errors.h>
+#include <phlox/processor.h>
 #include <phlox/timer.h>
 
 
+/* TSC frequency in kHz, calibrated by kinit. =0 if no TSC. */
+static uint32 tsc_khz = 0;
+
+
 /* arch-specific timer init */
 status_t arch_timer_init(kernel_args_t *kargs)
 {
+    tsc_khz = kargs->arch_args.tsc_time_cv_factor;
+
     return NO_ERROR;
 }
+
+/* read time-stamp counter */
+bigtime_t arch_timer_get_cycles(void)
+{
+    if(!tsc_khz)
+        return 0;
+
+    return (bigtime_t)i386_rdtsc();
+}
+
+/* TSC frequency */
+uint32 arch_timer_get_cycles_khz(void)
+{
+    return tsc_khz;
+}
+
+/* convert TSC cycles into microseconds */
+bigtime_t arch_timer_cycles_to_usec(bigtime_t cycles)
+{
+    uint64 c = (uint64)cycles;
+
+    if(!tsc_khz || cycles <= 0)
+        return 0;
+
+    /* split to avoid overflow on large values */
+    return (bigtime_t)((c / tsc_khz) * 1000 + ((c % tsc_khz) * 1000) / tsc_khz);
+}
+
+/* convert TSC cycles into nanoseconds */
+bigtime_t arch_timer_cycles_to_nsec(bigtime_t cycles)
+{
+    uint64 c = (uint64)cycles;
+
+    if(!tsc_khz || cycles <= 0)
+        return 0;
+
+    /* split to avoid overflow on large values */
+    return (bigtime_t)((c / tsc_khz) * 1000000 + ((c % tsc_khz) * 1000000) / tsc_khz);
+}
@@ -61,6 +61,23 @@ status_t arch_vm_init_final(kernel_args_t *kargs)
 
     /* init page reference counter */
     err = vm_page_init_wire_counters(kargs->arch_args.virt_idt, PAGE_SIZE);
+    if(err != NO_ERROR)
+        return err;
+
+    /* reserve virtual space of APICs mapped by kinit.
+     * there are no physical pages behind APIC registers,
+     * so memory holes are used instead of objects.
+     */
+    if(kargs->arch_args.apic != NULL) {
+        err = vm_create_memory_hole(kid, (addr_t)kargs->arch_args.apic, PAGE_SIZE);
+        if(err != NO_ERROR)
+            return err;
+    }
+    if(kargs->arch_args.ioapic != NULL) {
+        err = vm_create_memory_hole(kid, (addr_t)kargs->arch_args.ioapic, PAGE_SIZE);
+        if(err != NO_ERROR)
+            return err;
+    }
 
     return NO_ERROR;
 }
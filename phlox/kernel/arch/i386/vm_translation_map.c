@@ -21,6 +21,7 @@
 #include <phlox/vm.h>
 #include <phlox/vm_names.h>
 #include <phlox/vm_page_mapper.h>
+#include <phlox/smp.h>
 
 /* Kernel's page directory */
 static mmu_pde *kernel_pgdir_phys = NULL; /* Physical address */
@@ -511,6 +512,13 @@ static void flush_tmap(vm_translation_map_t *tmap)
                            tmap->arch.num_invalidate_pages);
     }
 
+    /* other processors must drop their entries too */
+    if(tmap->arch.num_invalidate_pages == 1)
+        smp_send_broadcast_ici(SMP_MSG_INVALIDATE_TLB_ENTRY,
+                               tmap->arch.pages_to_invalidate[0]);
+    else
+        smp_send_broadcast_ici(SMP_MSG_INVALIDATE_TLB, 0);
+
     tmap->arch.num_invalidate_pages = 0;
     
     /* restore previous irqs state */
@@ -598,6 +606,7 @@ static status_t map_pool_chunk(addr_t pa, addr_t va)
 
     /* invalidate newly mapped address in TLB */
     invalidate_TLB_entry(va);
+    smp_send_broadcast_ici(SMP_MSG_INVALIDATE_TLB_ENTRY, va);
 
     return NO_ERROR;
 }
@@ -0,0 +1,317 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <sys/debug.h>
+#include <phlox/kernel.h>
+#include <phlox/errors.h>
+#include <phlox/processor.h>
+#include <phlox/list.h>
+#include <phlox/spinlock.h>
+#include <phlox/thread.h>
+#include <phlox/thread_private.h>
+#include <phlox/timer.h>
+#include <phlox/cond.h>
+
+
+/**************************************************
+ * Types definitions
+ **************************************************/
+
+/* Control block for waiting thread */
+typedef struct {
+    spinlock_t  *lock;      /* lock of waited object */
+    xlist_t     *waiters;   /* waiters list of waited object */
+    thread_t    *thread;    /* waiting thread */
+    bool        queued;     /* true while in waiters list */
+    timeout_id  timeout;    /* timeout call id */
+    status_t    err;        /* wakeup status to return to thread */
+    list_elem_t list_node;  /* list node inside waiters list */
+} cond_wcb_t;
+
+
+/**************************************************
+ * Internally used routines
+ **************************************************/
+
+/* put control block of current thread into waiters list.
+ * object must be locked by caller.
+ */
+static void wcb_enqueue(cond_wcb_t *wcb, spinlock_t *lock, xlist_t *waiters)
+{
+    wcb->lock = lock;
+    wcb->waiters = waiters;
+    wcb->thread = thread_get_current_thread();
+    wcb->timeout = INVALID_TIMEOUTID;
+    wcb->err = NO_ERROR;
+
+    xlist_add_last(waiters, &wcb->list_node);
+    wcb->queued = true;
+}
+
+/* remove control block from waiters list and wake up its thread.
+ * object must be locked by caller.
+ */
+static void wcb_wake(cond_wcb_t *wcb, status_t err)
+{
+    thread_t *thread = wcb->thread;
+
+    xlist_remove_unsafe(wcb->waiters, &wcb->list_node);
+    wcb->queued = false;
+    wcb->err = err;
+
+    thread_lock_thread(thread);
+    if(thread->state == THREAD_STATE_WAITING)
+        sched_add_thread(thread);
+    else if(thread->next_state == THREAD_STATE_WAITING)
+        thread->next_state = THREAD_STATE_READY; /* not switched out yet */
+    thread_unlock_thread(thread);
+}
+
+/* wake up all waiters in one pass. object must be locked by caller. */
+static void wcb_wake_all(xlist_t *waiters)
+{
+    list_elem_t *e;
+
+    while((e = xlist_peek_first(waiters)) != NULL)
+        wcb_wake(containerof(e, cond_wcb_t, list_node), NO_ERROR);
+}
+
+/* called on thread death */
+static void wcb_thread_callback(thread_cbd_t *cb)
+{
+    cond_wcb_t *wcb = (cond_wcb_t*)cb->data;
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(wcb->lock);
+    if(wcb->queued) {
+        xlist_remove_unsafe(wcb->waiters, &wcb->list_node);
+        wcb->queued = false;
+    }
+    spin_unlock_irqrstor(wcb->lock, irqs_state);
+}
+
+/* timeout handler routine */
+static void wcb_timeout_callback(timeout_id id, void *data)
+{
+    cond_wcb_t *wcb = (cond_wcb_t*)data;
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(wcb->lock);
+
+    /* thread may be already woken up */
+    if(wcb->queued)
+        wcb_wake(wcb, ERR_CND_TIMEOUT);
+
+    spin_unlock_irqrstor(wcb->lock, irqs_state);
+}
+
+/* block current thread until its control block is woken up.
+ * control block must be queued, object lock must not be held.
+ */
+static status_t wcb_block(cond_wcb_t *wcb, uint timeout_msec)
+{
+    unsigned long irqs_state;
+    thread_cbd_t tcb;
+
+    irqs_state = spin_lock_irqsave(wcb->lock);
+
+    /* already woken up */
+    if(!wcb->queued) {
+        spin_unlock_irqrstor(wcb->lock, irqs_state);
+        return wcb->err;
+    }
+
+    /* register timeout callback */
+    if(timeout_msec) {
+        wcb->timeout = timer_timeout_sched( wcb_timeout_callback, wcb,
+            TIMER_MSEC_TO_TICKS(timeout_msec) );
+        if(wcb->timeout == INVALID_TIMEOUTID) {
+            xlist_remove_unsafe(wcb->waiters, &wcb->list_node);
+            wcb->queued = false;
+            spin_unlock_irqrstor(wcb->lock, irqs_state);
+            return ERR_CND_GENERAL;
+        }
+    }
+
+    /* set up thread callback data */
+    thread_get_current_thread_locked();
+    tcb.thread = wcb->thread;
+    tcb.func = &wcb_thread_callback;
+    tcb.data = wcb;
+
+    /* set next state to WAITING and register callback */
+    wcb->thread->next_state = THREAD_STATE_WAITING;
+    thread_register_term_cb(&tcb);
+
+    /* unlock thread and object */
+    thread_unlock_thread(wcb->thread);
+    spin_unlock(wcb->lock);
+    local_irqs_restore(irqs_state);
+
+    /* reschedule */
+    thread_yield();
+
+    /* control returns here after wake up */
+    local_irqs_save_and_disable(irqs_state);
+    thread_get_current_thread_locked();
+    thread_unregister_term_cb(&tcb);
+    thread_unlock_thread(wcb->thread);
+    local_irqs_restore(irqs_state);
+
+    /* unregister timeout call if needed */
+    if(wcb->timeout != INVALID_TIMEOUTID)
+        timer_timeout_cancel_sync(wcb->timeout);
+
+    return wcb->err;
+}
+
+
+/**************************************************
+ * Condition variables
+ **************************************************/
+
+/* init condition variable */
+void cond_init(cond_t *cond)
+{
+    spin_init(&cond->lock);
+    xlist_init(&cond->waiters);
+}
+
+/* wait for condition with timeout */
+status_t cond_wait_timeout(cond_t *cond, mutex_t *mtx, uint timeout_msec)
+{
+    unsigned long irqs_state;
+    cond_wcb_t wcb;
+    status_t err;
+
+    /* become waiter before mutex release, so signal sent
+     * after release is never missed.
+     */
+    irqs_state = spin_lock_irqsave(&cond->lock);
+    wcb_enqueue(&wcb, &cond->lock, &cond->waiters);
+    spin_unlock_irqrstor(&cond->lock, irqs_state);
+
+    err = mutex_unlock(mtx);
+    if(err != NO_ERROR) {
+        irqs_state = spin_lock_irqsave(&cond->lock);
+        if(wcb.queued)
+            xlist_remove_unsafe(&cond->waiters, &wcb.list_node);
+        spin_unlock_irqrstor(&cond->lock, irqs_state);
+        return err;
+    }
+
+    err = wcb_block(&wcb, timeout_msec);
+
+    /* acquire mutex back */
+    mutex_lock(mtx);
+
+    return err;
+}
+
+/* wait for condition */
+status_t cond_wait(cond_t *cond, mutex_t *mtx)
+{
+    return cond_wait_timeout(cond, mtx, 0);
+}
+
+/* wake up single waiter */
+void cond_signal(cond_t *cond)
+{
+    unsigned long irqs_state;
+    list_elem_t *e;
+
+    irqs_state = spin_lock_irqsave(&cond->lock);
+
+    e = xlist_peek_first(&cond->waiters);
+    if(e != NULL)
+        wcb_wake(containerof(e, cond_wcb_t, list_node), NO_ERROR);
+
+    spin_unlock_irqrstor(&cond->lock, irqs_state);
+}
+
+/* wake up all waiters */
+void cond_broadcast(cond_t *cond)
+{
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(&cond->lock);
+    wcb_wake_all(&cond->waiters);
+    spin_unlock_irqrstor(&cond->lock, irqs_state);
+}
+
+
+/**************************************************
+ * Events
+ **************************************************/
+
+/* init event */
+void event_init(event_t *ev, flags_t flags)
+{
+    spin_init(&ev->lock);
+    ev->manual = (flags & EVENT_FLAG_MANUAL_RESET) != 0;
+    ev->state = (flags & EVENT_FLAG_SET) != 0;
+    xlist_init(&ev->waiters);
+}
+
+/* wait for event with timeout */
+status_t event_wait_timeout(event_t *ev, uint timeout_msec)
+{
+    unsigned long irqs_state;
+    cond_wcb_t wcb;
+
+    irqs_state = spin_lock_irqsave(&ev->lock);
+
+    /* event is set, take it */
+    if(ev->state) {
+        if(!ev->manual)
+            ev->state = false;
+        spin_unlock_irqrstor(&ev->lock, irqs_state);
+        return NO_ERROR;
+    }
+
+    wcb_enqueue(&wcb, &ev->lock, &ev->waiters);
+    spin_unlock_irqrstor(&ev->lock, irqs_state);
+
+    return wcb_block(&wcb, timeout_msec);
+}
+
+/* wait for event */
+status_t event_wait(event_t *ev)
+{
+    return event_wait_timeout(ev, 0);
+}
+
+/* set event */
+void event_set(event_t *ev)
+{
+    unsigned long irqs_state;
+    list_elem_t *e;
+
+    irqs_state = spin_lock_irqsave(&ev->lock);
+
+    if(ev->manual) {
+        /* release everybody and stay set */
+        ev->state = true;
+        wcb_wake_all(&ev->waiters);
+    } else {
+        /* release single waiter or stay set until next wait */
+        e = xlist_peek_first(&ev->waiters);
+        if(e != NULL)
+            wcb_wake(containerof(e, cond_wcb_t, list_node), NO_ERROR);
+        else
+            ev->state = true;
+    }
+
+    spin_unlock_irqrstor(&ev->lock, irqs_state);
+}
+
+/* reset event */
+void event_reset(event_t *ev)
+{
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(&ev->lock);
+    ev->state = false;
+    spin_unlock_irqrstor(&ev->lock, irqs_state);
+}
@@ -0,0 +1,272 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <sys/debug.h>
+#include <phlox/kernel.h>
+#include <phlox/errors.h>
+#include <phlox/processor.h>
+#include <phlox/list.h>
+#include <phlox/spinlock.h>
+#include <phlox/thread.h>
+#include <phlox/thread_private.h>
+#include <phlox/timer.h>
+#include <phlox/futex.h>
+
+
+/**************************************************
+ * Macro definitions
+ **************************************************/
+
+/* Waiters hash table size (must be power of 2) */
+#define FUTEX_HASH_SIZE  64
+
+/* Hash function for waiter key */
+#define FUTEX_HASH(proc, uaddr) \
+    ( (((addr_t)(uaddr) >> 2) ^ ((addr_t)(proc) >> 4)) & (FUTEX_HASH_SIZE-1) )
+
+
+/**************************************************
+ * Futexes types definitions
+ **************************************************/
+
+/* Hash table bucket */
+typedef struct {
+    spinlock_t lock;     /* bucket lock */
+    xlist_t    waiters;  /* list of waiting threads */
+} futex_bucket_t;
+
+/* Control block for waiting thread */
+typedef struct {
+    futex_bucket_t *bucket;     /* owner bucket */
+    process_t      *proc;       /* key: owner process */
+    addr_t         uaddr;       /* key: user space address */
+    thread_t       *thread;     /* waiting thread */
+    bool           queued;      /* true while in waiters list */
+    timeout_id     timeout;     /* timeout call id */
+    status_t       err;         /* wakeup status to return to thread */
+    list_elem_t    list_node;   /* list node inside waiters list of bucket */
+} futex_wcb_t;
+
+
+/**************************************************
+ * Internally used data structures
+ **************************************************/
+
+/* Waiters hash table */
+static futex_bucket_t futex_table[FUTEX_HASH_SIZE];
+
+
+/**************************************************
+ * Internally used routines
+ **************************************************/
+
+/* remove control block from bucket and wake up its thread.
+ * bucket must be locked by caller.
+ */
+static void futex_wake_wcb(futex_wcb_t *wcb, status_t err)
+{
+    thread_t *thread = wcb->thread;
+
+    xlist_remove_unsafe(&wcb->bucket->waiters, &wcb->list_node);
+    wcb->queued = false;
+    wcb->err = err;
+
+    thread_lock_thread(thread);
+    if(thread->state == THREAD_STATE_WAITING)
+        sched_add_thread(thread);
+    else if(thread->next_state == THREAD_STATE_WAITING)
+        thread->next_state = THREAD_STATE_READY; /* not switched out yet */
+    thread_unlock_thread(thread);
+}
+
+/* called on thread death */
+static void futex_thread_callback(thread_cbd_t *cb)
+{
+    futex_wcb_t *wcb = (futex_wcb_t*)cb->data;
+    unsigned long irqs_state;
+
+    /* remove thread control block from waiters list */
+    irqs_state = spin_lock_irqsave(&wcb->bucket->lock);
+    if(wcb->queued) {
+        xlist_remove_unsafe(&wcb->bucket->waiters, &wcb->list_node);
+        wcb->queued = false;
+    }
+    spin_unlock_irqrstor(&wcb->bucket->lock, irqs_state);
+}
+
+/* timeout handler routine */
+static void futex_timeout_callback(timeout_id id, void *data)
+{
+    futex_wcb_t *wcb = (futex_wcb_t*)data;
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(&wcb->bucket->lock);
+
+    /* thread may be already woken up */
+    if(wcb->queued)
+        futex_wake_wcb(wcb, ERR_FTX_TIMEOUT);
+
+    spin_unlock_irqrstor(&wcb->bucket->lock, irqs_state);
+}
+
+
+/**************************************************
+ * Public routines
+ **************************************************/
+
+/* init futexes */
+status_t futex_init(kernel_args_t *kargs)
+{
+    uint i;
+
+    for(i = 0; i < FUTEX_HASH_SIZE; ++i) {
+        spin_init(&futex_table[i].lock);
+        xlist_init(&futex_table[i].waiters);
+    }
+
+    return NO_ERROR;
+}
+
+/* block while word keeps expected value */
+status_t futex_wait(addr_t uaddr, int val, uint timeout_msec)
+{
+    unsigned long irqs_state;
+    futex_wcb_t wcb;
+    thread_cbd_t tcb;
+    status_t err;
+    int curr_val;
+
+    /* word must be aligned and be in user space */
+    if(uaddr & (sizeof(int)-1))
+        return ERR_INVALID_ARGS;
+    if(!is_user_address(uaddr) || !is_user_address(uaddr + sizeof(int) - 1))
+        return ERR_INVALID_ARGS;
+
+    /* read word and fault its page in, if needed */
+    err = cpy_from_uspace(&curr_val, (void*)uaddr, sizeof(int));
+    if(err != NO_ERROR)
+        return err;
+    if(curr_val != val)
+        return ERR_FTX_WOULD_BLOCK;
+
+    /* fill control block */
+    wcb.proc = thread_get_current_thread()->process;
+    wcb.uaddr = uaddr;
+    wcb.bucket = &futex_table[ FUTEX_HASH(wcb.proc, uaddr) ];
+    wcb.thread = thread_get_current_thread();
+    wcb.queued = false;
+    wcb.timeout = INVALID_TIMEOUTID;
+    wcb.err = NO_ERROR;
+
+    /* put control block into bucket before second check of word.
+     * waker changing word after the check finds us queued. waker
+     * finding us before we are blocked just cancels blocking.
+     */
+    irqs_state = spin_lock_irqsave(&wcb.bucket->lock);
+    xlist_add_last(&wcb.bucket->waiters, &wcb.list_node);
+    wcb.queued = true;
+    spin_unlock_irqrstor(&wcb.bucket->lock, irqs_state);
+
+    /* check word again. user memory is never touched while
+     * holding spinlocks, as other thread may unmap it.
+     */
+    err = cpy_from_uspace(&curr_val, (void*)uaddr, sizeof(int));
+    if(err != NO_ERROR || curr_val != val) {
+        irqs_state = spin_lock_irqsave(&wcb.bucket->lock);
+        if(wcb.queued) {
+            xlist_remove_unsafe(&wcb.bucket->waiters, &wcb.list_node);
+            wcb.queued = false;
+            if(err == NO_ERROR)
+                err = ERR_FTX_WOULD_BLOCK;
+        } else
+            err = wcb.err; /* already woken up */
+        spin_unlock_irqrstor(&wcb.bucket->lock, irqs_state);
+        return err;
+    }
+
+    irqs_state = spin_lock_irqsave(&wcb.bucket->lock);
+
+    /* woken up while checking word */
+    if(!wcb.queued) {
+        spin_unlock_irqrstor(&wcb.bucket->lock, irqs_state);
+        return wcb.err;
+    }
+
+    thread_lock_thread(wcb.thread);
+
+    /* register timeout callback */
+    if(timeout_msec) {
+        wcb.timeout = timer_timeout_sched( futex_timeout_callback, &wcb,
+            TIMER_MSEC_TO_TICKS(timeout_msec) );
+        if(wcb.timeout == INVALID_TIMEOUTID) {
+            xlist_remove_unsafe(&wcb.bucket->waiters, &wcb.list_node);
+            wcb.queued = false;
+            thread_unlock_thread(wcb.thread);
+            spin_unlock_irqrstor(&wcb.bucket->lock, irqs_state);
+            return ERR_FTX_GENERAL;
+        }
+    }
+
+    /* set up thread callback data */
+    tcb.thread = wcb.thread;
+    tcb.func = &futex_thread_callback;
+    tcb.data = &wcb;
+
+    /* set next state to WAITING and register callback */
+    wcb.thread->next_state = THREAD_STATE_WAITING;
+    thread_register_term_cb(&tcb);
+
+    /* unlock thread and bucket */
+    thread_unlock_thread(wcb.thread);
+    spin_unlock(&wcb.bucket->lock);
+    local_irqs_restore(irqs_state);
+
+    /* reschedule */
+    thread_yield();
+
+    /* control returns here after wake up */
+    local_irqs_save_and_disable(irqs_state);
+    thread_get_current_thread_locked();
+    thread_unregister_term_cb(&tcb);
+    thread_unlock_thread(wcb.thread);
+    local_irqs_restore(irqs_state);
+
+    /* unregister timeout call if needed */
+    if(wcb.timeout != INVALID_TIMEOUTID)
+        timer_timeout_cancel_sync(wcb.timeout);
+
+    return wcb.err;
+}
+
+/* wake up threads blocked on word */
+int futex_wake(addr_t uaddr, uint count)
+{
+    process_t *proc = thread_get_current_thread()->process;
+    futex_bucket_t *bucket = &futex_table[ FUTEX_HASH(proc, uaddr) ];
+    unsigned long irqs_state;
+    list_elem_t *e, *next;
+    int woken = 0;
+
+    /* word must be aligned */
+    if(uaddr & (sizeof(int)-1))
+        return ERR_INVALID_ARGS;
+
+    irqs_state = spin_lock_irqsave(&bucket->lock);
+
+    /* wake up waiters in order of arrival */
+    for(e = xlist_peek_first(&bucket->waiters); e != NULL && (uint)woken < count; e = next) {
+        futex_wcb_t *wcb = containerof(e, futex_wcb_t, list_node);
+        next = e->next;
+
+        if(wcb->proc != proc || wcb->uaddr != uaddr)
+            continue;
+
+        futex_wake_wcb(wcb, NO_ERROR);
+        woken++;
+    }
+
+    spin_unlock_irqrstor(&bucket->lock, irqs_state);
+
+    return woken;
+}
@@ -18,9 +18,13 @@
 #include <phlox/process.h>
 #include <phlox/thread.h>
 #include <phlox/sem.h>
+#include <phlox/futex.h>
+#include <phlox/rcu.h>
+#include <phlox/workqueue.h>
 #include <phlox/klog.h>
 #include <phlox/debug.h>
 #include <phlox/imgload.h>
+#include <phlox/smp.h>
 
 
 #define PRINT_KERNEL_MMAP 0
@@ -46,6 +50,11 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
 {
     status_t err;
 
+    /* non-boot processors wait here until bootstrap
+     * processor completes kernel initialization.
+     */
+    smp_trap_non_boot_cpus(num_cpu);
+
     /* if we are bootstrap processor,
      * store kernel args to global variable and
      * init kernel logging.
@@ -65,8 +74,6 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
 
       /* put hello into klog */
       kprint("\nWelcome to Phlox Kernel! (built at: %s %s)\n", __DATE__, __TIME__);
-    } else {
-       /* wait until BSP completes its job? */
     }
 
 
@@ -85,6 +92,9 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
        /* init interrupt handling */
        interrupt_init(&globalKargs);
 
+       /* init deferred reclamation */
+       rcu_init(&globalKargs);
+
        /* init virtual memory manager */
        vm_init(&globalKargs);
 
@@ -93,8 +103,11 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
 
        /* system timer init */
        timer_init(&globalKargs);
-    } else {
-       /* wait until BSP completes? */
+
+       /* multiprocessor support init */
+       err = smp_init(&globalKargs);
+       if(err != NO_ERROR)
+           panic("SMP initialization failed!\n");
     }
 
 
@@ -106,6 +119,11 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
     if(err != NO_ERROR)
         panic("Threading initialization stage failed!\n");
 
+    /* per cpu multiprocessor support init */
+    err = smp_init_per_cpu(&globalKargs, num_cpu);
+    if(err != NO_ERROR)
+        panic("SMP initialization failed on CPU #%d!\n", num_cpu);
+
     /* continue initialization of modules that requires threading.
      * initialization goes only on bootstrap processor, others - waiting.
     */
@@ -120,52 +138,68 @@ void _phlox_kernel_entry(kernel_args_t *kargs, uint num_cpu)
         if(err != NO_ERROR)
             panic("Heap post-threading init failed!\n");
 
+        /* create deferred work workers */
+        err = workqueue_init(&globalKargs);
+        if(err != NO_ERROR)
+            panic("Workqueue initialization failed!\n");
+
         /* init timer module */
         err = timer_init_after_threading(&globalKargs);
         if(err != NO_ERROR)
             panic("Timer threading dependent part initialization failed!\n");
 
+        /* start deferred reclamation thread */
+        err = rcu_init_after_threading(&globalKargs);
+        if(err != NO_ERROR)
+            panic("RCU threading dependent part initialization failed!\n");
+
         /* init semaphores module */
         err = semaphores_init(&globalKargs);
         if(err != NO_ERROR)
             panic("Semaphores initialization failed!\n");
 
+        /* init futexes module */
+        err = futex_init(&globalKargs);
+        if(err != NO_ERROR)
+            panic("Futexes initialization failed!\n");
+
         /* continue VM init */
         err = vm_init_post_sema(&globalKargs);
         if(err != NO_ERROR)
             panic("VM post-semaphores init failed!\n");
-    } else {
-       /* wait until BSP completes? */
-    }
 
 #if PRINT_KERNEL_MMAP==1
-    /* kernel memory map */
-    print_kernel_memory_map();
+        /* kernel memory map */
+        print_kernel_memory_map();
 #endif
 
-    /* current thread */
-    kprint("\nCurrent thread: id = %d, name = %s\n",
-        thread_get_current_thread()->id,
-        thread_get_current_thread()->name);
-
-    /* create system initialization thread */
-    {
-        thread_id tid;
-        tid = thread_create_kernel_thread("kernel_init_thread", &init_thread, NULL, false);
-        if(tid == INVALID_THREADID)
-            panic("Failed to create system initialization thread.");
-    }
+        /* current thread */
+        kprint("\nCurrent thread: id = %d, name = %s\n",
+            thread_get_current_thread()->id,
+            thread_get_current_thread()->name);
 
-    /* init console writer */
-    debug_init_console_writer();
+        /* create system initialization thread */
+        {
+            thread_id tid;
+            tid = thread_create_kernel_thread("kernel_init_thread", &init_thread, NULL, false);
+            if(tid == INVALID_THREADID)
+                panic("Failed to create system initialization thread.");
+        }
 
-    /* init image loader */
-    err = imgload_init();
-    if(err != NO_ERROR)
-        panic("Failed to init executable image loader with err = %x!\n", err);
+        /* init console writer */
+        debug_init_console_writer();
 
-    /* switch to next kernel start stage */
-    _kernel_start_stage = K_SERVICES_STARTUP;
+        /* init image loader */
+        err = imgload_init();
+        if(err != NO_ERROR)
+            panic("Failed to init executable image loader with err = %x!\n", err);
+
+        /* switch to next kernel start stage */
+        _kernel_start_stage = K_SERVICES_STARTUP;
+
+        /* let other processors continue */
+        smp_wake_up_non_boot_cpus();
+    }
 
     /* enable interrupts */
     local_irqs_enable();
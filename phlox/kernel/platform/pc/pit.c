@@ -18,8 +18,14 @@ uint32 pit_init(void)
 
     spin_init(&pit_lock); /* init spin lock */
 
-    /* init timer */
+    /* init timer. with dynamic tick rate generator mode is used,
+     * its counter decrements by one and may be read at any time.
+     */
+#if SYSCFG_DYNAMIC_TICK
+    pit_set_counter(0, PIT_CW_MODE2 >> 1, cntr_value);
+#else
     pit_set_counter(0, PIT_CW_MODE3 >> 1, cntr_value);
+#endif
 
     return 0;
 }
@@ -91,6 +97,52 @@ uint32 pit_set_counter(uint8 counter, uint8 mode, uint16 value)
     return NO_ERROR;
 }
 
+/* reads counter */
+uint16 pit_get_counter(uint8 counter, uint8 *status)
+{
+    uint32 irq_state;
+    uint8 rbcmd;
+    uint16 dport; /* data port */
+    uint16 value;
+    uint8 stat;
+
+    /* select counter for read-back command and data port */
+    switch(counter) {
+       case 0:
+         rbcmd = PIT_CW_RBCMD_CNTR0;
+         dport = PIT_CNTR0_PORT;
+         break;
+       case 1:
+         rbcmd = PIT_CW_RBCMD_CNTR1;
+         dport = PIT_CNTR1_PORT;
+         break;
+       case 2:
+         rbcmd = PIT_CW_RBCMD_CNTR2;
+         dport = PIT_CNTR2_PORT;
+         break;
+       /* counter number is invalid */
+       default: return 0;
+    }
+
+    /* acquire spinlock  */
+    irq_state = spin_lock_irqsave(&pit_lock);
+
+    /* latch both count and status. status is read first. */
+    out8_p(PIT_CTRL_PORT, PIT_CW_RBCMD | rbcmd);
+    stat = in8_p(dport);
+    /* read LSB, then MSB */
+    value = in8_p(dport);
+    value |= (uint16)in8_p(dport) << 8;
+
+    /* release lock */
+    spin_unlock_irqrstor(&pit_lock, irq_state);
+
+    if(status)
+        *status = stat;
+
+    return value;
+}
+
 /* plug/unplug counter 2 to/from PC speaker */
 void pit_to_spkr(bool v)
 {
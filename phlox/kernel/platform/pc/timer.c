@@ -1,11 +1,26 @@
 /*
-* Copyright 2007-2009, Stepan V.Karpenko. All rights reserved.
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
 * Distributed under the terms of the PhloxOS License.
 */
 #include <phlox/errors.h>
 #include <phlox/types.h>
+#include <phlox/param.h>
 #include <phlox/interrupt.h>
 #include <phlox/timer.h>
+#include <phlox/platform/pc/pit.h>
+
+
+#if SYSCFG_DYNAMIC_TICK
+/* PIT clocks per timer tick */
+#define PIT_TICK_CLOCKS  (SYS_CLOCK_RATE / HZ)
+
+/* One-shot mode state */
+static bool oneshot_mode = false;  /* timer is in one-shot mode */
+static uint16 oneshot_clocks = 0;  /* clocks programmed */
+static uint32 clocks_debt = 0;     /* clocks elapsed, but not counted as ticks */
+
+static uint32 oneshot_elapsed_clocks(bool *expired);
+#endif
 
 
 /* timer interrupt handler */
@@ -25,3 +40,100 @@ status_t platform_timer_init(kernel_args_t *kargs)
 
     return err;
 }
+
+#if SYSCFG_DYNAMIC_TICK
+
+/* max ticks count for one-shot mode */
+uint platform_timer_oneshot_max(void)
+{
+    return 0xffff / PIT_TICK_CLOCKS;
+}
+
+/* switch timer into one-shot mode */
+void platform_timer_oneshot(uint ticks)
+{
+    uint16 count;
+
+    /* part of current period elapsed is not counted yet */
+    count = pit_get_counter(0, NULL);
+    if(count <= PIT_TICK_CLOCKS)
+        clocks_debt += PIT_TICK_CLOCKS - count;
+
+    /* interrupt must occur on tick boundary */
+    oneshot_clocks = ticks * PIT_TICK_CLOCKS - (clocks_debt % PIT_TICK_CLOCKS);
+
+    /* interrupt on terminal count mode */
+    pit_set_counter(0, PIT_CW_MODE0 >> 1, oneshot_clocks);
+    oneshot_mode = true;
+}
+
+/* switch timer into one-shot mode for given nanoseconds */
+void platform_timer_oneshot_nsec(bigtime_t nsec)
+{
+    uint64 clocks;
+    uint32 elapsed;
+    uint16 count;
+    bool expired;
+
+    if(oneshot_mode) {
+        /* account clocks elapsed, pending interrupt is handled as is */
+        elapsed = oneshot_elapsed_clocks(&expired);
+        if(expired)
+            return;
+        clocks_debt += elapsed;
+    } else {
+        /* part of current period elapsed is not counted yet */
+        count = pit_get_counter(0, NULL);
+        if(count <= PIT_TICK_CLOCKS)
+            clocks_debt += PIT_TICK_CLOCKS - count;
+    }
+
+    /* convert to PIT clocks, rounding up */
+    clocks = (nsec > 0) ? ((uint64)nsec * SYS_CLOCK_RATE + TIMER_NSEC_PER_SEC - 1) / TIMER_NSEC_PER_SEC : 1;
+    oneshot_clocks = (clocks < 0xffff) ? (uint16)clocks : 0xffff;
+
+    /* interrupt on terminal count mode */
+    pit_set_counter(0, PIT_CW_MODE0 >> 1, oneshot_clocks);
+    oneshot_mode = true;
+}
+
+/* returns clocks elapsed in one-shot mode */
+static uint32 oneshot_elapsed_clocks(bool *expired)
+{
+    uint8 status;
+    uint16 count = pit_get_counter(0, &status);
+
+    /* counter wraps and continues counting after terminal count */
+    if(status & PIT_RBCMD_STAT_OUTPUT) {
+        *expired = true;
+        return oneshot_clocks + (uint16)(0 - count);
+    } else {
+        *expired = false;
+        return oneshot_clocks - count;
+    }
+}
+
+/* ticks elapsed since one-shot mode started */
+uint platform_timer_oneshot_elapsed(bool *expired)
+{
+    return (clocks_debt + oneshot_elapsed_clocks(expired)) / PIT_TICK_CLOCKS;
+}
+
+/* switch timer back into periodic mode */
+uint platform_timer_periodic(bool *expired)
+{
+    uint ticks;
+
+    /* count whole ticks elapsed, keep the rest for later */
+    clocks_debt += oneshot_elapsed_clocks(expired);
+    ticks = clocks_debt / PIT_TICK_CLOCKS;
+    clocks_debt %= PIT_TICK_CLOCKS;
+
+    /* rate generator mode */
+    pit_set_counter(0, PIT_CW_MODE2 >> 1, PIT_TICK_CLOCKS);
+    oneshot_mode = false;
+
+    return ticks;
+}
+
+#endif
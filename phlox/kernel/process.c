@@ -7,11 +7,14 @@
 #include <phlox/errors.h>
 #include <phlox/param.h>
 #include <phlox/heap.h>
-#include <phlox/avl_tree.h>
+#include <phlox/hash_table.h>
 #include <phlox/list.h>
 #include <phlox/atomic.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
+#include <phlox/rcu.h>
 #include <phlox/vm.h>
+#include <phlox/timer.h>
 #include <phlox/thread.h>
 #include <phlox/process.h>
 #include <phlox/thread_private.h>
@@ -20,17 +23,23 @@
 /* Redefinition for convenience */
 typedef xlist_t processes_list_t;
 
+/* Buckets count of processes hash table */
+#define PROCESSES_HASH_SIZE  64
+
 /* Next available process id */
 static vuint next_process_id;
 
 /* Processes list */
 static processes_list_t processes_list;
 
-/* Processes tree for fast search by id */
-static avl_tree_t processes_tree;
+/* Processes hash table for fast search by id.
+ * Lookups are lockless inside RCU read-side sections.
+ */
+static hash_table_t processes_hash;
+static addr_t processes_hash_area[HASH_TABLE_STATIC_SIZE(PROCESSES_HASH_SIZE) / sizeof(addr_t)];
 
-/* Spinlock for operations on processes list / tree */
-static spinlock_t processes_lock;
+/* Lock for modifications of processes list / hash table */
+static rwlock_t processes_lock;
 
 /* Kernel process */
 static process_t *kernel_process = NULL;
@@ -66,14 +75,17 @@ static struct {
 
 /*** Locally used routines ***/
 
-/* compare routine for processes AVL tree */
-static int compare_process_id(const void *p1, const void *p2)
+/* compare routine for processes hash table */
+static int compare_process_id(const void *elem, const void *key)
 {
-    if( ((process_t *)p1)->id > ((process_t *)p2)->id )
-        return 1;
-    if( ((process_t *)p1)->id < ((process_t *)p2)->id )
-        return -1;
-    return 0;
+    return ((process_t *)elem)->id != *(const proc_id *)key;
+}
+
+/* hash routine for processes hash table */
+static uint32 hash_process_id(const void *elem, const void *key, uint range)
+{
+    proc_id pid = elem ? ((process_t *)elem)->id : *(const proc_id *)key;
+    return pid % range;
 }
 
 /* returns available process id */
@@ -96,17 +108,19 @@ static void put_process_to_list(process_t *process)
     unsigned long irqs_state;
 
     /* acquire lock before touching bookkeeping structures */
-    irqs_state = spin_lock_irqsave(&processes_lock);
+    irqs_state = rw_write_lock_irqsave(&processes_lock);
 
     /* add item */
     xlist_add_last(&processes_list, &process->procs_list_node);
 
-    /* put process into avl tree */
-    if(!avl_tree_add(&processes_tree, process))
-      panic("put_process_to_list(): failed to add process into tree!\n");
+    /* processes list owns one reference until process destruction */
+    atomic_inc((atomic_t*)&process->ref_count);
+
+    /* put process into hash table */
+    hash_table_insert(processes_hash, process);
 
     /* release lock */
-    spin_unlock_irqrstor(&processes_lock, irqs_state);
+    rw_write_unlock_irqrstor(&processes_lock, irqs_state);
 }
 
 /* remove process from list */
@@ -115,17 +129,19 @@ static void remove_process_from_list(process_t *process)
     unsigned long irqs_state;
 
     /* acquire lock before access */
-    irqs_state = spin_lock_irqsave(&processes_lock);
+    irqs_state = rw_write_lock_irqsave(&processes_lock);
 
     /* remove process */
     xlist_remove_unsafe(&processes_list, &process->procs_list_node);
 
-    /* remove process from tree */
-    if(!avl_tree_remove(&processes_tree, process))
-      panic("remove_process_from_list(): failed to remove process from tree!\n");
+    /* remove process from hash table.
+     * NOTE: structure must be freed with call_rcu() after that.
+     */
+    if(hash_table_remove(processes_hash, process))
+      panic("remove_process_from_list(): failed to remove process from hash table!\n");
 
     /* release lock */
-    spin_unlock_irqrstor(&processes_lock, irqs_state);
+    rw_write_unlock_irqrstor(&processes_lock, irqs_state);
 }
 
 /* common routine for creating processes */
@@ -180,16 +196,27 @@ error:
     return NULL; /* failed to create process structure */
 }
 
-/* common routine for destroying processes */
-static void destroy_process_common(process_t *proc)
+/* frees process structure after grace period */
+static void free_process_rcu(rcu_head_t *head)
 {
-    /* NOTE: proc should be empty structure (without threads and etc.)! */
+    process_t *proc = containerof(head, process_t, rcu);
 
     if(proc->name) kfree(proc->name);
     if(proc->args) kfree(proc->args);
     kfree(proc);
 }
 
+/* common routine for destroying processes */
+static void destroy_process_common(process_t *proc)
+{
+    /* NOTE: proc should be empty structure (without threads and etc.)! */
+
+    /* lockless lookups may still access structure, so it
+     * is freed after grace period.
+     */
+    call_rcu(&proc->rcu, free_process_rcu);
+}
+
 
 /*** Public routines ***/
 
@@ -208,15 +235,15 @@ status_t process_init(kernel_args_t *kargs)
     next_process_id = 1;
 
     /* data structures spinlock init */
-    spin_init(&processes_lock);
+    rw_init(&processes_lock);
 
     /* list init */
     xlist_init(&processes_list);
 
-    /* tree init */
-    avl_tree_create( &processes_tree, compare_process_id,
-                     sizeof(process_t),
-                     offsetof(process_t, procs_tree_node) );
+    /* hash table init */
+    processes_hash = hash_table_init_static( processes_hash_area, sizeof(processes_hash_area),
+                                             offsetof(process_t, procs_hash_node),
+                                             compare_process_id, hash_process_id );
 
     /* create kernel process */
     pid = proc_create_kernel_process("kernel_process");
@@ -321,6 +348,10 @@ process_t *proc_create_user_process(const char *name, process_t *parent,
     if(arch_init_process_struct(proc) != NO_ERROR)
         goto error_exit;
 
+    /* map shared time page */
+    if(timer_map_time_page(proc->aid) != NO_ERROR)
+        goto error_exit;
+
     /* add to processes list */
     put_process_to_list(proc);
 
@@ -341,7 +372,7 @@ void proc_attach_thread(process_t *proc, thread_t *thread)
 {
     unsigned long irqs_state;
 
-    ASSERT_MSG(thread->lock != 0,
+    ASSERT_MSG(spin_locked(&thread->lock),
         "proc_attach_thread(): thread was not locked before!");
 
     /* acquire lock before working with process data */
@@ -359,7 +390,7 @@ void proc_detach_thread(process_t *proc, thread_t *thread)
 {
     unsigned long irqs_state;
 
-    ASSERT_MSG(thread->lock != 0,
+    ASSERT_MSG(spin_locked(&thread->lock),
         "proc_detach_thread(): thread was not locked before!");
 
     /* acquire lock before touching process data */
@@ -368,6 +399,10 @@ void proc_detach_thread(process_t *proc, thread_t *thread)
     /* remove thread from list */
     xlist_remove(&proc->threads, &thread->proc_list_node);
 
+    /* keep execution times of exited thread */
+    proc->kernel_time += thread->kernel_time;
+    proc->user_time   += thread->user_time;
+
     /* release lock */
     spin_unlock_irqrstor(&proc->lock, irqs_state);
 }
@@ -381,8 +416,9 @@ status_t proc_destroy_process(proc_id pid)
     if(proc == NULL)
         return ERR_MT_INVALID_HANDLE;
 
-    /* set death state */
-    proc->state = PROCESS_STATE_DEATH;
+    /* set death state, first destroyer also puts reference owned by list */
+    if(atomic_set_ret((atomic_t*)&proc->state, PROCESS_STATE_DEATH) != PROCESS_STATE_DEATH)
+        proc_put_process(proc);
 
     /* put process back, this may force actual destruction */
     proc_put_process(proc);
@@ -414,24 +450,23 @@ process_t *proc_get_kernel_process(void)
 /* returns process structure by its id */
 process_t *proc_get_process_by_id(proc_id pid)
 {
-    process_t *look4, *proc;
-    unsigned int irqs_state;
-
-    /* look for */
-    look4 = containerof(&pid, process_t, id);
+    unsigned long irqs_state;
+    process_t *proc;
 
-    /* acquire lock before tree-search */
-    irqs_state = spin_lock_irqsave(&processes_lock);
+    /* lockless search */
+    irqs_state = rcu_read_lock();
 
     /* search */
-    proc = avl_tree_find(&processes_tree, look4, NULL);
+    proc = hash_table_lookup(processes_hash, &pid);
 
-    /* increment refs count on success search */
-    if(proc && proc->state != PROCESS_STATE_DEATH)
-        atomic_inc((atomic_t*)&proc->ref_count);
+    /* increment refs count on success search, zero count
+     * means that destruction is already started.
+     */
+    if(proc && (proc->state == PROCESS_STATE_DEATH ||
+       !atomic_inc_not_zero((atomic_t*)&proc->ref_count)))
+        proc = NULL;
 
-    /* release lock */
-    spin_unlock_irqrstor(&processes_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return proc;
 }
@@ -457,30 +492,37 @@ process_t *proc_get_current_process(void)
 /* put previously taken process structure */
 void proc_put_process(process_t *proc)
 {
-    /* decrement references count */
-    atomic_dec((atomic_t*)&proc->ref_count);
+    /* decrement references count. processes list owns one reference
+     * until process destruction, so only the one who dropped the last
+     * reference frees the process.
+     */
+    if(atomic_dec_ret((atomic_t*)&proc->ref_count) != 1)
+        return;
 
-    /* TODO: implement additional functionality */
+    /* no new references can be taken since now */
+    remove_process_from_list(proc);
+
+    /* put resources referenced by process */
+    if(proc->aspace) vm_put_aspace(proc->aspace);
+    if(proc->parent) proc_put_process(proc->parent);
 
-    /* NOTE: If ref_count == 0 BIRTH and DEATH processes should be freed. */
+    destroy_process_common(proc);
 }
 
 /* increment references count */
 process_t *proc_inc_refcnt(process_t *proc)
 {
-    unsigned int irqs_state;
+    unsigned long irqs_state;
 
-    /* acquire processes lock */
-    irqs_state = spin_lock_irqsave(&processes_lock);
+    /* structure is not freed while inside read-side section */
+    irqs_state = rcu_read_lock();
 
     /* increment only if not in death state */
-    if(proc->state != PROCESS_STATE_DEATH)
-        atomic_inc((atomic_t*)&proc->ref_count);
-    else
+    if(proc->state == PROCESS_STATE_DEATH ||
+       !atomic_inc_not_zero((atomic_t*)&proc->ref_count))
         proc = NULL;
 
-    /* release lock */
-    spin_unlock_irqrstor(&processes_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return proc;
 }
@@ -528,3 +570,33 @@ vm_address_space_t *proc_get_aspace(process_t *proc)
 
     return (proc->aspace) ? vm_inc_aspace_refcnt(proc->aspace) : NULL;
 }
+
+/* return process execution times */
+void proc_get_times(process_t *proc, bigtime_t *kernel_time, bigtime_t *user_time)
+{
+    unsigned long irqs_state;
+    list_elem_t *item;
+    thread_t *thread;
+
+    ASSERT_MSG(proc->ref_count, "proc_get_times(): ref_count==0!");
+
+    irqs_state = spin_lock_irqsave(&proc->lock);
+
+    /* times of exited threads */
+    *kernel_time = proc->kernel_time;
+    *user_time   = proc->user_time;
+
+    /* add times of live threads. threads are not locked here
+     * (lock order is thread then process), so values are a
+     * snapshot taken on the fly.
+     */
+    item = xlist_peek_first(&proc->threads);
+    while(item) {
+        thread = containerof(item, thread_t, proc_list_node);
+        *kernel_time += thread->kernel_time;
+        *user_time   += thread->user_time;
+        item = xlist_peek_next(item);
+    }
+
+    spin_unlock_irqrstor(&proc->lock, irqs_state);
+}
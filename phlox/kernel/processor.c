@@ -7,6 +7,10 @@
 #include <phlox/kargs.h>
 #include <phlox/errors.h>
 #include <phlox/processor.h>
+#include <phlox/thread.h>
+#include <phlox/scheduler.h>
+#include <phlox/timer.h>
+#include <phlox/smp.h>
 
 
 /* global processor set structure */
@@ -50,8 +54,10 @@ void processor_set_init(kernel_args_t *kargs, uint curr_cpu)
           i++;
        }
     } else {
-       /* currently SMP is not supported */
-       panic("processor_set_init: SMP is not supported!\n");
+       /* processor set is already prepared by bootstrap cpu,
+        * so only processor init needed.
+        */
+       processor_init(&ProcessorSet.processors[curr_cpu], kargs, curr_cpu);
     }
 }
 
@@ -70,8 +76,6 @@ status_t processor_set_init_after_vm(kernel_args_t *kargs, uint curr_cpu)
         if(err != NO_ERROR)
             panic("arch_processor_init_after_vm: FAILED! (CPU%d)\n", curr_cpu);
     } else {
-        /* NOTE: Slave CPUs waiting until bootstrap CPU completes */
-
         /* per processor init */
         err = processor_init_after_vm(&ProcessorSet.processors[curr_cpu], kargs, curr_cpu);
         if(err != NO_ERROR)
@@ -101,21 +105,43 @@ status_t processor_init_after_vm(processor_t *p, kernel_args_t *kargs, uint curr
 
 void processor_idle_cycle(void)
 {
+#if SYSCFG_DYNAMIC_TICK
+    bool resched;
+
+    while(true) {
+        local_irqs_disable();
+
+        /* threads were added while interrupts handling */
+        if(sched_cpu_has_work()) {
+            local_irqs_enable();
+            thread_yield();
+            continue;
+        }
+
+        /* stop timer ticks and cpu until interrupt occurs */
+        timer_idle_enter();
+        safe_halt();
+
+        /* restart ticks, events may wake up some threads */
+        local_irqs_disable();
+        resched = timer_idle_exit();
+        local_irqs_enable();
+
+        if(resched)
+            thread_yield();
+    }
+#else
     while(true)
         safe_halt(); /* stop cpu until interrupt occurs */
+#endif
 }
 
 uint get_current_processor(void)
 {
-    /* As SMP is not currently supported we always return
-     * Bootstrap processor number. With SMP support this
-     * routine might be moved to special SMP module.
-     */
-    return BOOTSTRAP_CPU;
-
-/* And fire compilation error if SMP support requested */
 #if SYSCFG_SMP_SUPPORT
-#  error get_current_processor(): smp not supported!
+    return arch_smp_get_current_cpu();
+#else
+    return BOOTSTRAP_CPU;
 #endif
 }
 
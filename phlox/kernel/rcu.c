@@ -0,0 +1,295 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <sys/debug.h>
+#include <phlox/kernel.h>
+#include <phlox/errors.h>
+#include <phlox/processor.h>
+#include <phlox/spinlock.h>
+#include <phlox/smp.h>
+#include <phlox/thread.h>
+#include <phlox/thread_private.h>
+#include <phlox/scheduler.h>
+#include <phlox/rcu.h>
+
+
+/**************************************************
+ * Macro definitions
+ **************************************************/
+
+/* Grace period polling interval of reclamation thread */
+#define RCU_RECLAIM_POLL_MSEC  10
+
+/* Grace period polling interval of synchronize_rcu() */
+#define RCU_SYNC_POLL_MSEC     1
+
+
+/**************************************************
+ * Types definitions
+ **************************************************/
+
+/* Per cpu state */
+typedef struct {
+    vuint          qs_count;  /* quiescent states passed */
+    vuint          nesting;   /* read-side critical sections nesting */
+    volatile bool  idle;      /* cpu runs its idle thread */
+} rcu_cpu_t;
+
+/* Callbacks queue */
+typedef struct {
+    rcu_head_t *head;   /* first callback */
+    rcu_head_t **tail;  /* next field of last callback */
+} rcu_queue_t;
+
+
+/**************************************************
+ * Internally used data structures
+ **************************************************/
+
+/* Per cpu states */
+static rcu_cpu_t rcu_cpus[SYSCFG_MAX_CPUS];
+
+/* Callbacks queued since current grace period started */
+static rcu_queue_t rcu_next;
+
+/* Callbacks waiting for current grace period */
+static rcu_queue_t rcu_wait;
+
+/* Quiescent states counters snapshot at current grace period start */
+static uint rcu_wait_snap[SYSCFG_MAX_CPUS];
+
+/* Access lock for queues */
+static spinlock_t rcu_lock;
+
+/* Reclamation thread */
+static thread_t *rcu_thread = NULL;
+
+
+/**************************************************
+ * Internally used routines
+ **************************************************/
+
+/* init empty queue */
+static inline void rcu_queue_init(rcu_queue_t *q)
+{
+    q->head = NULL;
+    q->tail = &q->head;
+}
+
+/* take quiescent states snapshot at grace period start */
+static void rcu_take_snapshot(uint *snap)
+{
+    uint i, num_cpus = smp_get_num_cpus();
+
+    /* unlinking of elements must be visible before snapshot */
+    smp_mb();
+
+    for(i = 0; i < num_cpus; i++)
+        snap[i] = rcu_cpus[i].qs_count;
+}
+
+/* returns true if all cpus passed quiescent state after snapshot taken.
+ * caller must not be inside read-side critical section.
+ */
+static bool rcu_grace_period_passed(const uint *snap)
+{
+    uint i, curr_cpu, num_cpus = smp_get_num_cpus();
+    unsigned long irqs_state;
+    bool passed = true;
+
+    local_irqs_save_and_disable(irqs_state);
+    curr_cpu = get_current_processor();
+
+    /* removal of elements must be visible before nesting
+     * counters are read, pairs with rcu_read_lock().
+     */
+    smp_mb();
+
+    for(i = 0; i < num_cpus && passed; i++) {
+        /* current cpu is in quiescent state now */
+        if(i == curr_cpu || !smp_cpu_is_active(i))
+            continue;
+
+        /* cpu switched context or it is idle outside of read-side section */
+        if(rcu_cpus[i].qs_count != snap[i])
+            continue;
+        if(rcu_cpus[i].idle && !rcu_cpus[i].nesting)
+            continue;
+
+        passed = false;
+    }
+
+    local_irqs_restore(irqs_state);
+
+    return passed;
+}
+
+/* advance grace period state. returns queue of callbacks ready to call.
+ * rcu_lock must be held by caller.
+ */
+static rcu_head_t *rcu_advance(void)
+{
+    rcu_head_t *done = NULL;
+
+    /* callbacks waiting for grace period are ready now */
+    if(rcu_wait.head && rcu_grace_period_passed(rcu_wait_snap)) {
+        done = rcu_wait.head;
+        rcu_queue_init(&rcu_wait);
+    }
+
+    /* start new grace period for newly queued callbacks */
+    if(!rcu_wait.head && rcu_next.head) {
+        rcu_wait = rcu_next;
+        rcu_queue_init(&rcu_next);
+        rcu_take_snapshot(rcu_wait_snap);
+    }
+
+    return done;
+}
+
+/* reclamation thread */
+static int rcu_reclaim_thread(void *data)
+{
+    unsigned long irqs_state;
+    rcu_head_t *done, *next;
+    thread_t *thread;
+
+    while(1) {
+        irqs_state = spin_lock_irqsave(&rcu_lock);
+
+        done = rcu_advance();
+
+        /* suspend if nothing to do, will be resumed by call_rcu() */
+        if(!done && !rcu_wait.head) {
+            thread = thread_get_current_thread_locked();
+            thread->next_state = THREAD_STATE_SUSPENDED;
+            thread_unlock_thread(thread);
+            spin_unlock(&rcu_lock);
+            sched_reschedule();
+            /* NOTE: interrupts are reenabled during rescheduling. */
+            continue;
+        }
+
+        spin_unlock_irqrstor(&rcu_lock, irqs_state);
+
+        /* call reclamation routines */
+        for(; done != NULL; done = next) {
+            next = done->next;
+            done->func(done);
+        }
+
+        /* let other cpus pass quiescent states */
+        if(rcu_wait.head)
+            thread_sleep(RCU_RECLAIM_POLL_MSEC);
+    }
+
+    return 0;
+}
+
+
+/**************************************************
+ * Public routines
+ **************************************************/
+
+/* init RCU module */
+status_t rcu_init(kernel_args_t *kargs)
+{
+    spin_init(&rcu_lock);
+    rcu_queue_init(&rcu_next);
+    rcu_queue_init(&rcu_wait);
+
+    return NO_ERROR;
+}
+
+/* start reclamation thread */
+status_t rcu_init_after_threading(kernel_args_t *kargs)
+{
+    thread_id id = thread_create_kernel_thread("rcu_reclaim_thread",
+                        &rcu_reclaim_thread, NULL, false);
+    if(id == INVALID_THREADID)
+        return ERR_MT_GENERAL;
+
+    /* get pointer to thread structure */
+    rcu_thread = thread_get_thread_struct(id);
+    if(rcu_thread == NULL)
+        return ERR_MT_GENERAL;
+
+    return NO_ERROR;
+}
+
+/* enter read-side critical section */
+unsigned long rcu_read_lock(void)
+{
+    unsigned long irqs_state;
+
+    local_irqs_save_and_disable(irqs_state);
+    rcu_cpus[get_current_processor()].nesting++;
+
+    /* nesting must be visible to grace period detection before
+     * any load of read-side section, store may pass later load.
+     */
+    smp_mb();
+
+    return irqs_state;
+}
+
+/* leave read-side critical section */
+void rcu_read_unlock(unsigned long irqs_state)
+{
+    /* complete all loads of read-side section before leaving it */
+    smp_mb();
+
+    rcu_cpus[get_current_processor()].nesting--;
+    local_irqs_restore(irqs_state);
+}
+
+/* note quiescent state of cpu */
+void rcu_note_context_switch(uint cpu, bool idle)
+{
+    ASSERT_MSG(!rcu_cpus[cpu].nesting,
+        "rcu_note_context_switch(): reschedule inside read-side section!\n");
+
+    rcu_cpus[cpu].idle = idle;
+    rcu_cpus[cpu].qs_count++;
+}
+
+/* queue reclamation routine */
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head))
+{
+    unsigned long irqs_state;
+    bool wake;
+
+    head->next = NULL;
+    head->func = func;
+
+    irqs_state = spin_lock_irqsave(&rcu_lock);
+
+    /* add to queue */
+    wake = (rcu_next.head == NULL);
+    *rcu_next.tail = head;
+    rcu_next.tail = &head->next;
+
+    /* wake up reclamation thread if it is suspended */
+    if(wake && rcu_thread) {
+        thread_lock_thread(rcu_thread);
+        if(rcu_thread->state == THREAD_STATE_SUSPENDED)
+            sched_add_thread(rcu_thread);
+        else if(rcu_thread->next_state == THREAD_STATE_SUSPENDED)
+            rcu_thread->next_state = THREAD_STATE_READY; /* not switched out yet */
+        thread_unlock_thread(rcu_thread);
+    }
+
+    spin_unlock_irqrstor(&rcu_lock, irqs_state);
+}
+
+/* wait for grace period */
+void synchronize_rcu(void)
+{
+    uint snap[SYSCFG_MAX_CPUS];
+
+    rcu_take_snapshot(snap);
+
+    while(!rcu_grace_period_passed(snap))
+        thread_sleep(RCU_SYNC_POLL_MSEC);
+}
@@ -7,69 +7,138 @@
 #include <phlox/thread.h>
 #include <phlox/scheduler.h>
 #include <phlox/scheduler_private.h>
+#include <phlox/smp.h>
+#include <phlox/timer.h>
+#include <phlox/rcu.h>
 
 
-/* Scheduling timer state */
-static bigtime_t sched_ticks      = 0;      /* timer ticks counted */
-static vint      sched_lost_ticks = 0;      /* used for counting lost ticks */
-static int       sched_tick_type  = 0;      /* current tick type */
-
-/* Scheduler parameters */
-static int quanta = THREAD_DEFAULT_QUANTA;
-static uint shuffle_factor = THREAD_DEFAULT_QUANTA / SCHED_FACTOR_BMAX;
+/* Timer ticks counted. Advanced by bootstrap cpu only. */
+static bigtime_t sched_ticks = 0;
 
 /* Per cpu run queues */
 static runqueue_t runqueues[SYSCFG_MAX_CPUS];
 
-/*
- * Scheduling lock.
- * Must be acquired before rescheduling operation.
- */
-static spinlock_t sched_lock;
-
 /* Idle threads for each cpu */
 static thread_t *idle_threads[SYSCFG_MAX_CPUS] = { NULL };
 
 
 /*** Locally used routines ***/
 
-/* look at head thread in priority queue */
-static inline thread_t *rq_peek_head_thread(runqueue_t *rq, int prio)
+/* returns true if thread belongs to real-time scheduling class */
+static inline bool thread_is_rt(thread_t *th)
+{
+    return th->sched_class != THREAD_SCHED_NORMAL;
+}
+
+/* returns time quanta for thread in ticks */
+static inline int sched_thread_quanta(runqueue_t *rq, thread_t *th)
+{
+    return SCHED_MSEC2TICKS((th->sched_class == THREAD_SCHED_RR) ? THREAD_RR_QUANTA : rq->quanta);
+}
+
+/* returns priority of thread not counting inherited one */
+static inline int sched_thread_own_prio(thread_t *th)
+{
+    int prio;
+
+    if(thread_is_rt(th))
+        return THREAD_RT_PRIORITY_BASE + th->rt_prio;
+
+    prio = th->s_prio + th->carrots_sticks;
+    if(prio > THREAD_NUM_PRIORITY_LEVELS-1)
+        prio = THREAD_NUM_PRIORITY_LEVELS-1;
+    else if(prio < THREAD_LOWEST_PIORITY)
+        prio = THREAD_LOWEST_PIORITY;
+
+    return prio;
+}
+
+/* mark priority queue as non-empty */
+static inline void rq_bitmap_set(runqueue_t *rq, int prio)
+{
+    rq->prio_bitmap[prio >> 5] |= (1U << (prio & 31));
+    rq->prio_summary |= (1U << (prio >> 5));
+}
+
+/* mark priority queue as empty */
+static inline void rq_bitmap_clear(runqueue_t *rq, int prio)
 {
-    list_elem_t *tmp = xlist_peek_first(&rq->queue[prio]);
+    if( !(rq->prio_bitmap[prio >> 5] &= ~(1U << (prio & 31))) )
+        rq->prio_summary &= ~(1U << (prio >> 5));
+}
+
+/* returns highest non-empty priority queue or -1 if runqueue is empty */
+static inline int rq_highest_prio(runqueue_t *rq)
+{
+    uint word;
+
+    if(!rq->prio_summary)
+        return -1;
+
+    word = arch_sched_find_msb(rq->prio_summary);
+    return (word << 5) + arch_sched_find_msb(rq->prio_bitmap[word]);
+}
+
+/* returns subqueue index for thread within its priority queue.
+ * more significant scheduling policies have greater indexes.
+ */
+static inline int sched_thread_subqueue(thread_t *th)
+{
+    /* real-time queues are strictly ordered, single subqueue used */
+    if(thread_is_rt(th))
+        return SCHED_POLICY_ORDINARY;
+
+    /* NOTE: SCHED_POLICY_INTERACTIVE policy is actual only if process has
+     *       PROCESS_FLAG_INTERACTIVE flag set. If flag is not set
+     *       then SCHED_POLICY_ORDINARY policy is used.
+     */
+    if( th->sched_policy.policy.type == SCHED_POLICY_INTERACTIVE &&
+       !(th->process->flags & PROCESS_FLAG_INTERACTIVE) )
+        return SCHED_POLICY_ORDINARY;
+
+    return th->sched_policy.policy.type;
+}
+
+/* look at head thread in priority subqueue */
+static inline thread_t *rq_peek_head_thread(runqueue_t *rq, int prio, int subq)
+{
+    list_elem_t *tmp = xlist_peek_first(&rq->queue[prio].subq[subq]);
     return containerof(tmp, thread_t, sched_list_node);
 }
 
-/* look at next thread in priority queue */
+/* look at next thread in priority subqueue */
 static inline thread_t *rq_peek_next_thread(thread_t *th)
 {
     list_elem_t *tmp = th->sched_list_node.next;
     return (tmp != NULL) ? containerof(tmp, thread_t, sched_list_node) : NULL;
 }
 
-/* pop head thread from run queue */
-static inline thread_t *rq_pop_head_thread(runqueue_t *rq, int prio)
-{
-    list_elem_t *tmp = xlist_extract_first(&rq->queue[prio]);
-    thread_t *th = containerof(tmp, thread_t, sched_list_node);
-    rq->total_count--; /* decrease count of ready to run threads */
-    return th;
-}
-
 /* extract thread from run queue */
 static inline thread_t *rq_extract_thread(runqueue_t *rq, thread_t *th)
 {
+    sched_queue_t *q = &rq->queue[th->d_prio];
+
+    /* directed yield hint refers only to queued thread */
+    if(rq->handoff == th)
+        rq->handoff = NULL;
+
     /* unsafe version of remove used! */
-    xlist_remove_unsafe(&rq->queue[th->d_prio], &th->sched_list_node);
+    xlist_remove_unsafe(&q->subq[th->sched_subqueue], &th->sched_list_node);
+    if(!q->subq[th->sched_subqueue].count)
+        q->subq_mask &= ~(1U << th->sched_subqueue); /* subqueue became empty */
     rq->total_count--; /* update ready to run threads count */
+    if(!--q->count)
+        rq_bitmap_clear(rq, th->d_prio); /* queue became empty */
     return th;
 }
 
-/* put thread to proper priority queue.
+/* put thread to proper priority queue, at its head if requested.
  * Note: thread must not be contained in other scheduler structures!
  */
-static void rq_put_thread(runqueue_t *rq, thread_t *th)
+static void rq_put_thread_ex(runqueue_t *rq, thread_t *th, bool head)
 {
+    sched_queue_t *q = &rq->queue[th->d_prio];
+
     /* affiliate thread to proper cpu */
     if(th->cpu == NULL || th->cpu->cpu_num != rq->cpu_num)
         th->cpu = &ProcessorSet.processors[rq->cpu_num];
@@ -80,53 +149,26 @@ static void rq_put_thread(runqueue_t *rq, thread_t *th)
         th->sched_list_node.prev == NULL,
         "rq_put_thread(): thread already assigned to list!");
 
+   /* subqueue is chosen once here, so picking next thread
+    * does not need to touch process structures.
+    */
+   th->sched_subqueue = sched_thread_subqueue(th);
+
    /* put to specified runqueue */
-   xlist_add_last(&rq->queue[th->d_prio], &th->sched_list_node);
+   if(head)
+       xlist_add_first(&q->subq[th->sched_subqueue], &th->sched_list_node);
+   else
+       xlist_add_last(&q->subq[th->sched_subqueue], &th->sched_list_node);
+   q->subq_mask |= (1U << th->sched_subqueue);
+   q->count++;
    rq->total_count++; /* update ready to run threads count */
+   rq_bitmap_set(rq, th->d_prio); /* queue is not empty now */
 }
 
-/* choose more significant thread of two provided */
-static thread_t *significant_thread(thread_t *t1, thread_t *t2)
+/* put thread to tail of proper priority queue */
+static inline void rq_put_thread(runqueue_t *rq, thread_t *th)
 {
-    int pl1, pl2;
-
-/* Note: Actually dynamic priorities comparsion is not needed,
- *       'cause two threads selected from the same queue.
-*/
-#if 0
-    /* compare dynamic priorities */
-    if(t1->d_prio > t2->d_prio)
-        return t1;
-    else if (t2->d_prio > t1->d_prio)
-        return t2;
-#endif
-
-    /*** compare scheduling policies ***/
-
-    /* get policy for fist thread */
-    if( t1->sched_policy.policy.type == SCHED_POLICY_INTERACTIVE &&
-       !(t1->process->flags & PROCESS_FLAG_INTERACTIVE) )
-        pl1 = SCHED_POLICY_ORDINARY;
-    else
-        pl1 = t1->sched_policy.policy.type;
-
-    /* get policy for second thread */
-    if( t2->sched_policy.policy.type == SCHED_POLICY_INTERACTIVE &&
-       !(t2->process->flags & PROCESS_FLAG_INTERACTIVE) )
-        pl2 = SCHED_POLICY_ORDINARY;
-    else
-        pl2 = t2->sched_policy.policy.type;
-
-    /* NOTE: SCHED_POLICY_INTERACTIVE policy is actual only if process has
-     *       PROCESS_FLAG_INTERACTIVE flag set. If flag is not set
-     *       then SCHED_POLICY_ORDINARY policy is used.
-     */
-
-    /* compare policies. if equal - return first thread */
-    if (pl1 >= pl2)
-        return t1;
-    else
-        return t2;
+    rq_put_thread_ex(rq, th, false);
 }
 
 /* Carrots and Sticks policy implementation for thread */
@@ -187,13 +229,233 @@ static int carrots_and_sticks(thread_t *th)
     return th->carrots_sticks;
 }
 
+/* extract most significant ready thread from runqueue.
+ * threads locked by someone else are skipped, so runqueue lock
+ * may be held while calling this. returned thread is locked.
+ * owned is a thread already locked by caller, it may be NULL.
+ */
+static thread_t *rq_take_next_thread(runqueue_t *rq, thread_t *owned)
+{
+    thread_t *th;
+    uint32 mask;
+    int prio, subq;
+
+    for(prio = rq_highest_prio(rq); prio >= 0; prio--) {
+        /* walk through non-empty subqueues, most significant first */
+        for(mask = rq->queue[prio].subq_mask; mask; mask &= ~(1U << subq)) {
+            subq = arch_sched_find_msb(mask);
+
+            /* first lockable thread of subqueue is taken */
+            for(th = rq_peek_head_thread(rq, prio, subq); th != NULL; th = rq_peek_next_thread(th)) {
+                if(th == owned || thread_trylock_thread(th))
+                    return rq_extract_thread(rq, th);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* extract thread cpu was asked to switch to by directed yield.
+ * hint is cleared when thread leaves runqueue, so it is always
+ * queued here. returned thread is locked. NULL is returned if
+ * thread is locked by someone else or more significant thread
+ * is ready to run.
+ */
+static thread_t *rq_take_handoff_thread(runqueue_t *rq, thread_t *owned)
+{
+    thread_t *th = rq->handoff;
+
+    rq->handoff = NULL;
+
+    if(th != owned && !thread_trylock_thread(th))
+        return NULL;
+
+    /* priorities are never bypassed */
+    if(th->d_prio >= rq_highest_prio(rq))
+        return rq_extract_thread(rq, th);
+
+    if(th != owned)
+        thread_unlock_thread(th);
+
+    return NULL;
+}
+
+/* returns true if cpu takes part in scheduling */
+static inline bool sched_cpu_is_online(uint cpu)
+{
+    return smp_cpu_is_active(cpu) && idle_threads[cpu] != NULL;
+}
+
+/* returns true if cpu executes its idle thread and has no ready threads */
+static inline bool sched_cpu_is_idle(uint cpu)
+{
+    return runqueues[cpu].curr == idle_threads[cpu] && !runqueues[cpu].total_count;
+}
+
+/* find runqueue with most ready threads, but not less than min_count */
+static runqueue_t *sched_find_busiest_runqueue(runqueue_t *rq, uint min_count)
+{
+    runqueue_t *busiest = NULL;
+    uint i;
+
+    /* Note: counters are read without locking, it is only a hint */
+    for(i = 0; i < ProcessorSet.processors_num; i++) {
+        if(i == rq->cpu_num || !sched_cpu_is_online(i))
+            continue;
+
+        if(runqueues[i].total_count >= min_count &&
+           (busiest == NULL || runqueues[i].total_count > busiest->total_count))
+            busiest = &runqueues[i];
+    }
+
+    return busiest;
+}
+
+/* pull up to count threads from src runqueue into dst runqueue.
+ * both runqueues must be locked by caller.
+ */
+static uint sched_migrate_threads(runqueue_t *dst, runqueue_t *src, uint count)
+{
+    thread_t *th;
+    uint moved = 0;
+
+    while(moved < count && (th = rq_take_next_thread(src, NULL)) != NULL) {
+        rq_put_thread(dst, th); /* affiliates thread with new cpu */
+        thread_unlock_thread(th);
+        moved++;
+    }
+
+    return moved;
+}
+
+/* pull threads from busiest runqueue into runqueue of current cpu.
+ * runqueue must be locked by caller.
+ * if idle is true, any ready thread is stolen from other cpu,
+ * otherwise only noticeable imbalance is fixed.
+ * Note: thread being switched out by other cpu is still locked
+ *       by that cpu, so it is never migrated.
+ */
+static uint sched_balance_runqueue(runqueue_t *rq, bool idle)
+{
+    runqueue_t *busiest;
+    uint count, moved = 0;
+
+    /* look for the busiest runqueue */
+    busiest = sched_find_busiest_runqueue(rq, (idle) ? 1 :
+                  rq->total_count + SCHED_IMBALANCE_THRESHOLD);
+    if(busiest == NULL)
+        return 0;
+
+    /* do not spin on busy runqueue, try next time */
+    if(!spin_trylock(&busiest->lock))
+        return 0;
+
+    /* compute migrated threads count. recheck counters under lock. */
+    if(busiest->total_count > rq->total_count) {
+        count = (busiest->total_count - rq->total_count + 1) / 2;
+        if(count > SCHED_MIGRATE_MAX) count = SCHED_MIGRATE_MAX;
+
+        moved = sched_migrate_threads(rq, busiest, count);
+    }
+
+    spin_unlock(&busiest->lock);
+
+    return moved;
+}
+
+/* ask one of idle cpus to steal ready threads from runqueue */
+static void sched_kick_idle_cpu(runqueue_t *rq)
+{
+    uint i;
+
+    for(i = 0; i < ProcessorSet.processors_num; i++) {
+        if(i != rq->cpu_num && sched_cpu_is_online(i) && sched_cpu_is_idle(i)) {
+            smp_send_reschedule(i);
+            break;
+        }
+    }
+}
+
+/* select cpu for thread that becomes ready */
+static uint sched_select_cpu(thread_t *thread)
+{
+    uint curr_cpu = get_current_processor();
+    uint cpu, i;
+
+    /* thread prefers cpu it ran on last time, cache may be still warm there */
+    cpu = (thread->cpu != NULL) ? thread->cpu->cpu_num : curr_cpu;
+    if(cpu != curr_cpu && !sched_cpu_is_online(cpu))
+        cpu = curr_cpu;
+
+    /* but idle cpu is better than busy one */
+    if(!sched_cpu_is_idle(cpu)) {
+        for(i = 0; i < ProcessorSet.processors_num; i++) {
+            if(sched_cpu_is_online(i) && sched_cpu_is_idle(i)) {
+                cpu = i;
+                break;
+            }
+        }
+    }
+
+    return cpu;
+}
+
+/* check that thread just put into runqueue must preempt running one.
+ * if so, need resched flag is set for runqueue cpu.
+ * Note: rq->curr is changed only under runqueue lock
+ */
+static bool rq_check_preempt(runqueue_t *rq, thread_t *thread)
+{
+    if(rq->curr == idle_threads[rq->cpu_num] || rq->curr->d_prio < thread->d_prio) {
+        rq->need_resched = true;
+        return true;
+    }
+
+    return false;
+}
+
+/* put ready thread to runqueue of current cpu */
+static void sched_enqueue_local(thread_t *thread)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq = &runqueues[ get_current_processor() ];
+
+    irqs_state = spin_lock_irqsave(&rq->lock);
+    rq_put_thread(rq, thread);
+    rq_check_preempt(rq, thread);
+    spin_unlock_irqrstor(&rq->lock, irqs_state);
+}
+
+/* put ready thread to runqueue of other cpu. that cpu is asked
+ * to reschedule if thread must preempt currently running one.
+ */
+static void sched_enqueue_remote(uint cpu, thread_t *thread)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq = &runqueues[cpu];
+    bool preempt;
+
+    irqs_state = spin_lock_irqsave(&rq->lock);
+
+    rq_put_thread(rq, thread);
+    preempt = rq_check_preempt(rq, thread);
+
+    spin_unlock_irqrstor(&rq->lock, irqs_state);
+
+    /* kick remote cpu */
+    if(preempt)
+        smp_send_reschedule(cpu);
+}
+
 /* shuffle runqueue head depending on tick type and threads wait time */
 static void sched_shuffle_runqueue_head(runqueue_t *rq, int tick_type)
 {
     thread_t *th;
     int queue_bonus;
-    int prio;
+    int prio, subq;
     int new_prio;
+    uint32 mask;
     bigtime_t ticks_msec = SCHED_TICKS2MSEC(sched_ticks);
 
     /* walk through head of thread queues and recalculate
@@ -206,51 +468,47 @@ static void sched_shuffle_runqueue_head(runqueue_t *rq, int tick_type)
         /* skip empty queues */
         if(!rq->queue[prio].count) continue;
 
-        /* point to head thread */
-        th = rq_peek_head_thread(rq, prio);
-
-        /* NOTE: Actually it is not needed to skip locked threads,
-         * because the only thing touched here is a dynamic priority
-         * which is managed only by scheduler and must not be touched
-         * outside.
-        */
-        /* try to lock thread */
-        /* if(!thread_trylock_thread(th))
-         *     continue;
-        */
-
         /* calculate bonus for queue */
         queue_bonus = rq->queue[prio].count >> SCHED_QUEUE_BONUS_THRESHOLD2;
 
-        /* calculate new dynamic priority for thread */
-        new_prio = th->s_prio + ((ticks_msec - th->sched_stamp) / shuffle_factor) +
-                   queue_bonus + th->carrots_sticks;
-        if(new_prio > THREAD_NUM_PRIORITY_LEVELS - 1)
-            new_prio = THREAD_NUM_PRIORITY_LEVELS - 1;
+        /* head thread of each subqueue is the longest waiting one */
+        for(mask = rq->queue[prio].subq_mask; mask; mask &= ~(1U << subq)) {
+            subq = arch_sched_find_msb(mask);
 
-        /* if new priority for thread is greater than current
-         * dynamic priority - move thread to higher queue.
-         */
-        if(new_prio > th->d_prio) {
-            /* remove thread from current queue */
-            rq_pop_head_thread(rq, prio);
-            /* set new dynamic priority */
-            th->d_prio = new_prio;
-            /* put thread back to proper queue */
-            rq_put_thread(rq, th);
-        }
+            /* point to head thread */
+            th = rq_peek_head_thread(rq, prio, subq);
 
-        /* NOTE: (see above)
-        */
-        /* unlock thread */
-        /* thread_unlock_thread(th); */
+            /* NOTE: Actually it is not needed to skip locked threads,
+             * because the only thing touched here is a dynamic priority
+             * which is managed only by scheduler and must not be touched
+             * outside.
+            */
+
+            /* calculate new dynamic priority for thread */
+            new_prio = th->s_prio + ((ticks_msec - th->sched_stamp) / rq->shuffle_factor) +
+                       queue_bonus + th->carrots_sticks;
+            if(new_prio > THREAD_NUM_PRIORITY_LEVELS - 1)
+                new_prio = THREAD_NUM_PRIORITY_LEVELS - 1;
+
+            /* if new priority for thread is greater than current
+             * dynamic priority - move thread to higher queue.
+             */
+            if(new_prio > th->d_prio) {
+                /* remove thread from current queue */
+                rq_extract_thread(rq, th);
+                /* set new dynamic priority */
+                th->d_prio = new_prio;
+                /* put thread back to proper queue */
+                rq_put_thread(rq, th);
+            }
+        }
     }
 }
 
 /* init runqueue before first use */
 static void sched_init_runqueue(runqueue_t *rq)
 {
-    int i;
+    int i, j;
 
     /* init spinlock */
     spin_init(&rq->lock);
@@ -258,10 +516,29 @@ static void sched_init_runqueue(runqueue_t *rq)
     /* set vars */
     rq->total_count = 0;
     rq->cpu_num = 0;
+    rq->curr = NULL;
+    rq->prev = NULL;
+    rq->handoff = NULL;
+    rq->need_resched = false;
+
+    /* scheduling timer state and parameters */
+    rq->tick_type = 0;
+    rq->quanta = THREAD_DEFAULT_QUANTA;
+    rq->shuffle_factor = THREAD_DEFAULT_QUANTA / SCHED_FACTOR_BMAX;
+    rq->balance_ticks = SCHED_MSEC2TICKS(SCHED_BALANCE_PERIOD);
+
+    /* all priority queues are empty */
+    rq->prio_summary = 0;
+    for(i=0; i < SCHED_PRIO_BITMAP_WORDS; i++)
+        rq->prio_bitmap[i] = 0;
 
     /* init priority queues */
-    for(i=0; i < THREAD_NUM_PRIORITY_LEVELS; i++)
-        xlist_init(&rq->queue[i]);
+    for(i=0; i < SCHED_NUM_QUEUES; i++) {
+        rq->queue[i].count = 0;
+        rq->queue[i].subq_mask = 0;
+        for(j=0; j < SCHED_NUM_SUBQUEUES; j++)
+            xlist_init(&rq->queue[i].subq[j]);
+    }
 }
 
 
@@ -277,9 +554,6 @@ status_t scheduler_init(kernel_args_t *kargs)
     if(err != NO_ERROR)
         return err;
 
-    /* init global scheduling lock */
-    spin_init(&sched_lock);
-
     return NO_ERROR;
 }
 
@@ -302,54 +576,67 @@ status_t scheduler_init_per_cpu(kernel_args_t *kargs, uint curr_cpu)
 }
 
 /* called from timer tick handler */
-bool scheduler_timer(void)
+bool scheduler_timer(uint ticks)
 {
     bool resched = false; /* return value */
     int ticks_out;
     int cpu;
-    int prio;
     bool is_idle;
     runqueue_t *rq;
     thread_t *run_th;
 
-    /* if nested enter occurs - increase lost ticks and exit */
-    if(!sched_lock_tryacquire()) {
-        sched_lost_ticks++;
-        return false;
-    }
-
-    /* calc scheduler ticks and ticks out value for current thread */
-    sched_ticks += (ticks_out = sched_lost_ticks + 1);
-    sched_lost_ticks = 0; /* reset lost ticks */
-
-    /* current cpu, runqueue and thread */
+    /* current cpu and runqueue */
     cpu = get_current_processor();
     rq = &runqueues[cpu];
+
+    /* ticks out value for current thread */
+    ticks_out = ticks;
+
+    /* scheduler ticks are counted by bootstrap cpu */
+    if(cpu == BOOTSTRAP_CPU)
+        sched_ticks += ticks_out;
+
+    /* current thread */
     run_th = thread_get_current_thread();
 
     /* lock access to runqueue */
     spin_lock(&rq->lock);
 
     /* set scheduler tick type and shuffle runqueue head */
-    sched_tick_type = (sched_tick_type + 1) & SCHED_TICK_TYPES_MASK;
-    sched_shuffle_runqueue_head(rq, sched_tick_type);
+    rq->tick_type = (rq->tick_type + 1) & SCHED_TICK_TYPES_MASK;
+    sched_shuffle_runqueue_head(rq, rq->tick_type);
+
+    /* periodic load balancing */
+    if(rq->balance_ticks <= (uint)ticks_out) {
+        rq->balance_ticks = SCHED_MSEC2TICKS(SCHED_BALANCE_PERIOD);
+        sched_balance_runqueue(rq, false);
+
+        /* ready threads are waiting here, kick idle cpu to steal them.
+         * Note: idle cpus may have their ticks stopped, so they are
+         *       kicked once per balance period only, failed steal is
+         *       not retried on each tick.
+         */
+        if(rq->total_count)
+            sched_kick_idle_cpu(rq);
+    } else
+        rq->balance_ticks -= ticks_out;
 
     /* if current tick is estimation tick, we need
      * estimate new value of quanta and shuffle factor.
      */
-    if(sched_tick_type == SCHED_ESTIMATION_TICK) {
+    if(rq->tick_type == SCHED_ESTIMATION_TICK) {
         uint a, b;
 
         /* estimate quanta */
-        quanta = THREAD_DEFAULT_QUANTA - (rq->total_count >> SCHED_QUANTA_THRESHOLD2);
-        if (quanta < THREAD_MINIMUM_QUANTA) quanta = THREAD_MINIMUM_QUANTA;
+        rq->quanta = THREAD_DEFAULT_QUANTA - (rq->total_count >> SCHED_QUANTA_THRESHOLD2);
+        if (rq->quanta < THREAD_MINIMUM_QUANTA) rq->quanta = THREAD_MINIMUM_QUANTA;
 
         /* estimate a and b params of shuffle factor */
         a = rq->total_count / SCHED_FACTOR_A; if(a==0) a = 1;
         b = (!rq->total_count) ? SCHED_FACTOR_BMAX : SCHED_FACTOR_BTHR / rq->total_count;
         if (b > SCHED_FACTOR_BMAX) b = SCHED_FACTOR_BMAX; if(b==0) b = 1;
         /* compute shuffle factor */
-        shuffle_factor = a * SCHED_FACTOR_BASE / b;
+        rq->shuffle_factor = a * SCHED_FACTOR_BASE / b;
     }
 
     /* if it is possible to reschedule current thread, try to find better one */
@@ -357,18 +644,25 @@ bool scheduler_timer(void)
         /* is current thread is idle thread ? */
         is_idle = (idle_threads[cpu] == run_th);
 
-        /* reschedule if not idle thread and jiffies is out */
-        if( !is_idle && (((run_th->jiffies -= ticks_out) <= 0) ? run_th->jiffies = 0, true : false) )
+        /* higher priority thread woken up since last tick */
+        if(rq->need_resched)
+            resched = true;
+        /* reschedule if not idle thread and jiffies is out.
+         * FIFO threads are not time sliced.
+         */
+        else if( !is_idle && run_th->sched_class != THREAD_SCHED_FIFO &&
+                 (((run_th->jiffies -= ticks_out) <= 0) ? run_th->jiffies = 0, true : false) )
             resched = true;
-        else if ( is_idle || (SCHED_TICKS2MSEC(run_th->ijiffies - run_th->jiffies) >= THREAD_QUANTA_GRANULARITY) ) {
+        else if ( is_idle || thread_is_rt(run_th) || rq_highest_prio(rq) >= THREAD_RT_PRIORITY_BASE ||
+                  (SCHED_TICKS2MSEC(run_th->ijiffies - run_th->jiffies) >= THREAD_QUANTA_GRANULARITY) ) {
             /* find higher priority thread if current thread is idle thread or quanta
-             * granule value is exceeded.
+             * granule value is exceeded. real-time threads do not wait for granule.
              */
-            for(prio=THREAD_NUM_PRIORITY_LEVELS - 1; prio > run_th->d_prio; --prio)
-                if (rq->queue[prio].count) {
-                    resched = true; /* bingo! thread founded! */
-                    break;
-                }
+            if(rq_highest_prio(rq) > run_th->d_prio)
+                resched = true; /* bingo! thread founded! */
+            /* idle cpu may steal work from other cpus */
+            else if(is_idle && sched_find_busiest_runqueue(rq, 1) != NULL)
+                resched = true;
         }
 
         /* mark thread as being rescheduled if rescheduling is needed */
@@ -379,12 +673,39 @@ bool scheduler_timer(void)
     /* unlock runqueue access */
     spin_unlock(&rq->lock);
 
-    sched_lock_release(); /* we leave scheduler's timer handler */
-
     /* return result */
     return resched;
 }
 
+/* returns true if current cpu has ready threads */
+bool sched_cpu_has_work(void)
+{
+    return runqueues[ get_current_processor() ].total_count != 0;
+}
+
+/* returns true if current thread should be preempted */
+bool sched_need_resched(void)
+{
+    thread_t *th = thread_get_current_thread();
+
+    return runqueues[ get_current_processor() ].need_resched && !th->preempt_count;
+}
+
+/* set fields of thread becoming ready */
+static void sched_prepare_ready_thread(thread_t *thread)
+{
+    /* check static priority value */
+    if(thread->s_prio > THREAD_NUM_PRIORITY_LEVELS-1)
+        thread->s_prio = THREAD_NUM_PRIORITY_LEVELS-1;
+
+    thread->state = THREAD_STATE_READY;
+    thread->next_state = THREAD_STATE_RUNNING;
+    thread->d_prio = thread_is_rt(thread) ? THREAD_RT_PRIORITY_BASE + thread->rt_prio : thread->s_prio;
+    if(thread->pi_prio > thread->d_prio)
+        thread->d_prio = thread->pi_prio; /* priority is inherited */
+    thread->sched_stamp = SCHED_TICKS2MSEC(sched_ticks);
+}
+
 /* adds idle thread for cpu */
 void sched_add_idle_thread(thread_t *thread, uint cpu)
 {
@@ -399,15 +720,15 @@ void sched_add_idle_thread(thread_t *thread, uint cpu)
     thread->s_prio = thread->d_prio = -1; /* idle threads never exists in runqueues */
     /* set thread */
     idle_threads[cpu] = thread;
+    runqueues[cpu].curr = thread;
 }
 
 /* add thread for scheduling */
 void sched_add_thread(thread_t *thread)
 {
-    unsigned long irqs_state;
-    runqueue_t *rq;
+    uint cpu;
 
-    ASSERT_MSG(thread->lock != 0,
+    ASSERT_MSG(spin_locked(&thread->lock),
         "sched_add_thread(): thread was not locked before!");
 
     ASSERT_MSG(thread->state == THREAD_STATE_BIRTH ||
@@ -416,30 +737,214 @@ void sched_add_thread(thread_t *thread)
                thread->state == THREAD_STATE_SUSPENDED,
         "sched_add_thread(): thread in wrong state!");
 
-    /* check static priority value */
-    if(thread->s_prio > THREAD_NUM_PRIORITY_LEVELS-1)
-        thread->s_prio = THREAD_NUM_PRIORITY_LEVELS-1;
+    /* set thread fields before */
+    sched_prepare_ready_thread(thread);
+
+    /* put to runqueue of selected cpu */
+    cpu = sched_select_cpu(thread);
+    if(cpu == get_current_processor())
+        sched_enqueue_local(thread);
+    else
+        sched_enqueue_remote(cpu, thread);
+}
+
+/* adds thread to runqueue of current cpu and runs it next */
+void sched_add_thread_handoff(thread_t *thread)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq;
+
+    ASSERT_MSG(spin_locked(&thread->lock),
+        "sched_add_thread_handoff(): thread was not locked before!");
+
+    ASSERT_MSG(thread->state == THREAD_STATE_BIRTH ||
+               thread->state == THREAD_STATE_WAITING ||
+               thread->state == THREAD_STATE_SLEEPING ||
+               thread->state == THREAD_STATE_SUSPENDED,
+        "sched_add_thread_handoff(): thread in wrong state!");
 
-    /* get runqueue for add thread. thread added to runqueue
-     * of current processor, it might be not good in SMP config.
-     * so, fix this in fututre.
+    sched_prepare_ready_thread(thread);
+
+    /* woken thread runs on the cpu of waker, which is going to
+     * give it up. no preemption check, caller reschedules.
      */
+    local_irqs_save_and_disable(irqs_state);
     rq = &runqueues[ get_current_processor() ];
+    spin_lock(&rq->lock);
+    rq_put_thread(rq, thread);
+    rq->handoff = thread;
+    spin_unlock_irqrstor(&rq->lock, irqs_state);
+}
 
-    /* set thread fields before */
-    thread->state = THREAD_STATE_READY;
-    thread->next_state = THREAD_STATE_RUNNING;
-    thread->d_prio = thread->s_prio;
-    thread->sched_stamp = SCHED_TICKS2MSEC(sched_ticks);
+/* ask current cpu to switch to thread on next reschedule */
+void sched_yield_to(thread_t *thread)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq;
 
-    /* acquire lock for runqueue */
+    if(thread == thread_get_current_thread())
+        return;
+
+    /* locked ready thread is not in transit between runqueues,
+     * so it is queued to runqueue of its cpu.
+     */
+    local_irqs_save_and_disable(irqs_state);
+    thread_lock_thread(thread);
+    rq = &runqueues[ get_current_processor() ];
+    spin_lock(&rq->lock);
+
+    /* hint is set only for thread queued here */
+    if(thread->state == THREAD_STATE_READY && thread->cpu != NULL &&
+       thread->cpu->cpu_num == rq->cpu_num)
+        rq->handoff = thread;
+
+    spin_unlock(&rq->lock);
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+}
+
+/* change scheduling class of thread */
+status_t sched_set_thread_class(thread_t *thread, int sched_class, int rt_prio)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq;
+    bool preempt = false;
+    int old_prio;
+
+    ASSERT_MSG(spin_locked(&thread->lock),
+        "sched_set_thread_class(): thread was not locked before!");
+
+    /* check arguments */
+    if(sched_class != THREAD_SCHED_NORMAL &&
+       sched_class != THREAD_SCHED_FIFO &&
+       sched_class != THREAD_SCHED_RR)
+        return ERR_INVALID_ARGS;
+    if(sched_class == THREAD_SCHED_NORMAL)
+        rt_prio = 0;
+    else if(rt_prio < 0 || rt_prio >= THREAD_NUM_RT_PRIORITY_LEVELS)
+        return ERR_INVALID_ARGS;
+
+    /* idle threads are not scheduled in usual way */
+    if(thread->cpu && idle_threads[thread->cpu->cpu_num] == thread)
+        return ERR_NO_PERM;
+
+    /* threads out of runqueues get new priority when become ready */
+    if(thread->state != THREAD_STATE_READY && thread->state != THREAD_STATE_RUNNING) {
+        thread->sched_class = sched_class;
+        thread->rt_prio = rt_prio;
+        return NO_ERROR;
+    }
+
+    rq = &runqueues[ thread->cpu->cpu_num ];
     irqs_state = spin_lock_irqsave(&rq->lock);
 
-    /* add to runqueue */
-    rq_put_thread(rq, thread);
+    old_prio = thread->d_prio;
+
+    /* ready thread must be moved to other queue */
+    if(thread->state == THREAD_STATE_READY)
+        rq_extract_thread(rq, thread);
+
+    thread->sched_class = sched_class;
+    thread->rt_prio = rt_prio;
+    thread->d_prio = thread_is_rt(thread) ? THREAD_RT_PRIORITY_BASE + rt_prio : thread->s_prio;
+    if(thread->pi_prio > thread->d_prio)
+        thread->d_prio = thread->pi_prio; /* priority is inherited */
+
+    if(thread->state == THREAD_STATE_READY) {
+        rq_put_thread(rq, thread);
+        preempt = rq_check_preempt(rq, thread);
+    } else if(thread->d_prio < old_prio && rq_highest_prio(rq) > thread->d_prio) {
+        /* running thread lowered itself below ready one */
+        rq->need_resched = true;
+        preempt = true;
+    }
+
+    spin_unlock_irqrstor(&rq->lock, irqs_state);
+
+    /* kick remote cpu */
+    if(preempt && rq->cpu_num != get_current_processor())
+        smp_send_reschedule(rq->cpu_num);
+
+    return NO_ERROR;
+}
+
+/* change dynamic priority of ready or running thread.
+ * returns true if cpu running the thread must reschedule.
+ */
+static bool sched_change_prio(thread_t *thread, int prio)
+{
+    unsigned long irqs_state;
+    runqueue_t *rq;
+    bool preempt = false;
+
+    rq = &runqueues[ thread->cpu->cpu_num ];
+    irqs_state = spin_lock_irqsave(&rq->lock);
+
+    if(thread->state == THREAD_STATE_READY) {
+        /* move ready thread to other queue */
+        rq_extract_thread(rq, thread);
+        thread->d_prio = prio;
+        rq_put_thread(rq, thread);
+        preempt = rq_check_preempt(rq, thread);
+    } else {
+        /* running thread may fall below ready one */
+        thread->d_prio = prio;
+        if(rq_highest_prio(rq) > prio) {
+            rq->need_resched = true;
+            preempt = true;
+        }
+    }
 
-    /* release lock */
     spin_unlock_irqrstor(&rq->lock, irqs_state);
+
+    return preempt && rq->cpu_num != get_current_processor();
+}
+
+/* boost priority of thread */
+void sched_inherit_priority(thread_t *thread, int prio)
+{
+    ASSERT_MSG(spin_locked(&thread->lock),
+        "sched_inherit_priority(): thread was not locked before!");
+
+    if(prio <= thread->pi_prio)
+        return;
+    thread->pi_prio = prio;
+
+    /* threads out of runqueues get boost when become ready */
+    if(thread->state != THREAD_STATE_READY && thread->state != THREAD_STATE_RUNNING)
+        return;
+
+    /* idle threads are not scheduled in usual way */
+    if(idle_threads[thread->cpu->cpu_num] == thread || prio <= thread->d_prio)
+        return;
+
+    if(sched_change_prio(thread, prio))
+        smp_send_reschedule(thread->cpu->cpu_num);
+}
+
+/* drop inherited priority of thread */
+void sched_restore_priority(thread_t *thread)
+{
+    int prio;
+
+    ASSERT_MSG(spin_locked(&thread->lock),
+        "sched_restore_priority(): thread was not locked before!");
+
+    if(!thread->pi_prio)
+        return;
+    thread->pi_prio = 0;
+
+    /* threads out of runqueues get own priority when become ready */
+    if(thread->state != THREAD_STATE_READY && thread->state != THREAD_STATE_RUNNING)
+        return;
+
+    /* only lower priority, it may be raised by runqueue shuffling */
+    prio = sched_thread_own_prio(thread);
+    if(prio >= thread->d_prio)
+        return;
+
+    if(sched_change_prio(thread, prio))
+        smp_send_reschedule(thread->cpu->cpu_num);
 }
 
 /* remove thread from scheduling */
@@ -448,7 +953,7 @@ void sched_remove_thread(thread_t *thread)
     unsigned long irqs_state;
     runqueue_t *rq;
 
-    ASSERT_MSG(thread->lock != 0,
+    ASSERT_MSG(spin_locked(&thread->lock),
         "sched_remove_thread(): thread was not locked before!");
 
     ASSERT_MSG(thread->state == THREAD_STATE_READY,
@@ -488,32 +993,48 @@ int sched_release_cpu(void)
 /* performs last steps of context switch */
 void sched_complete_context_switch(void)
 {
+    runqueue_t *rq = &runqueues[ get_current_processor() ];
+    thread_t *prev = rq->prev;
+
     /* unlock current thread */
     thread_unlock_thread( thread_get_current_thread() );
 
-    /* release scheduling lock */
-    sched_lock_release();
+    /* context of previous thread is saved now, so it
+     * may be woken up or selected by other cpus.
+     */
+    if(prev != NULL) {
+        rq->prev = NULL;
+        thread_unlock_thread(prev);
+    }
 
     /* enable interrupts */
     local_irqs_enable();
 }
 
 /* reschedules and performs context switch
- * this also reenables interrupts and releases scheduling lock.
+ * this also reenables interrupts.
+ * Note: current thread remains locked until context switch completes,
+ *       so other cpus cannot run it while its context is being saved.
 */
 void sched_reschedule(void)
 {
     int cpu;
-    int prio;
     bool is_idle;
     runqueue_t *rq;
     thread_t *curr_thrd, *next_thrd;
 
-    ASSERT_MSG(sched_lock != 0,
-        "sched_reschedule(): scheduling lock was not acquired!");
+    ASSERT_MSG(local_irqs_disabled(),
+        "sched_reschedule(): interrupts are not disabled!");
 
     /* init some other important variables */
     cpu = get_current_processor();                  /* current cpu */
+
+#if SYSCFG_DYNAMIC_TICK
+    /* cpu leaves idle state, restart its timer ticks */
+    if(idle_threads[cpu] == thread_get_current_thread())
+        timer_idle_exit();
+#endif
+
     curr_thrd = thread_get_current_thread_locked(); /* current thread */
     next_thrd = NULL;                               /* next thread is unknown at this point */
     is_idle = (idle_threads[cpu] == curr_thrd);     /* is current thread is a per cpu idle thread? */
@@ -521,6 +1042,7 @@ void sched_reschedule(void)
     /* acquire lock for runqueue and start */
     rq = &runqueues[cpu];                       /* runqueue for this cpu */
     spin_lock(&rq->lock);                       /* get lock */
+    rq->need_resched = false;                   /* request is handled now */
 
     /* adjust current thread */
     curr_thrd->sched_stamp = SCHED_TICKS2MSEC(sched_ticks);  /* put time stamp */
@@ -534,17 +1056,25 @@ void sched_reschedule(void)
         /* continue of execution requested for this thread */
         case THREAD_STATE_RUNNING:
             /* init jiffies again */
-            curr_thrd->jiffies = curr_thrd->ijiffies = SCHED_MSEC2TICKS(quanta);
+            curr_thrd->jiffies = curr_thrd->ijiffies = sched_thread_quanta(rq, curr_thrd);
 
             /* unlock runqueue, thread and return */
             spin_unlock(&rq->lock);
             thread_unlock_thread(curr_thrd);
-            sched_lock_release();
             local_irqs_enable();
             return;
 
         /* put thread back to runqueue */
         case THREAD_STATE_READY:
+            /* real-time threads keep their priority. preempted FIFO thread
+             * stays at head of its queue, yielded one goes to tail.
+             */
+            if(thread_is_rt(curr_thrd)) {
+                rq_put_thread_ex(rq, curr_thrd, curr_thrd->sched_class == THREAD_SCHED_FIFO &&
+                                                rq_highest_prio(rq) > curr_thrd->d_prio);
+                break;
+            }
+
             /* compute new dynamic priority */
             curr_thrd->d_prio = curr_thrd->s_prio + carrots_and_sticks(curr_thrd);
 
@@ -554,6 +1084,14 @@ void sched_reschedule(void)
             else if(curr_thrd->d_prio < THREAD_LOWEST_PIORITY)
                 curr_thrd->d_prio = THREAD_LOWEST_PIORITY;
 
+            /* priority is inherited. boost applied by waiter which raced
+             * with release of last lock is dropped here.
+             */
+            if(!curr_thrd->pi_locks)
+                curr_thrd->pi_prio = 0;
+            if(curr_thrd->pi_prio > curr_thrd->d_prio)
+                curr_thrd->d_prio = curr_thrd->pi_prio;
+
             /* put back to runqueue */
             rq_put_thread(rq, curr_thrd);
             break;
@@ -569,52 +1107,54 @@ void sched_reschedule(void)
             panic("sched_reschedule(): invalid thread state!");
     }
 
-    /* unlock current thread */
-    thread_unlock_thread(curr_thrd);
-
-    /* search priority queues for better thread */
-    for(prio=THREAD_NUM_PRIORITY_LEVELS-1; prio>=0; prio--) {
-        /* start new iteration if current queue is empty */
-        if(rq->queue[prio].count == 0) continue;
-
-        /* if more then 1 ready thread exists look for better one */
-        if(rq->queue[prio].count > 1) {
-            thread_t *tmp_next;  /* temp pointer for walking throught queue */
-            uint n = SCHED_QUEUE_LOOKAHEAD_DEPTH; /* walk depth */
-
-            /* find most significant thread in queue */
-            next_thrd = rq_peek_head_thread(rq, prio);
-            tmp_next = next_thrd;
-            while( (tmp_next = rq_peek_next_thread(tmp_next)) != NULL && --n )
-                next_thrd = significant_thread(next_thrd, tmp_next);
-
-            /* extract discovered thread from queue */
-            rq_extract_thread(rq, next_thrd);
-        }
-        else
-            next_thrd = rq_pop_head_thread(rq, prio); /* select thread */
+    /* nothing to run here, try to steal work from other cpus */
+    if(!rq->total_count)
+        sched_balance_runqueue(rq, true);
 
-        /* cancel search cycle, we found something */
-        break;
-    }
+    /* take most significant ready thread, it is returned locked.
+     * Note: threads locked by others are skipped while looking for
+     * next thread, so we are not deadlocked with thread lock owner
+     * waiting for runqueue lock.
+     */
+    next_thrd = NULL;
+    if(rq->handoff != NULL)
+        next_thrd = rq_take_handoff_thread(rq, curr_thrd); /* directed yield */
+    if(next_thrd == NULL)
+        next_thrd = rq_take_next_thread(rq, curr_thrd);
+
+    /* if no thread found - take idle thread for this cpu */
+    rq->curr = (next_thrd != NULL) ? next_thrd : idle_threads[cpu];
 
     /* unlock runqueue */
     spin_unlock(&rq->lock);
 
-    /* if thread was found */
     if(next_thrd != NULL)
         /* init jiffies for new thread */
-        next_thrd->jiffies = next_thrd->ijiffies = SCHED_MSEC2TICKS(quanta);
-    else  /* if no thread found - take idle thread for this cpu */
+        next_thrd->jiffies = next_thrd->ijiffies = sched_thread_quanta(rq, next_thrd);
+    else {
+        /* lock idle thread before switching state */
         next_thrd = idle_threads[cpu];
+        if(next_thrd != curr_thrd)
+            thread_lock_thread(next_thrd);
+    }
 
-    /* lock discovered thread before switching state */
-    thread_lock_thread(next_thrd);
+    /* cpu passes quiescent state on reschedule */
+    rcu_note_context_switch(cpu, next_thrd == idle_threads[cpu]);
 
     /* set thread state and put timestamp */
     next_thrd->state = THREAD_STATE_RUNNING;
     next_thrd->sched_stamp = SCHED_TICKS2MSEC(sched_ticks);
 
+    /* current thread selected again, no switch needed */
+    if(next_thrd == curr_thrd) {
+        thread_unlock_thread(curr_thrd);
+        local_irqs_enable();
+        return;
+    }
+
+    /* previous thread is unlocked after switch */
+    rq->prev = curr_thrd;
+
     /* switch to next thread */
     arch_sched_context_switch(curr_thrd, next_thrd);
     /* NOTE: For new threads control never goes here after switch at the first
@@ -625,21 +1165,3 @@ void sched_reschedule(void)
     /* perform last steps of context switch */
     sched_complete_context_switch();
 }
-
-/* acquire scheduling lock */
-void sched_lock_acquire(void)
-{
-    spin_lock(&sched_lock);
-}
-
-/* release scheduling lock */
-void sched_lock_release(void)
-{
-    spin_unlock(&sched_lock);
-}
-
-/* try acquire scheduling lock */
-bool sched_lock_tryacquire(void)
-{
-    return spin_trylock(&sched_lock);
-}
@@ -13,6 +13,7 @@
 #include <phlox/atomic.h>
 #include <phlox/avl_tree.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
 #include <phlox/thread.h>
 #include <phlox/thread_private.h>
 #include <phlox/process.h>
@@ -68,20 +69,37 @@ typedef struct {
     avl_tree_node_t tree_node;       /* tree node for search by name */
 } semaphore_t;
 
-/* Control block for waiting thread */
+/* Group of control blocks of thread waiting for any of semaphores.
+ * Group fields are protected by waiting thread lock.
+ */
 typedef struct {
-    semaphore_t *sem;       /* owner semaphore */
-    thread_t    *thread;    /* waiting thread */
-    uint        count;      /* count requested by thread */
-    timeout_id  timeout;    /* timeout call id */
-    status_t    err;        /* wakeup status to return to thread */
-    list_elem_t list_node;  /* list node inside waiters list of semaphore */
+    thread_t        *thread;     /* waiting thread */
+    int             fired;       /* index of signaled semaphore or -1 */
+    status_t        err;         /* wakeup status to return to thread */
+    bool            timed_out;   /* timeout expired */
+    const sem_id    *ids;        /* waited semaphores */
+    struct sem_wcb  *wcbs;       /* control blocks, one per semaphore */
+    uint            nr_queued;   /* count of queued control blocks */
+} sem_wgroup_t;
+
+/* Control block for waiting thread */
+typedef struct sem_wcb {
+    semaphore_t  *sem;       /* owner semaphore */
+    thread_t     *thread;    /* waiting thread */
+    uint         count;      /* count requested by thread */
+    timeout_id   timeout;    /* timeout call id */
+    status_t     err;        /* wakeup status to return to thread */
+    bool         queued;     /* true while in waiters list */
+    sem_wgroup_t *group;     /* group if thread waits for many semaphores */
+    uint         index;      /* index of semaphore within group */
+    list_elem_t  list_node;  /* list node inside waiters list of semaphore */
 } sem_wcb_t;
 
 /* Semaphore item within semaphores table */
 typedef struct {
-    spinlock_t  lock;  /* item lock */
-    semaphore_t *sem;  /* pointer to semaphore if allocated or NULL */
+    spinlock_t  lock;       /* item lock */
+    semaphore_t *sem;       /* pointer to semaphore if allocated or NULL */
+    int         next_free;  /* next item in free items list or -1 */
 } sem_table_item_t;
 
 
@@ -92,13 +110,17 @@ typedef struct {
 /* Semaphores table */
 static sem_table_item_t sem_table[SYS_MAX_SEM_COUNT];
 
+/* Free items list of semaphores table */
+static int sem_free_head;
+static spinlock_t sem_free_lock;
+
 /* Next generated id for semaphore */
 static vuint next_sem_gid;
 
 /* Semaphores tree (only for named semaphores) */
 static avl_tree_t sem_tree;
 /* Semaphores tree lock */
-static spinlock_t sem_tree_lock;
+static rwlock_t sem_tree_lock;
 
 
 /**************************************************
@@ -173,17 +195,35 @@ static void destroy_sem_struct(semaphore_t *sem)
 /* allocate slot in semaphores table and set lock for it */
 static int alloc_sem_slot(void)
 {
-    int i;
-    for(i = 0; i < SYS_MAX_SEM_COUNT; ++i) {
-        if(spin_trylock(&sem_table[i].lock)) {
-            /* is free? */
-            if(sem_table[i].sem == NULL)
-                return i;
-            /* not free, unlock and continue */
-            spin_unlock(&sem_table[i].lock);
-        }
-    }
-    return -1; /* no free slot */
+    unsigned long irqs_state;
+    int slot;
+
+    /* pop free items list head */
+    irqs_state = spin_lock_irqsave(&sem_free_lock);
+    slot = sem_free_head;
+    if(slot >= 0)
+        sem_free_head = sem_table[slot].next_free;
+    spin_unlock_irqrstor(&sem_free_lock, irqs_state);
+
+    /* no free slot */
+    if(slot < 0)
+        return -1;
+
+    /* Note: lock may be held for a while by lookup of stale id */
+    spin_lock(&sem_table[slot].lock);
+
+    return slot;
+}
+
+/* return slot into free items list */
+static void free_sem_slot(int slot)
+{
+    unsigned long irqs_state;
+
+    irqs_state = spin_lock_irqsave(&sem_free_lock);
+    sem_table[slot].next_free = sem_free_head;
+    sem_free_head = slot;
+    spin_unlock_irqrstor(&sem_free_lock, irqs_state);
 }
 
 /* return pointer to locked semaphore data */
@@ -212,13 +252,56 @@ static semaphore_t *get_sem_by_id(sem_id id)
 static inline void sem_put_wcb(semaphore_t *sem, sem_wcb_t *wcb)
 {
     xlist_add_last(&sem->waiters, &wcb->list_node);
+    wcb->queued = true;
 }
 
 /* extract control block from semaphore list */
 static inline sem_wcb_t* sem_get_wcb(semaphore_t *sem)
 {
     list_elem_t *e = xlist_extract_first(&sem->waiters);
-    return e ? containerof(e, sem_wcb_t, list_node) : NULL;
+    sem_wcb_t *wcb = e ? containerof(e, sem_wcb_t, list_node) : NULL;
+
+    if(wcb) wcb->queued = false;
+    return wcb;
+}
+
+/* remove control block from semaphore list, if it is still there */
+static inline void sem_remove_wcb(semaphore_t *sem, sem_wcb_t *wcb)
+{
+    if(!wcb->queued)
+        return;
+
+    xlist_remove_unsafe(&sem->waiters, &wcb->list_node);
+    wcb->queued = false;
+}
+
+/* wake up thread waiting for many semaphores.
+ * returns false if group was already woken up.
+ */
+static bool sem_wgroup_wake(sem_wgroup_t *group, int index, status_t err)
+{
+    thread_t *thread = group->thread;
+    bool woken = false;
+
+    thread_lock_thread(thread);
+
+    if(err == ERR_SEM_TIMEOUT)
+        group->timed_out = true;
+
+    if(group->fired < 0) {
+        group->fired = index;
+        group->err = err;
+        woken = true;
+
+        if(thread->state == THREAD_STATE_WAITING)
+            sched_add_thread(thread);
+        else if(thread->next_state == THREAD_STATE_WAITING)
+            thread->next_state = THREAD_STATE_READY; /* not switched out yet */
+    }
+
+    thread_unlock_thread(thread);
+
+    return woken;
 }
 
 /* peek head of the control blocks list */
@@ -255,7 +338,7 @@ static void sem_thread_callback(thread_cbd_t *cb)
 
     /* remove thread control block from waiters list */
     irqs_state = spin_lock_irqsave(wcb->sem->lock);
-    xlist_remove_unsafe(&wcb->sem->waiters, &wcb->list_node);
+    sem_remove_wcb(wcb->sem, wcb);
     spin_unlock_irqrstor(wcb->sem->lock, irqs_state);
 }
 
@@ -271,7 +354,7 @@ static void sem_timeout_callback(timeout_id id, void *data)
     /* set wake up reason, if was not already set */
     if(wcb->err == NO_ERROR) wcb->err = ERR_SEM_TIMEOUT;
     /* remove control block from list */
-    xlist_remove_unsafe(&wcb->sem->waiters, &wcb->list_node);
+    sem_remove_wcb(wcb->sem, wcb);
 
     /* wake up thread */
     thread_lock_thread(wcb->thread);
@@ -283,6 +366,89 @@ static void sem_timeout_callback(timeout_id id, void *data)
 }
 
 
+/* wake up threads which may acquire current semaphore count.
+ * if handoff is true, first woken thread runs next on current cpu.
+ * semaphore must be locked by caller.
+ */
+static void sem_wake_waiters(semaphore_t *sem, bool handoff)
+{
+    uint curr_count = sem->count;
+    sem_wcb_t *wcb, *wcb_f;
+
+    /* get last item of control blocks list to process */
+    wcb_f = sem_peek_last_wcb(sem);
+
+    wcb = NULL; /* if wcb_f is NULL next loop will be skipped */
+
+    /* walk through control blocks list to find threads for wake up */
+    while(wcb != wcb_f) {
+        wcb = sem_get_wcb(sem);  /* get block from head */
+        /* can acquire? */
+        if(wcb->count <= curr_count && wcb->group) {
+            /* thread waits for many semaphores, it leaves all lists
+             * after wake up. count is left if it was already woken up.
+             */
+            if(sem_wgroup_wake(wcb->group, wcb->index, NO_ERROR))
+                curr_count -= wcb->count;
+        } else if(wcb->count <= curr_count) {
+            /* wake up thread */
+            thread_lock_thread(wcb->thread);
+            if(handoff) {
+                sched_add_thread_handoff(wcb->thread);
+                handoff = false;
+            } else
+                sched_add_thread(wcb->thread);
+            thread_unlock_thread(wcb->thread);
+
+            /* update current count value */
+            curr_count -= wcb->count;
+        } else
+           sem_put_wcb(sem, wcb);  /* put block to tail */
+    }
+}
+
+/* remove all control blocks of group from semaphores lists.
+ * called with local interrupts disabled.
+ */
+static void sem_wgroup_dequeue(sem_wgroup_t *group)
+{
+    semaphore_t *sem;
+    uint i;
+
+    for(i = 0; i < group->nr_queued; ++i) {
+        /* deleted semaphore already removed control block */
+        sem = get_sem_by_id(group->ids[i]);
+        if(sem == NULL)
+            continue;
+
+        sem_remove_wcb(sem, &group->wcbs[i]);
+        sem_unlock(sem);
+    }
+
+    group->nr_queued = 0;
+}
+
+/* called on death of thread waiting for many semaphores */
+static void sem_wgroup_thread_callback(thread_cbd_t *cb)
+{
+    unsigned long irqs_state;
+
+    local_irqs_save_and_disable(irqs_state);
+    sem_wgroup_dequeue((sem_wgroup_t*)cb->data);
+    local_irqs_restore(irqs_state);
+}
+
+/* timeout handler for thread waiting for many semaphores */
+static void sem_wgroup_timeout_callback(timeout_id id, void *data)
+{
+    unsigned long irqs_state;
+
+    local_irqs_save_and_disable(irqs_state);
+    sem_wgroup_wake((sem_wgroup_t*)data, -1, ERR_SEM_TIMEOUT);
+    local_irqs_restore(irqs_state);
+}
+
+
 /**************************************************
  * Public routines
  **************************************************/
@@ -296,8 +462,13 @@ status_t semaphores_init(kernel_args_t *kargs)
     for(i = 0; i < SYS_MAX_SEM_COUNT; ++i) {
         spin_init(&sem_table[i].lock);  /* init lock */
         sem_table[i].sem = NULL;        /* pointer to semaphore */
+        sem_table[i].next_free = (i + 1 < SYS_MAX_SEM_COUNT) ? (int)i + 1 : -1;
     }
 
+    /* all slots are free, lower slots are allocated first */
+    sem_free_head = 0;
+    spin_init(&sem_free_lock);
+
     /* next available gid */
     next_sem_gid = 1;
 
@@ -308,7 +479,7 @@ status_t semaphores_init(kernel_args_t *kargs)
                      offsetof(semaphore_t, tree_node) );
 
     /* init tree lock */
-    spin_init(&sem_tree_lock);
+    rw_init(&sem_tree_lock);
 
     return NO_ERROR;
 }
@@ -336,6 +507,7 @@ sem_id sem_create_ex(const char *name, uint max_count, uint init_count, proc_id
     sem = create_sem_struct(name);
     if(sem == NULL) {
         spin_unlock(&sem_table[slot].lock);
+        free_sem_slot(slot);
         return INVALID_SEMID;
     }
 
@@ -343,6 +515,7 @@ sem_id sem_create_ex(const char *name, uint max_count, uint init_count, proc_id
     proc = proc_get_process_by_id(owner);
     if(proc == NULL) {
         spin_unlock(&sem_table[slot].lock);
+        free_sem_slot(slot);
         destroy_sem_struct(sem);
         return INVALID_SEMID;
     }
@@ -364,7 +537,7 @@ sem_id sem_create_ex(const char *name, uint max_count, uint init_count, proc_id
     local_irqs_save_and_disable(irqs_state);
 
     /* acquire locks */
-    if(has_name) spin_lock(&sem_tree_lock);
+    if(has_name) rw_write_lock(&sem_tree_lock);
     spin_lock(&proc->lock);
 
     /* put into tree */
@@ -372,10 +545,11 @@ sem_id sem_create_ex(const char *name, uint max_count, uint init_count, proc_id
         /* Ooops... Semaphore with this name already exists. Revert! */
         /* unlock process and tree */
         spin_unlock(&proc->lock);
-        spin_unlock(&sem_tree_lock);
+        rw_write_unlock(&sem_tree_lock);
         /* release semaphore data */
         sem_table[slot].sem = NULL;
         spin_unlock(&sem_table[slot].lock);
+        free_sem_slot(slot);
         destroy_sem_struct(sem);
         /* restore interrupts */
         local_irqs_restore(irqs_state);
@@ -390,7 +564,7 @@ sem_id sem_create_ex(const char *name, uint max_count, uint init_count, proc_id
 
     /* release locks */
     spin_unlock(&proc->lock);
-    if(has_name) spin_unlock(&sem_tree_lock);
+    if(has_name) rw_write_unlock(&sem_tree_lock);
 
     gid = sem->id; /* store return value */
     spin_unlock(&sem_table[slot].lock);
@@ -429,7 +603,7 @@ status_t sem_delete(sem_id id)
     }
 
     /* acquire locks */
-    if(sem->name != NULL) spin_lock(&sem_tree_lock);
+    if(sem->name != NULL) rw_write_lock(&sem_tree_lock);
     spin_lock(&sem->proc->lock);
 
     /* remove from AVL tree */
@@ -442,14 +616,21 @@ status_t sem_delete(sem_id id)
 
     /* release locks */
     spin_unlock(&sem->proc->lock);
-    if(sem->name != NULL) spin_unlock(&sem_tree_lock);
+    if(sem->name != NULL) rw_write_unlock(&sem_tree_lock);
 
     /* free semaphores table slot */
     sem_table[SEM_IDX(id)].sem = NULL;
-    sem_unlock(sem);
 
-    /* wake up all waiting threads with DELETED error */
+    /* wake up all waiting threads with DELETED error.
+     * Note: it is done before unlock, so waiter which sees semaphore
+     *       gone knows its control block is out of the list.
+     */
     while((wcb = sem_get_wcb(sem)) != NULL) {
+        if(wcb->group) {
+            sem_wgroup_wake(wcb->group, wcb->index, ERR_SEM_DELETED);
+            continue;
+        }
+
         wcb->err = ERR_SEM_DELETED;
         /* wake up thread */
         thread_lock_thread(wcb->thread);
@@ -457,6 +638,11 @@ status_t sem_delete(sem_id id)
         thread_unlock_thread(wcb->thread);
     }
 
+    sem_unlock(sem);
+
+    /* slot may be reused now */
+    free_sem_slot(SEM_IDX(id));
+
     /* restore interrupts */
     local_irqs_restore(irqs_state);
 
@@ -498,6 +684,8 @@ status_t sem_down_ex(sem_id id, uint count, uint timeout_msec, flags_t flags)
     /* store thread data in control block */
     wcb.thread = thread_get_current_thread_locked();
     wcb.count = count;
+    wcb.queued = false;
+    wcb.group = NULL;
 
     /* set up thread callback data */
     tcb.thread = wcb.thread;
@@ -586,13 +774,185 @@ status_t sem_down(sem_id id, uint count)
     return sem_down_ex(id, count, 0, SEMF_NOFLAGS);
 }
 
-/* count semaphore up */
-status_t sem_up(sem_id id, uint count)
+/* count down any of semaphores */
+int sem_down_any(const sem_id *ids, uint count, uint timeout_msec, flags_t flags)
+{
+    sem_wcb_t wcbs[SYS_MAX_WAIT_OBJECTS];
+    timeout_id timeout = INVALID_TIMEOUTID;
+    unsigned long irqs_state;
+    sem_wgroup_t group;
+    thread_cbd_t tcb;
+    semaphore_t *sem;
+    bool done = false;
+    int ret = NO_ERROR;
+    int fired = -1;
+    uint i;
+
+    /* check arguments */
+    if(!count || count > SYS_MAX_WAIT_OBJECTS)
+        return ERR_INVALID_ARGS;
+
+    /* zero timeout only tries to count down */
+    if(!timeout_msec && (flags & SEMF_TIMEOUT))
+        flags |= SEMF_TRY;
+
+    /* init group */
+    group.thread = thread_get_current_thread();
+    group.fired = -1;
+    group.err = NO_ERROR;
+    group.timed_out = false;
+    group.ids = ids;
+    group.wcbs = wcbs;
+    group.nr_queued = 0;
+
+    /* set up thread callback data */
+    tcb.thread = group.thread;
+    tcb.func = &sem_wgroup_thread_callback;
+    tcb.data = &group;
+
+    /* disable local interrupts */
+    local_irqs_save_and_disable(irqs_state);
+
+    /* register timeout and thread callbacks */
+    if(!(flags & SEMF_TRY)) {
+        if(flags & SEMF_TIMEOUT) {
+            timeout = timer_timeout_sched( sem_wgroup_timeout_callback, &group,
+                TIMER_MSEC_TO_TICKS(timeout_msec) );
+            if(timeout == INVALID_TIMEOUTID) {
+                local_irqs_restore(irqs_state);
+                return ERR_SEM_GENERAL;
+            }
+        }
+
+        thread_get_current_thread_locked();
+        thread_register_term_cb(&tcb);
+        thread_unlock_thread(group.thread);
+    }
+
+    while(!done) {
+        /* going to sleep, unless one of semaphores has count */
+        thread_get_current_thread_locked();
+        if(group.timed_out) {
+            thread_unlock_thread(group.thread);
+            ret = ERR_SEM_TIMEOUT;
+            break;
+        }
+        group.fired = -1;
+        group.err = NO_ERROR;
+        if(!(flags & SEMF_TRY))
+            group.thread->next_state = THREAD_STATE_WAITING;
+        thread_unlock_thread(group.thread);
+
+        /* take count of first available semaphore or queue
+         * control block into its waiters list.
+         */
+        for(i = 0; i < count; ++i) {
+            sem = get_sem_by_id(ids[i]);
+            if(sem == NULL) {
+                ret = ERR_SEM_INVALID_HANDLE;
+                done = true;
+                break;
+            }
+
+            if(sem->count >= 1) {
+                sem->count--;
+                sem_unlock(sem);
+                ret = (int)i;
+                done = true;
+                break;
+            }
+
+            if(!(flags & SEMF_TRY)) {
+                wcbs[i].sem = sem;
+                wcbs[i].thread = group.thread;
+                wcbs[i].count = 1;
+                wcbs[i].timeout = INVALID_TIMEOUTID;
+                wcbs[i].err = NO_ERROR;
+                wcbs[i].group = &group;
+                wcbs[i].index = i;
+                sem_put_wcb(sem, &wcbs[i]);
+                group.nr_queued = i + 1;
+            }
+
+            sem_unlock(sem);
+        }
+
+        /* nothing to wait for */
+        if(!done && (flags & SEMF_TRY)) {
+            ret = (flags & SEMF_TIMEOUT) ? ERR_SEM_TIMEOUT : ERR_SEM_TRY_FAILED;
+            done = true;
+        }
+
+        /* sleep until one of semaphores is signaled */
+        if(!done) {
+            local_irqs_restore(irqs_state);
+            thread_yield();
+            local_irqs_save_and_disable(irqs_state);
+        }
+
+        /* stop further wake ups and leave all lists */
+        thread_get_current_thread_locked();
+        if(group.thread->next_state == THREAD_STATE_WAITING)
+            group.thread->next_state = THREAD_STATE_READY;
+        fired = group.fired;
+        if(!done && group.err != NO_ERROR) {
+            ret = group.err;
+            done = true;
+        }
+        group.fired = (int)count;
+        thread_unlock_thread(group.thread);
+
+        sem_wgroup_dequeue(&group);
+
+        if(done || fired < 0)
+            continue;
+
+        /* take count of signaled semaphore, other thread may be faster */
+        sem = get_sem_by_id(ids[fired]);
+        if(sem == NULL) {
+            ret = ERR_SEM_DELETED;
+            done = true;
+        } else {
+            if(sem->count >= 1) {
+                sem->count--;
+                ret = fired;
+                done = true;
+            }
+            sem_unlock(sem);
+        }
+    }
+
+    /* we were woken up by semaphore which we did not count down,
+     * pass wake up to its other waiters.
+     */
+    if(fired >= 0 && fired < (int)count && fired != ret) {
+        sem = get_sem_by_id(ids[fired]);
+        if(sem != NULL) {
+            sem_wake_waiters(sem, false);
+            sem_unlock(sem);
+        }
+    }
+
+    /* unregister callbacks */
+    if(!(flags & SEMF_TRY)) {
+        thread_get_current_thread_locked();
+        thread_unregister_term_cb(&tcb);
+        thread_unlock_thread(group.thread);
+    }
+
+    local_irqs_restore(irqs_state);
+
+    if(timeout != INVALID_TIMEOUTID)
+        timer_timeout_cancel_sync(timeout);
+
+    return ret;
+}
+
+/* count semaphore up, optionally handing cpu off to woken thread */
+static status_t sem_up_common(sem_id id, uint count, bool handoff)
 {
     unsigned long irqs_state;
     semaphore_t *sem;
-    sem_wcb_t *wcb, *wcb_f;
-    uint curr_count;
 
     /* disable local interrupts */
     local_irqs_save_and_disable(irqs_state);
@@ -613,36 +973,40 @@ status_t sem_up(sem_id id, uint count)
         }
     }
 
-    /* update semaphore count */
+    /* update semaphore count and wake up waiters */
     sem->count += count;
-    curr_count = sem->count;
+    sem_wake_waiters(sem, handoff);
 
-    /* get last item of control blocks list to process */
-    wcb_f = sem_peek_last_wcb(sem);
+    /* unlock semaphore */
+    sem_unlock(sem);
+    local_irqs_restore(irqs_state);
 
-    wcb = NULL; /* if wcb_f is NULL next loop will be skipped */
+    return NO_ERROR;
+}
 
-    /* walk through control blocks list to find threads for wake up */
-    while(wcb != wcb_f) {
-        wcb = sem_get_wcb(sem);  /* get block from head */
-        /* can acquire? */
-        if(wcb->count <= curr_count) {
-            /* wake up thread */
-            thread_lock_thread(wcb->thread);
-            sched_add_thread(wcb->thread);
-            thread_unlock_thread(wcb->thread);
+/* count semaphore up */
+status_t sem_up(sem_id id, uint count)
+{
+    return sem_up_common(id, count, false);
+}
 
-            /* update current count value */
-            curr_count -= wcb->count;
-        } else
-           sem_put_wcb(sem, wcb);  /* put block to tail */
-    }
+/* count one semaphore up and another one down */
+status_t sem_up_and_down(sem_id up_id, sem_id down_id, uint timeout_msec, flags_t flags)
+{
+    unsigned long irqs_state;
+    status_t err;
+
+    /* do not let preemption run woken thread before we block */
+    local_irqs_save_and_disable(irqs_state);
+
+    /* woken thread is switched to directly when we block below */
+    err = sem_up_common(up_id, 1, true);
+    if(err == NO_ERROR)
+        err = sem_down_ex(down_id, 1, timeout_msec, flags);
 
-    /* unlock semaphore */
-    sem_unlock(sem);
     local_irqs_restore(irqs_state);
 
-    return NO_ERROR;
+    return err;
 }
 
 /* find semaphore by its name */
@@ -656,14 +1020,14 @@ sem_id sem_get_by_name(const char *name)
     search4 = containerof(&name, semaphore_t, name);
 
     /* lock tree with interrupts disabled */
-    irqs_state = spin_lock_irqsave(&sem_tree_lock);
+    irqs_state = rw_read_lock_irqsave(&sem_tree_lock);
 
     /* search for semaphore */
     sem = avl_tree_find(&sem_tree, search4, NULL);
     if(sem) id = sem->id;
 
     /* unlock tree */
-    spin_unlock_irqrstor(&sem_tree_lock, irqs_state);
+    rw_read_unlock_irqrstor(&sem_tree_lock, irqs_state);
 
     return id; /* return result */
 }
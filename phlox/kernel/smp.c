@@ -0,0 +1,198 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <phlox/kernel.h>
+#include <phlox/atomic.h>
+#include <phlox/spinlock.h>
+#include <phlox/processor.h>
+#include <phlox/interrupt.h>
+#include <phlox/smp.h>
+
+
+/* Number of processors started by kinit */
+static uint num_cpus = 1;
+
+/* Non-boot processors wait on this flag during kernel start up.
+ * Note: it is in bss, so it is zeroed by kinit before APs started.
+ */
+static volatile int boot_cpus_released = 0;
+
+/* Mask of processors ready to handle inter-CPU interrupts */
+static atomic_t active_cpus = 0;
+
+/* Mask of processors with pending reschedule requests */
+static atomic_t resched_requests = 0;
+
+/* Broadcast message. Only one message is delivered at a time. */
+static spinlock_t ici_lock;
+static volatile uint ici_msg;
+static volatile addr_t ici_data;
+static atomic_t ici_pending = 0;  /* processors which not handled message yet */
+
+
+/* handle broadcast message, if one is pending for this cpu */
+void smp_process_pending_ici(void)
+{
+    uint cpu_bit;
+
+    /* fast path: nothing to do */
+    if(!atomic_get(&ici_pending))
+        return;
+
+    cpu_bit = 1 << get_current_processor();
+    if(!(atomic_get(&ici_pending) & cpu_bit))
+        return;
+
+    switch(ici_msg) {
+        case SMP_MSG_INVALIDATE_TLB:
+            invalidate_TLB();
+            break;
+
+        case SMP_MSG_INVALIDATE_TLB_ENTRY:
+            invalidate_TLB_entry(ici_data);
+            break;
+
+        default:
+            break;
+    }
+
+    /* message handled */
+    atomic_and(&ici_pending, ~cpu_bit);
+}
+
+/* SMP module init */
+status_t smp_init(kernel_args_t *kargs)
+{
+    num_cpus = kargs->num_cpus;
+    spin_init(&ici_lock);
+
+    return arch_smp_init(kargs);
+}
+
+/* SMP per cpu init */
+status_t smp_init_per_cpu(kernel_args_t *kargs, uint curr_cpu)
+{
+    status_t err;
+
+    err = arch_smp_init_per_cpu(kargs, curr_cpu);
+    if(err != NO_ERROR)
+        return err;
+
+    /* now cpu is able to receive inter-CPU interrupts */
+    atomic_or(&active_cpus, 1 << curr_cpu);
+
+    return NO_ERROR;
+}
+
+/* trap non-boot cpus until bootstrap cpu completes kernel init */
+void smp_trap_non_boot_cpus(uint curr_cpu)
+{
+    if(curr_cpu == BOOTSTRAP_CPU)
+        return;
+
+    while(!boot_cpus_released)
+        cpu_relax();
+}
+
+/* release non-boot cpus */
+void smp_wake_up_non_boot_cpus(void)
+{
+    smp_wmb();
+    boot_cpus_released = 1;
+}
+
+/* returns processors count */
+uint smp_get_num_cpus(void)
+{
+    return num_cpus;
+}
+
+/* returns true if cpu is active */
+bool smp_cpu_is_active(uint cpu)
+{
+    return (atomic_get(&active_cpus) & (1 << cpu)) != 0;
+}
+
+/* request reschedule on cpu */
+void smp_send_reschedule(uint cpu)
+{
+    if(!smp_cpu_is_active(cpu))
+        return;
+
+    /* do not send interrupt if request already pending */
+    if(atomic_or_ret(&resched_requests, 1 << cpu) & (1 << cpu))
+        return;
+
+    arch_smp_send_ici(cpu);
+}
+
+/* stop or restart local timer ticks */
+void smp_set_local_timer(bool enable)
+{
+    arch_smp_set_local_timer(enable);
+}
+
+/* send message to all other cpus and wait until handled */
+void smp_send_broadcast_ici(uint msg, addr_t data)
+{
+    unsigned long irqs_state;
+    uint curr_cpu, mask, i;
+
+    if(num_cpus < 2)
+        return;
+
+    local_irqs_save_and_disable(irqs_state);
+
+    curr_cpu = get_current_processor();
+    mask = atomic_get(&active_cpus) & ~(1 << curr_cpu);
+    if(!mask) {
+        local_irqs_restore(irqs_state);
+        return;
+    }
+
+    /* handle messages sent to us while waiting for message slot */
+    while(!spin_trylock(&ici_lock)) {
+        smp_process_pending_ici();
+        cpu_relax();
+    }
+
+    /* post message */
+    ici_msg  = msg;
+    ici_data = data;
+    smp_wmb();
+    atomic_set(&ici_pending, mask);
+
+    /* and notify receivers */
+    for(i = 0; i < num_cpus; i++) {
+        if(mask & (1 << i))
+            arch_smp_send_ici(i);
+    }
+
+    /* wait until all receivers handled message */
+    while(atomic_get(&ici_pending))
+        cpu_relax();
+
+    spin_unlock(&ici_lock);
+
+    local_irqs_restore(irqs_state);
+}
+
+/* handle inter-CPU interrupt */
+flags_t smp_handle_ici(void)
+{
+    uint cpu_bit = 1 << get_current_processor();
+    flags_t ret = INT_FLAGS_NOFLAGS;
+
+    /* broadcast message */
+    smp_process_pending_ici();
+
+    /* reschedule request */
+    if(atomic_get(&resched_requests) & cpu_bit) {
+        atomic_and(&resched_requests, ~cpu_bit);
+        ret |= INT_FLAGS_RESCHED;
+    }
+
+    return ret;
+}
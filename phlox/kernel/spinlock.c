@@ -1,39 +1,119 @@
 /*
-* Copyright 2007-2010, Stepan V.Karpenko. All rights reserved.
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
 * Distributed under the terms of the PhloxOS License.
 */
+#include <phlox/kernel.h>
 #include <phlox/processor.h>
+#include <phlox/timer.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
+#include <phlox/smp.h>
+
+/* on SMP systems spinning cpu must handle broadcast messages,
+ * because lock owner may wait until message is handled.
+ */
+#if SYSCFG_SMP_SUPPORT
+#  define spin_relax()  do { smp_process_pending_ici(); cpu_relax(); } while(0)
+#else
+#  define spin_relax()  cpu_relax()
+#endif
+
+
+#if SYSCFG_SPINLOCK_STATS
+
+/* Max. number of locks in statistics table */
+#define SPIN_STATS_MAX_LOCKS  256
+
+/* Max. number of locks printed by spin_stats_dump() */
+#define SPIN_STATS_MAX_DUMP   16
+
+/* Locks with contended acquisitions */
+static spinlock_t *spin_stats_table[SPIN_STATS_MAX_LOCKS];
+static atomic_t spin_stats_count = 0;
+
+/* account acquisition. called with lock held. */
+static void spin_stats_account(spinlock_t *s, bigtime_t start, addr_t caller)
+{
+    int idx;
+
+    s->stats.acquired++;
+    if(!start)
+        return;
+
+    s->stats.contended++;
+    s->stats.spin_cycles += arch_timer_get_cycles() - start;
+    s->stats.caller = caller;
+
+    /* put lock into table on first contention */
+    if(atomic_test_and_set(&s->stats.registered, 1, 0)) {
+        idx = atomic_inc_ret(&spin_stats_count);
+        if(idx < SPIN_STATS_MAX_LOCKS)
+            spin_stats_table[idx] = s;
+    }
+}
+
+#  define SPIN_CALLER  ((addr_t)__builtin_return_address(0))
+#else
+#  define spin_stats_account(s, start, caller)
+#  define SPIN_CALLER  0
+#endif
+
+/* take ticket and spin until it is served */
+static inline void spin_acquire(spinlock_t *s, addr_t caller)
+{
+    int ticket = atomic_inc_ret(&s->next);
+#if SYSCFG_SPINLOCK_STATS
+    bigtime_t start = 0;
+
+    if(atomic_get(&s->owner) != ticket) {
+        start = arch_timer_get_cycles();
+        if(!start) start = 1; /* no cycles counter */
+    }
+#endif
+
+    while(atomic_get(&s->owner) != ticket) spin_relax();
+
+    spin_stats_account(s, start, caller);
+}
 
 
 void spin_init(spinlock_t *s)
 {
-    atomic_set(s, SPIN_UNLOCKED);
+    atomic_set(&s->next, 0);
+    atomic_set(&s->owner, 0);
 }
 
 void spin_init_locked(spinlock_t *s)
 {
-    atomic_set(s, SPIN_LOCKED);
+    atomic_set(&s->next, 1);
+    atomic_set(&s->owner, 0);
 }
 
 void spin_lock(spinlock_t *s)
 {
-    /* spin until lock is not released */
-    while(atomic_set_ret(s, SPIN_LOCKED)) cpu_relax();
+    /* spin until our turn comes */
+    spin_acquire(s, SPIN_CALLER);
 }
 
 void spin_safelock(spinlock_t *s)
 {
     /* enable interrupt requests */
     local_irqs_enable();
-    /* and spin until lock is not released */
-    while(atomic_set_ret(s, SPIN_LOCKED)) cpu_relax();
+    /* and spin until our turn comes */
+    spin_acquire(s, SPIN_CALLER);
 }
 
 int spin_trylock(spinlock_t *s)
 {
-    /* try to acquire lock */
-    return !atomic_set_ret(s, SPIN_LOCKED);
+    int owner = atomic_get(&s->owner);
+
+    /* take ticket only if it is served at once */
+    if(!atomic_test_and_set(&s->next, owner + 1, owner))
+        return 0;
+
+    spin_stats_account(s, 0, 0);
+
+    return 1;
 }
 
 unsigned long spin_lock_irqsave(spinlock_t *s)
@@ -42,32 +122,179 @@ unsigned long spin_lock_irqsave(spinlock_t *s)
 
     /* save irqs state and disable interrupts */
     local_irqs_save_and_disable(irqs_state);
-    /* and then spin until lock is not released */
-    while(atomic_set_ret(s, SPIN_LOCKED)) cpu_relax();
+    /* and then spin until our turn comes */
+    spin_acquire(s, SPIN_CALLER);
     /* return irqs state */
     return irqs_state;
 }
 
 void spin_unlock(spinlock_t *s)
 {
-    atomic_set(s, SPIN_UNLOCKED);
+    /* serve next ticket */
+    atomic_inc(&s->owner);
 }
 
 void spin_unlock_irqrstor(spinlock_t *s, unsigned long irqs_state)
 {
     /* unlock */
-    atomic_set(s, SPIN_UNLOCKED);
+    atomic_inc(&s->owner);
     /* restore irqs state */
     local_irqs_restore(irqs_state);
 }
 
 void spin_wait(spinlock_t *s)
 {
-    /* spin until lock acquired */
-    while(atomic_get(s)) cpu_relax();
+    /* spin until lock released */
+    while(spin_locked(s)) spin_relax();
 }
 
 int spin_locked(spinlock_t *s)
 {
-    return atomic_get(s);
+    return atomic_get(&s->next) != atomic_get(&s->owner);
+}
+
+
+#if SYSCFG_SPINLOCK_STATS
+
+void spin_stats_dump(uint count)
+{
+    spinlock_t *top[SPIN_STATS_MAX_DUMP];
+    uint i, j, n = 0, total;
+
+    if(count > SPIN_STATS_MAX_DUMP)
+        count = SPIN_STATS_MAX_DUMP;
+
+    total = atomic_get(&spin_stats_count);
+    if(total > SPIN_STATS_MAX_LOCKS)
+        total = SPIN_STATS_MAX_LOCKS;
+
+    /* select most contended locks.
+     * Note: counters are read without locking, values are approximate.
+     */
+    for(i = 0; i < total; i++) {
+        spinlock_t *s = spin_stats_table[i];
+        if(!s)
+            continue;
+
+        for(j = n; j > 0 && top[j-1]->stats.spin_cycles < s->stats.spin_cycles; j--) {
+            if(j < count)
+                top[j] = top[j-1];
+        }
+        if(j < count) {
+            top[j] = s;
+            if(n < count) n++;
+        }
+    }
+
+    kprint("spinlocks statistics (%d contended locks):\n", total);
+    kprint("    lock     caller   acquired  contended  spin cycles\n");
+    for(i = 0; i < n; i++) {
+        kprint("%08x %08x %10u %10u %12u\n", (addr_t)top[i], top[i]->stats.caller,
+               (uint)top[i]->stats.acquired, (uint)top[i]->stats.contended,
+               (uint)top[i]->stats.spin_cycles);
+    }
+}
+
+void spin_stats_reset(void)
+{
+    uint i, total = atomic_get(&spin_stats_count);
+
+    if(total > SPIN_STATS_MAX_LOCKS)
+        total = SPIN_STATS_MAX_LOCKS;
+
+    for(i = 0; i < total; i++) {
+        spinlock_t *s = spin_stats_table[i];
+        if(!s)
+            continue;
+
+        s->stats.acquired = 0;
+        s->stats.contended = 0;
+        s->stats.spin_cycles = 0;
+    }
+}
+
+#endif
+
+
+/*** Reader-writer spinlock ***/
+
+void rw_init(rwlock_t *l)
+{
+    atomic_set(&l->state, 0);
+}
+
+void rw_read_lock(rwlock_t *l)
+{
+    int state;
+
+    /* enter if there are no active or waiting writers */
+    while(1) {
+        state = atomic_get(&l->state);
+        if(!(state & (RWLOCK_WRITER | RWLOCK_WAITING)) &&
+           atomic_test_and_set(&l->state, state + 1, state))
+            break;
+        spin_relax();
+    }
+}
+
+unsigned long rw_read_lock_irqsave(rwlock_t *l)
+{
+    unsigned long irqs_state;
+
+    local_irqs_save_and_disable(irqs_state);
+    rw_read_lock(l);
+
+    return irqs_state;
+}
+
+void rw_read_unlock(rwlock_t *l)
+{
+    atomic_dec(&l->state);
+}
+
+void rw_read_unlock_irqrstor(rwlock_t *l, unsigned long irqs_state)
+{
+    atomic_dec(&l->state);
+    local_irqs_restore(irqs_state);
+}
+
+void rw_write_lock(rwlock_t *l)
+{
+    int state;
+
+    while(1) {
+        state = atomic_get(&l->state);
+        if(!(state & ~RWLOCK_WAITING)) {
+            /* lock is free, take it. waiting bit is cleared,
+             * other waiting writers set it again.
+             */
+            if(atomic_test_and_set(&l->state, RWLOCK_WRITER, state))
+                break;
+        } else if(!(state & RWLOCK_WAITING)) {
+            /* stop new readers */
+            atomic_test_and_set(&l->state, state | RWLOCK_WAITING, state);
+        }
+        spin_relax();
+    }
+}
+
+unsigned long rw_write_lock_irqsave(rwlock_t *l)
+{
+    unsigned long irqs_state;
+
+    local_irqs_save_and_disable(irqs_state);
+    rw_write_lock(l);
+
+    return irqs_state;
+}
+
+void rw_write_unlock(rwlock_t *l)
+{
+    atomic_sub(&l->state, RWLOCK_WRITER);
+}
+
+void rw_write_unlock_irqrstor(rwlock_t *l, unsigned long irqs_state)
+{
+    atomic_sub(&l->state, RWLOCK_WRITER);
+    local_irqs_restore(irqs_state);
 }
@@ -5,6 +5,7 @@
 #include <phlox/types.h>
 #include <phlox/processor.h>
 #include <phlox/kernel.h>
+#include <phlox/param.h>
 #include <phlox/vm.h>
 #include <phlox/errors.h>
 #include <phlox/heap.h>
@@ -13,6 +14,10 @@
 #include <phlox/process.h>
 #include <phlox/thread.h>
 #include <phlox/sem.h>
+#include <phlox/futex.h>
+#include <phlox/scheduler.h>
+#include <phlox/timer.h>
+#include <phlox/spinlock.h>
 #include <phlox/syscall.h>
 
 
@@ -42,7 +47,14 @@ void do_syscall_enter(const int syscall)
  * WARNING: syscall is a value on stack which is reused by syscall startup later.
  *          Do not modify this value!
  */
+    unsigned long irqs_state;
     thread_t *th = thread_get_current_thread();
+
+    /* charge time spent in user space */
+    local_irqs_save_and_disable(irqs_state);
+    thread_account_time(th, true);
+    local_irqs_restore(irqs_state);
+
     th->in_kernel = true;
     th->in_syscall = syscall;
 }
@@ -50,7 +62,20 @@ void do_syscall_enter(const int syscall)
 /* do processing on syscall leave */
 void do_syscall_leave(void)
 {
+    unsigned long irqs_state;
     thread_t *th = thread_get_current_thread();
+
+    /* preempt before return if higher priority thread became ready */
+    if(sched_need_resched()) {
+        local_irqs_disable();
+        sched_reschedule();
+    }
+
+    /* charge time spent in kernel */
+    local_irqs_save_and_disable(irqs_state);
+    thread_account_time(th, false);
+    local_irqs_restore(irqs_state);
+
     th->in_kernel = false;
     th->in_syscall = INVALID_SYSCALL;
 }
@@ -404,6 +429,120 @@ static status_t syscall_virtmem_free(void *ptr)
     return vm_delete_object(oid);
 }
 
+/* get thread and process execution times */
+static status_t syscall_thread_times(thread_id tid, thread_times_t *times)
+{
+    thread_times_t tmp;
+    status_t err;
+
+    /* check argument */
+    if(!times || !is_user_address((addr_t)times))
+        return ERR_INVALID_ARGS;
+
+    /* query times */
+    err = thread_get_times(tid, &tmp);
+    if(err != NO_ERROR)
+        return err;
+
+    /* copy result to user space */
+    return cpy_to_uspace(times, &tmp, sizeof(tmp));
+}
+
+/* set thread scheduling class */
+static status_t syscall_thread_set_sched(thread_id tid, int sched_class, int rt_prio)
+{
+    return thread_set_sched_class(tid, sched_class, rt_prio);
+}
+
+/* block on user space word */
+static status_t syscall_futex_wait(int *addr, int val, unsigned timeout_msec)
+{
+    if(!is_user_address((addr_t)addr))
+        return ERR_INVALID_ARGS;
+
+    return futex_wait((addr_t)addr, val, timeout_msec);
+}
+
+/* wake up threads blocked on user space word */
+static int syscall_futex_wake(int *addr, unsigned count)
+{
+    if(!is_user_address((addr_t)addr))
+        return ERR_INVALID_ARGS;
+
+    return futex_wake((addr_t)addr, count);
+}
+
+/* count down any of semaphores */
+static int syscall_sem_down_any(const sem_id *ids, unsigned count, unsigned timeout_msec,
+                                flags_t flags)
+{
+    sem_id tmp[SYS_MAX_WAIT_OBJECTS];
+    status_t err;
+
+    /* check arguments */
+    if(!ids || !is_user_address((addr_t)ids) || !count || count > SYS_MAX_WAIT_OBJECTS)
+        return ERR_INVALID_ARGS;
+
+    /* copy ids into kernel space */
+    err = cpy_from_uspace(tmp, ids, count * sizeof(sem_id));
+    if(err != NO_ERROR)
+        return err;
+
+    return sem_down_any(tmp, count, timeout_msec, flags);
+}
+
+/* count one semaphore up and another one down */
+static status_t syscall_sem_up_and_down(sem_id up_id, sem_id down_id, unsigned timeout_msec,
+                                        flags_t flags)
+{
+    return sem_up_and_down(up_id, down_id, timeout_msec, flags);
+}
+
+/* get nanoseconds since system booted up */
+static status_t syscall_system_time(bigtime_t *nsec)
+{
+    bigtime_t tmp;
+
+    /* check argument */
+    if(!nsec || !is_user_address((addr_t)nsec))
+        return ERR_INVALID_ARGS;
+
+    tmp = timer_get_time_nsec();
+
+    /* copy result to user space */
+    return cpy_to_uspace(nsec, &tmp, sizeof(tmp));
+}
+
+/* put current thread to sleep with high resolution */
+static void syscall_thread_usleep(unsigned usec)
+{
+    thread_sleep_nsec((bigtime_t)usec * 1000);
+}
+
+/* set thread timer slack */
+static status_t syscall_thread_set_timer_slack(thread_id tid, unsigned usec)
+{
+    return thread_set_timer_slack(tid, (bigtime_t)usec * 1000);
+}
+
+/* print spinlocks statistics into kernel log */
+static status_t syscall_spin_stats(unsigned count, flags_t flags)
+{
+#if SYSCFG_SPINLOCK_STATS
+    /* only system services may query kernel internals */
+    if(thread_get_current_thread()->process->process_role > PROCESS_ROLE_SERVICE)
+        return ERR_NO_PERM;
+
+    spin_stats_dump(count);
+    if(flags & SPIN_STATS_FLAG_RESET)
+        spin_stats_reset();
+
+    return NO_ERROR;
+#else
+    return syscall_not_impl();
+#endif
+}
+
 
 /* system calls table */
 const struct syscall_table_entry syscall_table[NR_SYSCALLS] = {
@@ -424,6 +563,16 @@ const struct syscall_table_entry syscall_table[NR_SYSCALLS] = {
 /* 14 */    SYSCALL_ENTRY(syscall_sem_get_by_name),
 /* 15 */    SYSCALL_ENTRY(syscall_virtmem_alloc),
 /* 16 */    SYSCALL_ENTRY(syscall_virtmem_free),
+/* 17 */    SYSCALL_ENTRY(syscall_thread_times),
+/* 18 */    SYSCALL_ENTRY(syscall_thread_set_sched),
+/* 19 */    SYSCALL_ENTRY(syscall_futex_wait),
+/* 20 */    SYSCALL_ENTRY(syscall_futex_wake),
+/* 21 */    SYSCALL_ENTRY(syscall_sem_down_any),
+/* 22 */    SYSCALL_ENTRY(syscall_sem_up_and_down),
+/* 23 */    SYSCALL_ENTRY(syscall_system_time),
+/* 24 */    SYSCALL_ENTRY(syscall_thread_usleep),
+/* 25 */    SYSCALL_ENTRY(syscall_thread_set_timer_slack),
+/* 26 */    SYSCALL_ENTRY(syscall_spin_stats),
 };
 
 /* number of entries at system calls table */
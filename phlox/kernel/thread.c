@@ -10,9 +10,12 @@
 #include <phlox/syscall.h>
 #include <phlox/heap.h>
 #include <phlox/list.h>
-#include <phlox/avl_tree.h>
+#include <phlox/mpsc_queue.h>
+#include <phlox/hash_table.h>
 #include <phlox/atomic.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
+#include <phlox/rcu.h>
 #include <phlox/processor.h>
 #include <phlox/vm.h>
 #include <phlox/timer.h>
@@ -25,6 +28,9 @@
 /* Redefinition for convenience */
 typedef xlist_t threads_list_t;
 
+/* Buckets count of threads hash table */
+#define THREADS_HASH_SIZE  256
+
 /* Thread lists types */
 enum list_types {
     ALIVE_THREADS_LIST,  /* List of alive threads */
@@ -38,32 +44,41 @@ static vuint next_thread_id;
 /* Threads list */
 static threads_list_t threads_list;
 
-/* Tree of threads for fast search by id */
-static avl_tree_t threads_tree;
+/* Hash table of threads for fast search by id.
+ * Lookups are lockless inside RCU read-side sections.
+ */
+static hash_table_t threads_hash;
+static addr_t threads_hash_area[HASH_TABLE_STATIC_SIZE(THREADS_HASH_SIZE) / sizeof(addr_t)];
 
 /* Dead threads list (for faster threads creation) */
 static threads_list_t dead_threads_list;
 
-/* List of threads in transition to dead state.
- * Valid thread states in that list is Running and Death.
+/* Queue of threads in transition to dead state.
+ * Valid thread states in that queue is Running and Death.
  * Threads in death state will be moved to dead list.
+ * Threads are queued out of threads lock, consumer side is
+ * serialized with its own lock.
 */
-static threads_list_t death_threads_list;
+static mpsc_queue_t death_threads_queue;
+static spinlock_t death_threads_lock;
 
-/* Spinlock for operations on treads lists and tree */
-static spinlock_t threads_lock;
+/* Spinlock for operations on threads lists and hash table */
+static rwlock_t threads_lock;
 
 
 /*** Locally used routines ***/
 
-/* compare routine for threads AVL tree */
-static int compare_thread_id(const void *t1, const void *t2)
+/* compare routine for threads hash table */
+static int compare_thread_id(const void *elem, const void *key)
 {
-    if( ((thread_t *)t1)->id > ((thread_t *)t2)->id )
-        return 1;
-    if( ((thread_t *)t1)->id < ((thread_t *)t2)->id )
-        return -1;
-    return 0;
+    return ((thread_t *)elem)->id != *(const thread_id *)key;
+}
+
+/* hash routine for threads hash table */
+static uint32 hash_thread_id(const void *elem, const void *key, uint range)
+{
+    thread_id tid = elem ? ((thread_t *)elem)->id : *(const thread_id *)key;
+    return tid % range;
 }
 
 /* returns available thread id */
@@ -90,9 +105,8 @@ static void put_thread_to_list_nolock(thread_t *thread)
     /* add thread to list */
     xlist_add_last(&threads_list, &thread->threads_list_node);
 
-    /* put thread into avl tree */
-    if(!avl_tree_add(&threads_tree, thread))
-      panic("put_thread_to_list_nolock(): failed to add thread into tree!\n");
+    /* put thread into hash table */
+    hash_table_insert(threads_hash, thread);
 }
 
 /* put new thread into threads list */
@@ -101,13 +115,13 @@ static void put_thread_to_list(thread_t *thread)
     unsigned long irqs_state;
 
     /* acquire lock before call to non-lock version */
-    irqs_state = spin_lock_irqsave(&threads_lock);
+    irqs_state = rw_write_lock_irqsave(&threads_lock);
 
     /* call non-lock version */
     put_thread_to_list_nolock(thread);
 
     /* release lock */
-    spin_unlock_irqrstor(&threads_lock, irqs_state);
+    rw_write_unlock_irqrstor(&threads_lock, irqs_state);
 }
 
 /* move thread from one list to another (non-lock version) */
@@ -126,7 +140,10 @@ static void move_thread_to_list_nolock(thread_t *thread, enum list_types dest_li
         /* set birth state */
         thread->state = THREAD_STATE_BIRTH;
 
-        /* put to alive threads list and tree */
+        /* new id, so stale ids of previous thread never match reused structure */
+        thread->id = get_next_thread_id();
+
+        /* put to alive threads list and hash table */
         put_thread_to_list_nolock(thread);
         break;
 
@@ -138,41 +155,37 @@ static void move_thread_to_list_nolock(thread_t *thread, enum list_types dest_li
 
         /* remove thread from list of active threads */
         xlist_remove_unsafe(&threads_list, &thread->threads_list_node);
-        /* remove thread from tree */
-        if(!avl_tree_remove(&threads_tree, thread))
-            panic("move_thread_to_list_nolock(): failed to remove thread from tree!\n");
+        /* remove thread from hash table */
+        if(hash_table_remove(threads_hash, thread))
+            panic("move_thread_to_list_nolock(): failed to remove thread from hash table!\n");
 
         /* Thread is in Running state, we can't switch state to Death here,
          * so... we set next state, after reschedule state will be correct.
          */
         thread->next_state = THREAD_STATE_DEATH;
 
-        /* add to death list */
-        xlist_add_last(&death_threads_list, &thread->threads_list_node);
+        /* NOTE: caller adds thread to death queue after threads lock release */
         break;
 
       /* Destination is dead threads list */
       case DEAD_THREADS_LIST:
-        /* Threads in Birth state contained in active threads list and tree,
-         * the ones in Death state contained only in death treads list.
+        /* Threads in Birth state contained in active threads list and hash,
+         * the ones in Death state are already taken from death threads queue.
          */
         if(thread->state == THREAD_STATE_BIRTH) {
             /* remove thread from active threads list */
             xlist_remove_unsafe(&threads_list, &thread->threads_list_node);
-            /* remove thread from tree */
-            if(!avl_tree_remove(&threads_tree, thread))
-                panic("move_thread_to_list_nolock(): failed to remove thread from tree!\n");
-        } else if(thread->state == THREAD_STATE_DEATH) {
-            /* remove thread from death list */
-            xlist_remove_unsafe(&death_threads_list, &thread->threads_list_node);
-        } else /* Only threads in Death and Birth state can be moved here */
+            /* remove thread from hash table */
+            if(hash_table_remove(threads_hash, thread))
+                panic("move_thread_to_list_nolock(): failed to remove thread from hash table!\n");
+        } else if(thread->state != THREAD_STATE_DEATH)
+            /* Only threads in Death and Birth state can be moved here */
             panic("move_thread_to_list_nolock(): Wrong thread state!");
 
         /* set as dead */
         thread->state = THREAD_STATE_DEAD;
 
-        /* add to deads list */
-        xlist_add_last(&dead_threads_list, &thread->threads_list_node);
+        /* NOTE: caller adds thread to deads list after grace period */
         break;
 
       /* panic if wrong state */
@@ -181,19 +194,40 @@ static void move_thread_to_list_nolock(thread_t *thread, enum list_types dest_li
     }
 }
 
+/* add thread to deads list after grace period */
+static void put_thread_to_dead_list_rcu(rcu_head_t *head)
+{
+    thread_t *thread = containerof(head, thread_t, rcu);
+    unsigned long irqs_state;
+
+    irqs_state = rw_write_lock_irqsave(&threads_lock);
+    xlist_add_last(&dead_threads_list, &thread->threads_list_node);
+    rw_write_unlock_irqrstor(&threads_lock, irqs_state);
+}
+
 /* move thread from one list to another */
 static void move_thread_to_list(thread_t *thread, enum list_types dest_list)
 {
     unsigned long irqs_state;
 
     /* acquire lock before calling non-lock version */
-    irqs_state = spin_lock_irqsave(&threads_lock);
+    irqs_state = rw_write_lock_irqsave(&threads_lock);
 
     /* call to non-lock version */
     move_thread_to_list_nolock(thread, dest_list);
 
     /* release lock */
-    spin_unlock_irqrstor(&threads_lock, irqs_state);
+    rw_write_unlock_irqrstor(&threads_lock, irqs_state);
+
+    /* death queue is lock-free, so no need to hold threads lock */
+    if(dest_list == DEATH_THREADS_LIST)
+        mpsc_queue_push(&death_threads_queue, &thread->death_queue_node);
+
+    /* lockless lookups may still walk through hash node of the
+     * thread, so it is reused only after grace period.
+     */
+    if(dest_list == DEAD_THREADS_LIST)
+        call_rcu(&thread->rcu, put_thread_to_dead_list_rcu);
 }
 
 /* peeks the head of dead threads list (no lock acquired) */
@@ -227,6 +261,7 @@ static thread_t *create_thread_struct(void)
     thread->in_kernel = true; /* initially thread is always executed
                                * at kernel side
                                */
+    thread->timer_slack = SYSCFG_TIMER_SLACK_NSEC;
     spin_init_locked(&thread->lock); /* thread structure initially locked */
 
     return thread;
@@ -249,6 +284,10 @@ static void deinit_thread_struct(thread_t *thread)
     thread->cpu         = NULL;
     thread->kernel_time = 0;
     thread->user_time   = 0;
+    thread->time_stamp  = 0;
+    thread->timer_slack = SYSCFG_TIMER_SLACK_NSEC;
+    thread->pi_prio     = 0;
+    thread->pi_locks    = 0;
     thread->entry       = 0;
     thread->data        = NULL;
 
@@ -266,27 +305,56 @@ static void deinit_thread_struct(thread_t *thread)
     );
 }
 
-/* moves threads in death state from death list to dead list */
-static void purge_death_threads_list_nolock(void)
+/* moves threads in death state from death queue to dead list */
+static void purge_death_threads_queue(void)
 {
-    list_elem_t *iter = xlist_peek_first(&death_threads_list);
+    mpsc_queue_elem_t *e, *dead = NULL, *running = NULL;
+    unsigned long irqs_state;
     thread_t *thread;
 
-    while(iter != NULL) {
-        /* get thread structure */
-        thread = containerof(iter, thread_t, threads_list_node);
+    /* queue has single consumer, so purgers are serialized */
+    irqs_state = spin_lock_irqsave(&death_threads_lock);
 
-        /* move iterator to next item */
-        iter = iter->next;
+    while( (e = mpsc_queue_pop(&death_threads_queue)) != NULL ) {
+        /* get thread structure */
+        thread = containerof(e, thread_t, death_queue_node);
 
-        /* move to dead list if in death state */
+        /* collect threads in death state, still running
+         * ones are kept for the next time.
+         */
         if(thread->state == THREAD_STATE_DEATH) {
-            /* deinit structure ... */
-            deinit_thread_struct(thread);
-            /* ... and move to deads */
-            move_thread_to_list_nolock(thread, DEAD_THREADS_LIST);
+            e->next = dead;
+            dead = e;
+        } else {
+            e->next = running;
+            running = e;
         }
     }
+
+    spin_unlock_irqrstor(&death_threads_lock, irqs_state);
+
+    /* put back threads not switched out yet */
+    while(running != NULL) {
+        e = running;
+        running = e->next;
+        mpsc_queue_push(&death_threads_queue, e);
+    }
+
+    if(!dead)
+        return;
+
+    /* deinit structures, they are not reachable through
+     * threads list and hash table already.
+     */
+    for(e = dead; e != NULL; e = e->next)
+        deinit_thread_struct(containerof(e, thread_t, death_queue_node));
+
+    /* move to deads */
+    while(dead != NULL) {
+        e = dead;
+        dead = e->next;
+        move_thread_to_list(containerof(e, thread_t, death_queue_node), DEAD_THREADS_LIST);
+    }
 }
 
 /* get not used or create new thread structure */
@@ -295,11 +363,11 @@ static thread_t *get_thread_struct(void)
     unsigned long irqs_state;
     thread_t *thread;
 
-    /* acquire lock before touching dead threads list */
-    irqs_state = spin_lock_irqsave(&threads_lock);
-
     /* move threads in death state to deads list */
-    purge_death_threads_list_nolock();
+    purge_death_threads_queue();
+
+    /* acquire lock before touching dead threads list */
+    irqs_state = rw_write_lock_irqsave(&threads_lock);
 
     /* peek first item in list */
     thread = peek_dead_list_nolock();
@@ -308,7 +376,7 @@ static thread_t *get_thread_struct(void)
         move_thread_to_list_nolock(thread, ALIVE_THREADS_LIST);
 
     /* release lock */
-    spin_unlock_irqrstor(&threads_lock, irqs_state);
+    rw_write_unlock_irqrstor(&threads_lock, irqs_state);
 
     /* if no thread struct selected - create new one */
     if(!thread) {
@@ -373,6 +441,11 @@ static int stub_for_user_thread(void)
     /* notify scheduler about new thread start */
     sched_complete_context_switch();
 
+    /* charge kernel time before entering user space */
+    local_irqs_disable();
+    thread_account_time(thread, false);
+    local_irqs_enable();
+
     thread->in_kernel = false; /* leaving kernel */
 
     /* pass control to user-space code */
@@ -491,19 +564,18 @@ status_t threading_init(kernel_args_t *kargs, uint curr_cpu)
         next_thread_id = 1;
 
         /* spinlock for data structures access */
-        spin_init(&threads_lock);
+        rw_init(&threads_lock);
 
         /* threads lists */
         xlist_init(&threads_list);
         xlist_init(&dead_threads_list);
-        xlist_init(&death_threads_list);
-
-        /* threads tree */
-        avl_tree_create( &threads_tree, compare_thread_id,
-                         sizeof(thread_t),
-                         offsetof(thread_t, threads_tree_node) );
-    } else {
-      /* TODO: wait for bootstrap cpu completes */
+        mpsc_queue_init(&death_threads_queue);
+        spin_init(&death_threads_lock);
+
+        /* threads hash table */
+        threads_hash = hash_table_init_static( threads_hash_area, sizeof(threads_hash_area),
+                                               offsetof(thread_t, threads_hash_node),
+                                               compare_thread_id, hash_thread_id );
     }
 
     /* start per CPU initializations */
@@ -622,20 +694,18 @@ thread_t *thread_get_current_thread(void)
 /* return structure for specified thread */
 thread_t *thread_get_thread_struct(thread_id tid)
 {
-    thread_t *look_for, *thread;
     unsigned long irqs_state;
+    thread_t *thread;
 
-    /* init data for search */
-    look_for = containerof(&tid, thread_t, id);
-
-    /* lock threads containers before touching */
-    irqs_state = spin_lock_irqsave(&threads_lock);
+    /* lockless search, structures are never freed and
+     * reused only after grace period.
+     */
+    irqs_state = rcu_read_lock();
 
     /* search for thread */
-    thread = avl_tree_find(&threads_tree, look_for, NULL);
+    thread = hash_table_lookup(threads_hash, &tid);
 
-    /* release lock */
-    spin_unlock_irqrstor(&threads_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return thread;
 }
@@ -712,6 +782,8 @@ thread_id thread_create_kernel_thread(const char *name, int (*func)(void *data),
     /* set default priority and scheduling policy */
     thread->sched_policy.raw = thread->process->def_sched_policy.raw;
     thread->s_prio = thread->process->def_prio;
+    thread->sched_class = THREAD_SCHED_NORMAL;
+    thread->rt_prio = 0;
 
     /* init arch-specific parts, before setting other arch-dependend
      * options.
@@ -831,6 +903,8 @@ thread_id thread_create_user_thread(const char *name, process_t *proc, addr_t en
     /* set default priority and scheduling policy */
     thread->sched_policy.raw = thread->process->def_sched_policy.raw;
     thread->s_prio = thread->process->def_prio;
+    thread->sched_class = THREAD_SCHED_NORMAL;
+    thread->rt_prio = 0;
 
     /* init arch-specific parts, before setting other arch-dependend
      * options.
@@ -894,20 +968,27 @@ exit_on_error:
 /* transfer control to another thread */
 void thread_yield(void)
 {
-    /* before we proceed - disable interrupts and acquire
-     * scheduling lock.
-     */
-     local_irqs_disable();
-     sched_lock_acquire();
+    /* before we proceed - disable interrupts */
+    local_irqs_disable();
 
     /* perform rescheduling, stop current thread
      * and select new one for execution.
-     * this also enables local interrupts and releases
-     * scheduling lock.
+     * this also enables local interrupts.
      */
     sched_reschedule();
 }
 
+/* transfer control to specified thread */
+void thread_yield_to(thread_t *thread)
+{
+    /* disable interrupts, so hint is not consumed by preemption */
+    local_irqs_disable();
+
+    /* ask scheduler to pick this thread and reschedule */
+    sched_yield_to(thread);
+    sched_reschedule();
+}
+
 /* terminate current thread with specified exit code */
 void thread_exit(int exitcode)
 {
@@ -950,6 +1031,11 @@ void thread_exit(int exitcode)
     /* lock thread before */
     thread_lock_thread(thread);
 
+    /* charge last time slice, thread times are passed
+     * to process on detach.
+     */
+    thread_account_time(thread, false);
+
     /* detach thread from process */
     proc_detach_thread(process, thread);
     /* move to death list */
@@ -960,11 +1046,8 @@ void thread_exit(int exitcode)
 
     /* unlock and call reschedule */
     thread_unlock_thread(thread);
-    sched_lock_acquire();
     sched_reschedule();
-    /* NOTE: interrupts will be enabled during rescheduling
-     *       as far as scheduling lock will be released.
-     */
+    /* NOTE: interrupts will be enabled during rescheduling. */
 
     /** control never goes here **/
 }
@@ -989,11 +1072,8 @@ status_t thread_suspend_current(void)
 
     /* unlock thread and reschedule */
     thread_unlock_thread(thread);
-    sched_lock_acquire();
     sched_reschedule();
-    /* NOTE: interrupts will be reenabled during rescheduling and scheduling lock
-     *       will be released.
-     */
+    /* NOTE: interrupts will be reenabled during rescheduling. */
 
     return NO_ERROR;
 }
@@ -1030,10 +1110,9 @@ status_t thread_suspend(thread_id tid)
      * if true - reschedule immediately, interrupts will be
      * reenabled during rescheduling.
     */
-    if(thread_get_current_thread_id() == tid) {
-        sched_lock_acquire();
+    if(thread_get_current_thread_id() == tid)
         sched_reschedule();
-    } else
+    else
         local_irqs_enable();
 
     return NO_ERROR;
@@ -1085,11 +1164,35 @@ void thread_sleep(uint msec)
 
     /* unlock thread and reschedule */
     thread_unlock_thread(thread);
-    sched_lock_acquire();
     sched_reschedule();
-    /* NOTE: interrupts will be reenabled during rescheduling and scheduling lock
-     *       will be released.
+    /* NOTE: interrupts will be reenabled during rescheduling. */
+}
+
+/* put current thread to sleep with high resolution */
+void thread_sleep_nsec(bigtime_t nsec)
+{
+    thread_t *thread;
+
+    /* just switch to another thread if time
+     * was not specified
      */
+    if(nsec <= 0) {
+        thread_yield();
+        return;
+    }
+
+    /* disable interrupts and take current thread */
+    local_irqs_disable();
+    thread = thread_get_current_thread_locked();
+
+    /* add thread to high-resolution events of the timer */
+    if(IS_THREAD_NEXSTATE_READY(thread) || IS_THREAD_NEXSTATE_RUNNING(thread))
+        timer_lull_thread_nsec(thread, nsec);
+
+    /* unlock thread and reschedule */
+    thread_unlock_thread(thread);
+    sched_reschedule();
+    /* NOTE: interrupts will be reenabled during rescheduling. */
 }
 
 /* put thread to sleep by its id */
@@ -1144,7 +1247,7 @@ status_t thread_sleep_id(thread_id tid, uint msec)
 /* register termination callback */
 thread_cbd_t *thread_register_term_cb(thread_cbd_t *cbd)
 {
-    ASSERT_MSG(cbd->thread->lock != 0,
+    ASSERT_MSG(spin_locked(&cbd->thread->lock),
         "thread_register_term_cb(): thread was not locked.");
 
     /* put callback to callbacks list of the thread */
@@ -1156,7 +1259,7 @@ thread_cbd_t *thread_register_term_cb(thread_cbd_t *cbd)
 /* unregister termination callback */
 void thread_unregister_term_cb(thread_cbd_t *cbd)
 {
-    ASSERT_MSG(cbd->thread->lock != 0,
+    ASSERT_MSG(spin_locked(&cbd->thread->lock),
         "thread_unregister_term_cb(): thread was not locked.");
 
     /* remove callback from the callbacks list */
@@ -1184,7 +1287,7 @@ process_t *thread_get_process(thread_t *thread)
 /* return process data without locking thread */
 process_t *thread_get_process_nolock(thread_t *thread)
 {
-    ASSERT_MSG(thread->lock != 0, "thread_get_process_nolock(): thread was not locked.");
+    ASSERT_MSG(spin_locked(&thread->lock), "thread_get_process_nolock(): thread was not locked.");
     return (thread->process) ? proc_inc_refcnt(thread->process) : NULL;
 }
 
@@ -1206,3 +1309,127 @@ proc_id thread_get_process_id(thread_t *thread)
 
     return id;
 }
+
+/* return thread and process execution times */
+status_t thread_get_times(thread_id tid, thread_times_t *times)
+{
+    unsigned long irqs_state;
+    thread_t *current = thread_get_current_thread();
+    thread_t *thread;
+    process_t *proc;
+    bigtime_t kernel_time, user_time;
+
+    local_irqs_save_and_disable(irqs_state);
+
+    /* lock requested thread */
+    thread = (tid == 0) ? current : thread_get_thread_struct(tid);
+    if(thread == NULL) {
+        local_irqs_restore(irqs_state);
+        return ERR_MT_INVALID_HANDLE;
+    }
+    thread_lock_thread(thread);
+
+    /* only threads of the same process are visible */
+    if(thread->process != current->process) {
+        thread_unlock_thread(thread);
+        local_irqs_restore(irqs_state);
+        return ERR_NO_PERM;
+    }
+
+    /* bring current thread times up to date */
+    if(thread == current)
+        thread_account_time(thread, false);
+
+    kernel_time = thread->kernel_time;
+    user_time   = thread->user_time;
+    proc = thread_get_process_nolock(thread);
+
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+
+    times->thread_kernel_time = arch_timer_cycles_to_usec(kernel_time);
+    times->thread_user_time   = arch_timer_cycles_to_usec(user_time);
+
+    /* process totals */
+    proc_get_times(proc, &kernel_time, &user_time);
+    proc_put_process(proc);
+
+    times->process_kernel_time = arch_timer_cycles_to_usec(kernel_time);
+    times->process_user_time   = arch_timer_cycles_to_usec(user_time);
+
+    return NO_ERROR;
+}
+
+/* set thread timer slack */
+status_t thread_set_timer_slack(thread_id tid, bigtime_t nsec)
+{
+    unsigned long irqs_state;
+    thread_t *current = thread_get_current_thread();
+    thread_t *thread;
+    status_t err = NO_ERROR;
+
+    if(nsec < 0)
+        return ERR_INVALID_ARGS;
+
+    local_irqs_save_and_disable(irqs_state);
+
+    /* lock requested thread */
+    thread = (tid == 0) ? current : thread_get_thread_struct(tid);
+    if(thread == NULL) {
+        local_irqs_restore(irqs_state);
+        return ERR_MT_INVALID_HANDLE;
+    }
+    thread_lock_thread(thread);
+
+    /* structure may be reused by another thread since lookup */
+    if(thread->id != tid && tid != 0)
+        err = ERR_MT_INVALID_HANDLE;
+    /* only threads of the same process may be changed */
+    else if(thread->process != current->process)
+        err = ERR_NO_PERM;
+    else
+        thread->timer_slack = nsec;
+
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+
+    return err;
+}
+
+/* set thread scheduling class */
+status_t thread_set_sched_class(thread_id tid, int sched_class, int rt_prio)
+{
+    unsigned long irqs_state;
+    thread_t *current = thread_get_current_thread();
+    thread_t *thread;
+    status_t err;
+
+    /* ordinary user processes cannot starve the system */
+    if(sched_class != THREAD_SCHED_NORMAL &&
+       current->process->process_role > PROCESS_ROLE_SERVICE)
+        return ERR_NO_PERM;
+
+    local_irqs_save_and_disable(irqs_state);
+
+    /* lock requested thread */
+    thread = (tid == 0) ? current : thread_get_thread_struct(tid);
+    if(thread == NULL) {
+        local_irqs_restore(irqs_state);
+        return ERR_MT_INVALID_HANDLE;
+    }
+    thread_lock_thread(thread);
+
+    /* structure may be reused by another thread since lookup */
+    if(thread->id != tid && tid != 0)
+        err = ERR_MT_INVALID_HANDLE;
+    /* only threads of the same process may be changed */
+    else if(thread->process != current->process)
+        err = ERR_NO_PERM;
+    else
+        err = sched_set_thread_class(thread, sched_class, rt_prio);
+
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+
+    return err;
+}
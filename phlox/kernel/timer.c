@@ -2,6 +2,7 @@
 * Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
 * Distributed under the terms of the PhloxOS License.
 */
+#include <string.h>
 #include <sys/debug.h>
 #include <phlox/errors.h>
 #include <phlox/processor.h>
@@ -10,19 +11,20 @@
 #include <phlox/thread_private.h>
 #include <phlox/scheduler.h>
 #include <phlox/spinlock.h>
-#include <phlox/avl_tree.h>
 #include <phlox/list.h>
+#include <phlox/hash_table.h>
 #include <phlox/heap.h>
+#include <phlox/workqueue.h>
+#include <phlox/vm.h>
+#include <phlox/vm_page.h>
 #include <phlox/timer.h>
-
-
-/* redefinition for convenience */
-typedef xlist_t events_queue_t;
+#include <phlox/smp.h>
 
 
 /* timer event type */
 typedef struct event_struct {
-    int delta;     /* timer ticks delta */
+    uint expires;  /* expiration tick of timing wheel */
+    int level;     /* timing wheel level, -1 if not in wheel */
 
     bool timeout;  /* is timeout call? */
     union {
@@ -33,15 +35,44 @@ typedef struct event_struct {
             bool canceled;                             /* is canceled? */
             void (*timeout_routine)(timeout_id,void*); /* ptr to routine */
             void *data;                                /* user data */
+            uint cpu;                                  /* cpu to call routine on */
+            work_t work;                               /* deferred call */
         };
         /* valid if timeout is false */
-        thread_t *thread;
+        struct {
+            thread_t *thread;    /* thread to wake up */
+            bigtime_t deadline;  /* high-resolution expiration time, nsec */
+        };
     };
-    list_elem_t list_node;
-    avl_tree_node_t tree_node;
+    list_elem_t list_node;  /* also a free events pool node */
+    hash_node_t hash_node;
 } event_t;
 
 
+/* Minimal ticks count to stop system timer on idle */
+#define TIMER_IDLE_MIN_TICKS  2
+
+/* Hierarchical timing wheel geometry. Level 0 slots are ticks,
+ * slots of each next level are whole rounds of previous level.
+ */
+#define TIMER_WHEEL_BITS       6
+#define TIMER_WHEEL_SLOTS      (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK       (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS     4
+#define TIMER_WHEEL_MAX_TICKS  ((1U << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)) - 1)
+
+/* Name of shared time page object */
+#define TIMER_TIME_PAGE_NAME  "time_page"
+
+/* Events pool size. Pool is initially filled with static events
+ * and grows by heap allocated chunks when exhausted.
+ */
+#define TIMER_EVENTS_POOL_SIZE   128
+#define TIMER_EVENTS_POOL_CHUNK  32
+
+/* Buckets count of timeout calls hash table */
+#define TIMEOUTS_HASH_SIZE  1024
+
 /* Timer ticks counter */
 static volatile bigtime_t timer_ticks = 0;
 
@@ -49,36 +80,67 @@ static volatile bigtime_t timer_ticks = 0;
 static vuint next_timeout_id;
 
 /* Timer events */
-spinlock_t events_lock; /* access lock for queues below */
-events_queue_t events_queue;
-events_queue_t ready_timeouts_queue;
-
-int events_ticks_lost = 0;
-
-/* Timeout calls handler thread */
-thread_t *timeout_calls_thread = NULL;
-
-/* Tree of timeout calls for fast search by id */
-static avl_tree_t timeouts_tree;
-spinlock_t timeouts_lock;
+static spinlock_t events_lock; /* access lock for wheel and hash table below */
+static list_elem_t timer_wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint timer_wheel_counts[TIMER_WHEEL_LEVELS]; /* events count on each level */
+static uint timer_wheel_next; /* next tick to be processed by wheel */
+
+static int events_ticks_lost = 0;
+
+/* Free events pool. Events are never returned to heap. */
+static spinlock_t events_pool_lock; /* access lock for pool list */
+static list_elem_t events_pool;
+static event_t events_pool_area[TIMER_EVENTS_POOL_SIZE];
+
+/* High-resolution events sorted by deadline */
+static spinlock_t hr_events_lock; /* access lock for queue below */
+static xlist_t hr_events_queue;
+
+/* High-resolution clock state */
+static bool hr_clock = false;         /* processor cycles counter is used */
+static bigtime_t hr_boot_cycles = 0;  /* cycles counter value at timer init */
+
+/* Shared time page. Updated under tick lock. */
+static object_id time_page_id = VM_INVALID_OBJECTID;
+static time_page_t *time_page = NULL;
+
+/* Hash table of timeout calls for fast search by id */
+static hash_table_t timeouts_hash;
+static addr_t timeouts_hash_area[HASH_TABLE_STATIC_SIZE(TIMEOUTS_HASH_SIZE) / sizeof(addr_t)];
+
+/* Access lock for ticks counter updates, dynamic tick state
+ * and shared time page.
+ */
+static spinlock_t tick_lock;
+
+#if SYSCFG_DYNAMIC_TICK
+/* Dynamic tick state. System timer is stopped on idle bootstrap cpu. */
+static bool tick_stopped = false;    /* system timer is in one-shot mode */
+static bool tick_swallow = false;    /* pending tick was already counted */
+static bigtime_t tick_wakeup = 0;    /* one-shot expiration tick */
+static bigtime_t tick_wakeup_nsec = 0; /* one-shot expiration time */
+#endif
 
 /* called from from timer handler */
-static bool timer_schedule_event(void);
+static bool timer_schedule_event(int ticks);
 
 
 /*** Locally used routines ***/
 
-/* compare routine for timeouts AVL tree */
-static int compare_timeout_id(const void *e1, const void *e2)
+/* compare routine for timeouts hash table */
+static int compare_timeout_id(const void *elem, const void *key)
 {
-    ASSERT_MSG(((event_t *)e1)->timeout && ((event_t *)e2)->timeout,
+    ASSERT_MSG(((event_t *)elem)->timeout,
         "compare_timeout_id(): not a timeout call!\n");
 
-    if( ((event_t *)e1)->id > ((event_t *)e2)->id )
-        return 1;
-    if( ((event_t *)e1)->id < ((event_t *)e2)->id )
-        return -1;
-    return 0;
+    return ((event_t *)elem)->id != *(const timeout_id *)key;
+}
+
+/* hash routine for timeouts hash table */
+static uint32 hash_timeout_id(const void *elem, const void *key, uint range)
+{
+    timeout_id tid = elem ? ((event_t *)elem)->id : *(const timeout_id *)key;
+    return tid % range;
 }
 
 /* returns available timeout id */
@@ -94,136 +156,300 @@ static timeout_id get_next_timeout_id(void)
     return retval;
 }
 
-/* returns pointer to next event */
-static inline event_t *peek_next_event(event_t *e)
+/* put event into timing wheel slot according to its expiration tick */
+static void timer_wheel_insert(event_t *evt)
 {
-    if(!e || !xlist_peek_next(&e->list_node))
-        return NULL;
-    else
-        return containerof(xlist_peek_next(&e->list_node), event_t, list_node);
+    uint idx = evt->expires - timer_wheel_next;
+    uint expires = evt->expires;
+    int level;
+
+    /* too far event goes to farthest slot and will be
+     * put back into wheel when the slot cascades.
+     */
+    if(idx > TIMER_WHEEL_MAX_TICKS) {
+        idx = TIMER_WHEEL_MAX_TICKS;
+        expires = timer_wheel_next + idx;
+    }
+
+    /* find level covering the time left */
+    for(level = 0; level < TIMER_WHEEL_LEVELS - 1; level++) {
+        if(idx < (1U << (TIMER_WHEEL_BITS * (level + 1))))
+            break;
+    }
+
+    clist_add_tail(&timer_wheel[level][(expires >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK],
+                   &evt->list_node);
+    timer_wheel_counts[level]++;
+    evt->level = level;
 }
 
-/* returns pointer to first event */
-static inline event_t *peek_first_event(void)
+/* remove event from timing wheel */
+static inline void timer_wheel_remove(event_t *evt)
 {
-    list_elem_t *e = xlist_peek_first(&events_queue);
-    if(!e)
-        return NULL;
-    else
-        return containerof(e, event_t, list_node);
+    clist_remove(&evt->list_node);
+    timer_wheel_counts[evt->level]--;
+    evt->level = -1;
 }
 
-/* extract first event */
-static inline event_t *extract_first_event(void)
+/* move events of upper level slot into lower levels */
+static void timer_wheel_cascade(int level, uint slot)
 {
-    list_elem_t *e = xlist_extract_first(&events_queue);
-    if(!e)
-        return NULL;
-    else
-        return containerof(e, event_t, list_node);
+    list_elem_t *head = &timer_wheel[level][slot];
+    list_elem_t list, *e;
+    event_t *evt;
+
+    if(clist_isempty(head))
+        return;
+
+    /* detach slot contents first, far events may go back into it */
+    list.next = head->next;
+    list.prev = head->prev;
+    list.next->prev = &list;
+    list.prev->next = &list;
+    clist_init(head);
+
+    while((e = clist_extract_head(&list)) != NULL) {
+        evt = containerof(e, event_t, list_node);
+        timer_wheel_counts[level]--;
+        timer_wheel_insert(evt);
+    }
 }
 
-/* extract and destroy first event */
-static inline void destroy_first_event(void)
+/* returns true if timing wheel has no events */
+static inline bool timer_wheel_isempty(void)
 {
-    list_elem_t *e = xlist_extract_first(&events_queue);
-    if(!e)
-        return;
-    kfree( containerof(e, event_t, list_node) );
+    int level;
+
+    for(level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if(timer_wheel_counts[level])
+            return false;
+    }
+
+    return true;
 }
 
-/* adds new event into queue */
-static void add_new_event_nolock(event_t *new_evt, int tick)
+/* adds new event into timing wheel */
+static uint add_new_event_nolock(event_t *new_evt, uint ticks, uint slack)
 {
-    event_t *evt = peek_first_event();
+    uint gran = 1, tick, last;
+    bool joined = false;
 
-    /* search for event to insert new event before */
-    while(evt != NULL) {
-        if(tick < evt->delta) {
-            evt->delta -= tick;
-            break;
-        } else if(tick == evt->delta) {
-            tick = 0;
-            evt = peek_next_event(evt);
-            break;
-        } else {
-            tick -= evt->delta;
+    /* zero ticks event expires on next tick */
+    if(!ticks)
+        ticks = 1;
+
+    new_evt->expires = timer_wheel_next + ticks - 1;
+
+    if(slack > TIMER_WHEEL_MAX_TICKS)
+        slack = TIMER_WHEEL_MAX_TICKS;
+
+    /* join earliest event expiring within slack window. only
+     * level 0 is searched, its slots hold single ticks.
+     */
+    if(slack && timer_wheel_counts[0]) {
+        last = new_evt->expires + slack;
+        if(last - timer_wheel_next > TIMER_WHEEL_MASK)
+            last = timer_wheel_next + TIMER_WHEEL_MASK;
+        for(tick = new_evt->expires; (int)(last - tick) >= 0; tick++) {
+            if(!clist_isempty(&timer_wheel[0][tick & TIMER_WHEEL_MASK])) {
+                new_evt->expires = tick;
+                joined = true;
+                break;
+            }
         }
-        evt = peek_next_event(evt);
     }
 
-    new_evt->delta = tick; /* tick contains delta */
-
-    /* add into queue */
-    if(evt != NULL) {
-       xlist_insert_before_unsafe(&events_queue, &evt->list_node, &new_evt->list_node);
-    } else {
-       xlist_add_last(&events_queue, &new_evt->list_node);
+    /* otherwise round up to largest power of two granularity
+     * not exceeding slack window, so events of different
+     * threads fall into the same slot.
+     */
+    if(!joined) {
+        while((gran << 1) <= slack + 1)
+            gran <<= 1;
+        new_evt->expires = (new_evt->expires + gran - 1) & ~(gran - 1);
+
+        /* rounding must not move event beyond wheel range */
+        if(new_evt->expires - timer_wheel_next > TIMER_WHEEL_MAX_TICKS)
+            new_evt->expires = timer_wheel_next + TIMER_WHEEL_MAX_TICKS;
     }
+
+    timer_wheel_insert(new_evt);
+
+    /* ticks count until expiration */
+    return new_evt->expires - timer_wheel_next + 1;
 }
 
-/* extract timeout event from the appropriate queue */
-static inline event_t *extract_timeout_event(void)
+/* adds high-resolution event into queue in order of deadlines.
+ * deadline is moved to the next event deadline if it is within
+ * slack window, so both events expire with one wakeup.
+ * returns true if event became first in queue.
+ */
+static bool add_new_hr_event_nolock(event_t *new_evt, bigtime_t slack)
 {
-    list_elem_t *e = xlist_extract_first(&ready_timeouts_queue);
-    if(!e)
-        return NULL;
+    list_elem_t *e = xlist_peek_first(&hr_events_queue);
+    bigtime_t latest = new_evt->deadline + slack;
+    bool coalesced = false;
+    event_t *evt;
+
+    /* search for event to insert new event before */
+    while(e != NULL) {
+        evt = containerof(e, event_t, list_node);
+        if(evt->deadline > new_evt->deadline) {
+            if(coalesced || evt->deadline > latest)
+                break;
+            new_evt->deadline = evt->deadline;
+            coalesced = true;
+        }
+        e = xlist_peek_next(e);
+    }
+
+    /* add into queue */
+    if(e != NULL)
+        xlist_insert_before_unsafe(&hr_events_queue, e, &new_evt->list_node);
     else
-        return containerof(e, event_t, list_node);
+        xlist_add_last(&hr_events_queue, &new_evt->list_node);
+
+    return xlist_peek_first(&hr_events_queue) == &new_evt->list_node;
 }
 
-/* enqueue timeout event into appropriate queue */
-static void enqueue_timeout_event(event_t *evt)
+/* returns deadline of nearest high-resolution event, 0 if none */
+static bigtime_t timer_hr_next_deadline(void)
 {
-    xlist_add_last(&ready_timeouts_queue, &evt->list_node);
+    bigtime_t deadline = 0;
+    list_elem_t *e;
+
+    spin_lock(&hr_events_lock);
+    e = xlist_peek_first(&hr_events_queue);
+    if(e != NULL)
+        deadline = containerof(e, event_t, list_node)->deadline;
+    spin_unlock(&hr_events_lock);
+
+    return deadline;
 }
 
-/* timeout calls handler thread routine */
-static int timeout_calls_handler(void *data)
+/* update shared time page. tick lock must be held by caller. */
+static inline void timer_update_time_page(void)
+{
+    if(!time_page)
+        return;
+
+    /* readers retry while sequence is odd or changed */
+    time_page->seq++;
+    smp_wmb();
+    time_page->ticks = timer_ticks;
+    smp_wmb();
+    time_page->seq++;
+}
+
+/* create shared time page and map it into kernel space */
+static status_t timer_create_time_page(void)
 {
     unsigned long irqs_state;
-    event_t *evt;
+    time_page_t *tp;
+    vm_page_t *page;
+    addr_t vaddr;
+    status_t err;
 
-    while(1) {
-         /* acquire events queue lock */
-         irqs_state = spin_lock_irqsave(&events_lock);
-         evt = extract_timeout_event();
-         /* release events queue lock */
-         spin_unlock_irqrstor(&events_lock, irqs_state);
-
-         /* suspend if no events in queue, will be resumed
-          * when new event be added.
-          */
-         if(!evt) {
-             thread_suspend_current();
-             continue;
-         }
-
-        ASSERT_MSG(evt->timeout, "timeout_calls_handler(): not a timeout call!\n");
-
-        /* call routine only if event was not canceled */
-        spin_lock(&evt->run_lock); /* set lock to mark running event */
-        if(!evt->canceled) {
-            evt->timeout_routine(evt->id, evt->data);
-        }
-        spin_unlock(&evt->run_lock); /* clear lock */
+    /* reserve physical page for the object */
+    page = vm_page_alloc(VM_PAGE_STATE_CLEAR);
+    vm_page_set_state(page, VM_PAGE_STATE_UNUSED);
 
-        /** Remove event data from tree and free it **/
+    time_page_id = vm_create_physmem_object(TIMER_TIME_PAGE_NAME, page->ppn * PAGE_SIZE, PAGE_SIZE,
+                        VM_OBJECT_PROTECT_READ | VM_OBJECT_PROTECT_WRITE);
+    if(time_page_id == VM_INVALID_OBJECTID)
+        return ERR_VM_GENERAL;
 
-        /* acquire events lock */
-        irqs_state = spin_lock_irqsave(&timeouts_lock);
+    err = vm_map_object(vm_get_kernel_aspace_id(), time_page_id, VM_PROT_KERNEL_DEFAULT, &vaddr);
+    if(err != NO_ERROR) {
+        vm_delete_object(time_page_id); /* actually, recovery is not expected */
+        return err;
+    }
 
-        /* remove from tree */
-        if(!avl_tree_remove(&timeouts_tree, evt))
-            panic("timeout_calls_handler(): failed to remove event from tree.");
+    /* fill constant part */
+    tp = (time_page_t *)vaddr;
+    memset(tp, 0, PAGE_SIZE);
+    tp->cycles_khz = hr_clock ? arch_timer_get_cycles_khz() : 0;
+    tp->cycles_base = hr_boot_cycles;
+    tp->nsec_per_tick = TIMER_NSEC_PER_TICK;
 
-        /* release events lock */
-        spin_unlock_irqrstor(&timeouts_lock, irqs_state);
+    /* publish to timer interrupt */
+    irqs_state = spin_lock_irqsave(&tick_lock);
+    time_page = tp;
+    timer_update_time_page();
+    spin_unlock_irqrstor(&tick_lock, irqs_state);
+
+    return NO_ERROR;
+}
+
+/* put events into free pool */
+static void put_free_events(event_t *evts, uint count)
+{
+    unsigned long irqs_state;
+    uint i;
+
+    irqs_state = spin_lock_irqsave(&events_pool_lock);
+    for(i = 0; i < count; i++)
+        clist_add_head(&events_pool, &evts[i].list_node);
+    spin_unlock_irqrstor(&events_pool_lock, irqs_state);
+}
 
-        kfree(evt); /* return memory to kernel */
+/* allocate event from pool */
+static event_t *alloc_event(void)
+{
+    unsigned long irqs_state;
+    list_elem_t *e;
+    event_t *chunk;
+
+    while(1) {
+        irqs_state = spin_lock_irqsave(&events_pool_lock);
+        e = clist_extract_head(&events_pool);
+        spin_unlock_irqrstor(&events_pool_lock, irqs_state);
+
+        if(e)
+            return containerof(e, event_t, list_node);
+
+        /* pool exhausted, grow it */
+        chunk = (event_t*)kmalloc(sizeof(event_t) * TIMER_EVENTS_POOL_CHUNK);
+        if(!chunk)
+            return NULL;
+        put_free_events(chunk, TIMER_EVENTS_POOL_CHUNK);
     }
+}
 
-    return 0; /* control never goes here, but keep compiler happy */
+/* return event to pool. may be called from interrupt handler. */
+static inline void free_event(event_t *evt)
+{
+    put_free_events(evt, 1);
+}
+
+/* timeout call deferred work routine */
+static void timeout_call_work(work_t *work)
+{
+    event_t *evt = containerof(work, event_t, work);
+    unsigned long irqs_state;
+
+    ASSERT_MSG(evt->timeout, "timeout_call_work(): not a timeout call!\n");
+
+    /* call routine only if event was not canceled */
+    spin_lock(&evt->run_lock); /* set lock to mark running event */
+    if(!evt->canceled) {
+        evt->timeout_routine(evt->id, evt->data);
+    }
+    spin_unlock(&evt->run_lock); /* clear lock */
+
+    /** Remove event data from hash table and free it **/
+
+    /* acquire events lock */
+    irqs_state = spin_lock_irqsave(&events_lock);
+
+    /* remove from hash table */
+    if(hash_table_remove(timeouts_hash, evt))
+        panic("timeout_call_work(): failed to remove event from hash table.");
+
+    /* release events lock */
+    spin_unlock_irqrstor(&events_lock, irqs_state);
+
+    free_event(evt); /* return event to pool */
 }
 
 
@@ -231,6 +457,7 @@ static int timeout_calls_handler(void *data)
 status_t timer_init(kernel_args_t *kargs)
 {
     status_t err;
+    int level, slot;
 
     /* call architecture-specific init routine */
     err = arch_timer_init(kargs);
@@ -243,61 +470,92 @@ status_t timer_init(kernel_args_t *kargs)
         return err;
 
     /* init events data */
+    spin_init(&tick_lock);
     spin_init(&events_lock);
-    spin_init(&timeouts_lock);
-    xlist_init(&events_queue);
-    xlist_init(&ready_timeouts_queue);
-    /* timeouts tree */
-    avl_tree_create(&timeouts_tree, compare_timeout_id, sizeof(event_t),
-                    offsetof(event_t, tree_node));
+    spin_init(&hr_events_lock);
+    xlist_init(&hr_events_queue);
+    for(level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        for(slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+            clist_init(&timer_wheel[level][slot]);
+        timer_wheel_counts[level] = 0;
+    }
+    timer_wheel_next = 0;
+    /* free events pool */
+    spin_init(&events_pool_lock);
+    clist_init(&events_pool);
+    put_free_events(events_pool_area, TIMER_EVENTS_POOL_SIZE);
+    /* timeouts hash table */
+    timeouts_hash = hash_table_init_static( timeouts_hash_area, sizeof(timeouts_hash_area),
+                                            offsetof(event_t, hash_node),
+                                            compare_timeout_id, hash_timeout_id );
 
     /* next valid timeout id */
     next_timeout_id = 1;
 
+    /* use processor cycles counter as high-resolution clock */
+    hr_boot_cycles = arch_timer_get_cycles();
+    hr_clock = (hr_boot_cycles != 0);
+
     return NO_ERROR;
 }
 
 /* continue timer module initialization */
 status_t timer_init_after_threading(kernel_args_t *kargs)
 {
-    /* create timeout calls handler thread */
-    thread_id id = thread_create_kernel_thread("timeout_calls_handler_thread",
-                        &timeout_calls_handler, NULL, false);
-    if(id == INVALID_THREADID)
-        return ERR_MT_GENERAL;
+    status_t err;
 
-    /* get pointer to thread structure */
-    timeout_calls_thread = thread_get_thread_struct(id);
-    if(timeout_calls_thread == NULL)
-        return ERR_MT_GENERAL;
+    /* create shared time page */
+    err = timer_create_time_page();
+    if(err != NO_ERROR)
+        return err;
 
     return NO_ERROR;
 }
 
-/* events queue handler */
-static bool timer_schedule_event(void)
+/* events processing for elapsed ticks */
+static bool timer_schedule_event(int ticks)
 {
-    int ticks;                     /* ticks to process */
     bool resched = false;          /* =true if reschedule required */
-    bool timeouts_thread = false;  /* =true if timeout calls handler ready to run */
+    list_elem_t *e;
     event_t *evt;
+    uint index;
+    int level;
 
     /* try to acquire access to events */
     if(!spin_trylock(&events_lock)) {
-        ++events_ticks_lost;
+        events_ticks_lost += ticks;
         return resched;
     }
 
-    ticks = events_ticks_lost + 1;
+    ticks += events_ticks_lost;
     events_ticks_lost = 0;
 
-    /* get queue head */
-    evt = peek_first_event();
+    /* nothing to expire */
+    if(timer_wheel_isempty()) {
+        timer_wheel_next += ticks;
+        ticks = 0;
+    }
 
-    while(evt) {
-        /* decrement delta ticks */
-        if( (ticks = (evt->delta -= ticks)) <= 0 ) {
+    while(ticks-- > 0) {
+        index = timer_wheel_next & TIMER_WHEEL_MASK;
+
+        /* level 0 round is over, refill it from upper levels */
+        if(!index) {
+            for(level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+                uint slot = (timer_wheel_next >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+                timer_wheel_cascade(level, slot);
+                if(slot)
+                    break;
+            }
+        }
+
+        timer_wheel_next++;
+
+        /* expire events of this tick */
+        while((e = clist_peek_head(&timer_wheel[0][index])) != NULL) {
             /** time for event! **/
+            evt = containerof(e, event_t, list_node);
+            timer_wheel_remove(evt);
 
             if(!evt->timeout) {
                 /* awake thread */
@@ -305,35 +563,14 @@ static bool timer_schedule_event(void)
                 sched_add_thread(evt->thread);
                 thread_unlock_thread(evt->thread);
 
-                destroy_first_event(); /* destroy event data */
+                free_event(evt); /* return event to pool */
             } else {
-                /* move event to timeout calls queue */
-                extract_first_event();
-                enqueue_timeout_event(evt);
-
-                /* schedule timeouts handler for execution */
-                if(!timeouts_thread) {
-                    timeouts_thread = true;
-                    /* lock thread first */
-                    thread_lock_thread(timeout_calls_thread);
-                    /* add to scheduler if was suspended */
-                    if(timeout_calls_thread->state == THREAD_STATE_SUSPENDED)
-                        sched_add_thread(timeout_calls_thread);
-                    /* cancel suspended state on next reschedule */
-                    if(timeout_calls_thread->next_state == THREAD_STATE_SUSPENDED)
-                        timeout_calls_thread->next_state = THREAD_STATE_READY;
-                    /* unlock thread */
-                    thread_unlock_thread(timeout_calls_thread);
-                }
+                /* call routine by worker of cpu it was scheduled on */
+                work_queue_on(&evt->work, evt->cpu);
             }
 
-            /* update ticks */
-            ticks = -ticks;
             resched = true;
-        } else
-            break;
-        /* point to next event */
-        evt = peek_first_event();
+        }
     }
 
     /* release access to events */
@@ -342,20 +579,292 @@ static bool timer_schedule_event(void)
     return resched;
 }
 
-/* timer tick event handler */
-flags_t timer_tick(void)
+/* process events and call scheduler for elapsed ticks */
+static flags_t timer_process_ticks(uint ticks)
 {
     flags_t ret = INT_FLAGS_NOFLAGS;
 
-    /* count tick */
-    ++timer_ticks;
-
     /* process pending events */
-    if(timer_schedule_event())
+    if(timer_schedule_event(ticks))
         ret |= INT_FLAGS_RESCHED;
 
     /* call scheduler */
-    if(scheduler_timer())
+    if(scheduler_timer(ticks))
+        ret |= INT_FLAGS_RESCHED;
+
+    return ret;
+}
+
+#if SYSCFG_DYNAMIC_TICK
+static void timer_hr_program(bigtime_t deadline);
+#endif
+
+/* expire high-resolution events and program system timer for
+ * the next one. returns true if reschedule is needed. called
+ * with interrupts disabled.
+ */
+static bool timer_hr_process(void)
+{
+    bool resched = false;
+    bigtime_t now, next = 0;
+    list_elem_t *e;
+    event_t *evt;
+
+    spin_lock(&hr_events_lock);
+
+    now = timer_get_time_nsec();
+    while((e = xlist_peek_first(&hr_events_queue)) != NULL) {
+        evt = containerof(e, event_t, list_node);
+        if(evt->deadline > now) {
+            next = evt->deadline;
+            break;
+        }
+
+        /* awake thread */
+        xlist_extract_first(&hr_events_queue);
+        thread_lock_thread(evt->thread);
+        sched_add_thread(evt->thread);
+        thread_unlock_thread(evt->thread);
+
+        free_event(evt); /* return event to pool */
+        resched = true;
+    }
+
+    spin_unlock(&hr_events_lock);
+
+#if SYSCFG_DYNAMIC_TICK
+    if(next)
+        timer_hr_program(next);
+#endif
+
+    return resched;
+}
+
+#if SYSCFG_DYNAMIC_TICK
+
+/* returns ticks count until next event may expire, but not more
+ * than given maximum. events lock must be held by caller.
+ */
+static uint timer_wheel_next_event(uint max)
+{
+    uint i, ticks;
+    int level;
+
+    /* upper levels events expire not earlier than next cascade */
+    for(level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+        if(timer_wheel_counts[level]) {
+            ticks = ((TIMER_WHEEL_SLOTS - (timer_wheel_next & TIMER_WHEEL_MASK)) & TIMER_WHEEL_MASK) + 1;
+            if(ticks < max)
+                max = ticks;
+            break;
+        }
+    }
+
+    /* search level 0 for nearest event */
+    if(timer_wheel_counts[0]) {
+        for(i = 0; i < max && i < TIMER_WHEEL_SLOTS; i++) {
+            if(!clist_isempty(&timer_wheel[0][(timer_wheel_next + i) & TIMER_WHEEL_MASK]))
+                return i + 1;
+        }
+    }
+
+    return max;
+}
+
+/* switch system timer into one-shot mode until given time.
+ * tick lock must be held by caller.
+ */
+static void timer_oneshot_until(bigtime_t deadline, bigtime_t now)
+{
+    bigtime_t nsec = deadline - now;
+
+    platform_timer_oneshot_nsec(nsec);
+    tick_wakeup = timer_ticks + ((nsec > 0) ? nsec / TIMER_NSEC_PER_TICK : 0) + 1;
+    tick_wakeup_nsec = deadline;
+    tick_stopped = true;
+}
+
+/* program system timer to expire at given time if it comes
+ * before next expected timer interrupt. called with interrupts
+ * disabled.
+ */
+static void timer_hr_program(bigtime_t deadline)
+{
+    bigtime_t now;
+
+    /* events expire on timer ticks without high-resolution clock */
+    if(!hr_clock)
+        return;
+
+    now = timer_get_time_nsec();
+
+    spin_lock(&tick_lock);
+    if(tick_stopped ? (deadline < tick_wakeup_nsec) : (deadline - now < TIMER_NSEC_PER_TICK))
+        timer_oneshot_until(deadline, now);
+    spin_unlock(&tick_lock);
+}
+
+/* restart periodic ticks. returns ticks elapsed while stopped.
+ * tick lock must be held by caller.
+ */
+static uint timer_restart_tick(bool in_tick)
+{
+    bool expired;
+    uint ticks;
+
+    ticks = platform_timer_periodic(&expired);
+    tick_stopped = false;
+    timer_ticks += ticks;
+
+    /* one-shot interrupt is pending, it is counted here */
+    if(expired && !in_tick)
+        tick_swallow = true;
+
+    return ticks;
+}
+
+/* called by idle thread with interrupts disabled */
+void timer_idle_enter(void)
+{
+    bigtime_t now, hr_deadline;
+    uint ticks;
+
+    /* other cpus have local timers */
+    if(get_current_processor() != BOOTSTRAP_CPU) {
+        smp_set_local_timer(false);
+        return;
+    }
+
+    if(tick_stopped)
+        return;
+
+    /* sleep until next event, but not longer than timer allows */
+    ticks = platform_timer_oneshot_max();
+    spin_lock(&events_lock);
+    if(events_ticks_lost)
+        ticks = 0;
+    else
+        ticks = timer_wheel_next_event(ticks);
+    spin_unlock(&events_lock);
+
+    now = timer_get_time_nsec();
+
+    /* high-resolution event comes earlier, sleep exactly until it */
+    hr_deadline = timer_hr_next_deadline();
+    if(hr_clock && hr_deadline && hr_deadline - now < ticks * TIMER_NSEC_PER_TICK) {
+        spin_lock(&tick_lock);
+        timer_oneshot_until(hr_deadline, now);
+        spin_unlock(&tick_lock);
+        return;
+    }
+
+    /* stopping ticks for short time is worthless */
+    if(ticks < TIMER_IDLE_MIN_TICKS)
+        return;
+
+    spin_lock(&tick_lock);
+    platform_timer_oneshot(ticks);
+    tick_wakeup = timer_ticks + ticks;
+    tick_wakeup_nsec = now + ticks * TIMER_NSEC_PER_TICK;
+    tick_stopped = true;
+    spin_unlock(&tick_lock);
+}
+
+/* called with interrupts disabled when cpu leaves idle state */
+bool timer_idle_exit(void)
+{
+    bool resched = false;
+    uint ticks;
+
+    /* other cpus have local timers */
+    if(get_current_processor() != BOOTSTRAP_CPU) {
+        smp_set_local_timer(true);
+        return false;
+    }
+
+    if(!tick_stopped)
+        return false;
+
+    spin_lock(&tick_lock);
+    ticks = timer_restart_tick(false);
+    timer_update_time_page();
+    spin_unlock(&tick_lock);
+
+    /* process ticks elapsed while idle */
+    if(ticks)
+        resched = (timer_process_ticks(ticks) & INT_FLAGS_RESCHED) != 0;
+
+    /* expire high-resolution events, one-shot was canceled */
+    if(timer_hr_process())
+        resched = true;
+
+    return resched;
+}
+
+/* wake up idle bootstrap cpu if new event comes before
+ * the time it is going to wake up.
+ */
+static void timer_check_wakeup(uint ticks)
+{
+    bool wakeup;
+
+    if(!tick_stopped || get_current_processor() == BOOTSTRAP_CPU)
+        return;
+
+    spin_lock(&tick_lock);
+    wakeup = tick_stopped && (timer_ticks + ticks < tick_wakeup);
+    spin_unlock(&tick_lock);
+
+    /* idle cpu restarts ticks while rescheduling */
+    if(wakeup)
+        smp_send_reschedule(BOOTSTRAP_CPU);
+}
+
+#endif
+
+/* timer tick event handler */
+flags_t timer_tick(void)
+{
+    flags_t ret;
+#if SYSCFG_DYNAMIC_TICK
+    uint ticks = 1;
+
+    spin_lock(&tick_lock);
+
+    if(tick_stopped) {
+        bool expired;
+
+        /* periodic tick arrived while switching timer into one-shot mode,
+         * so count it and keep timer in one-shot mode.
+         */
+        platform_timer_oneshot_elapsed(&expired);
+        if(expired)
+            ticks = timer_restart_tick(true);
+        else
+            timer_ticks += ticks;
+    } else if(tick_swallow) {
+        /* this tick was already counted */
+        tick_swallow = false;
+        ticks = 0;
+    } else
+        timer_ticks += ticks;
+
+    timer_update_time_page();
+    spin_unlock(&tick_lock);
+
+    ret = (ticks) ? timer_process_ticks(ticks) : INT_FLAGS_NOFLAGS;
+#else
+    /* count tick */
+    spin_lock(&tick_lock);
+    ++timer_ticks;
+    timer_update_time_page();
+    spin_unlock(&tick_lock);
+
+    ret = timer_process_ticks(1);
+#endif
+
+    /* expire high-resolution events */
+    if(timer_hr_process())
         ret |= INT_FLAGS_RESCHED;
 
     return ret;
@@ -367,11 +876,23 @@ bigtime_t timer_get_ticks(void)
     unsigned long irqs_state;
     bigtime_t ticks_cpy;
 
+#if SYSCFG_DYNAMIC_TICK
+    bool expired;
+
+    /* system timer may be stopped, so add ticks elapsed since that */
+    irqs_state = spin_lock_irqsave(&tick_lock);
+    ticks_cpy = timer_ticks;
+    if(tick_stopped)
+        ticks_cpy += platform_timer_oneshot_elapsed(&expired);
+    spin_unlock_irqrstor(&tick_lock, irqs_state);
+#else
     /* disable interrupts and copy current ticks count to local var */
     local_irqs_save_and_disable(irqs_state);
     ticks_cpy = timer_ticks;
     /* restore interrupts and return ticks count to caller */
     local_irqs_restore(irqs_state);
+#endif
+
     return ticks_cpy;
 }
 
@@ -382,18 +903,36 @@ bigtime_t timer_get_time(void)
     return TIMER_TICKS_TO_MSEC(ticks);
 }
 
+/* return nanoseconds count */
+bigtime_t timer_get_time_nsec(void)
+{
+    /* cycles counters of processors are considered synchronized */
+    if(hr_clock)
+        return arch_timer_cycles_to_nsec(arch_timer_get_cycles() - hr_boot_cycles);
+
+    return TIMER_TICKS_TO_TIME(timer_get_ticks(), TIMER_NSEC_PER_SEC);
+}
+
+/* map shared time page into user space */
+status_t timer_map_time_page(aspace_id aid)
+{
+    return vm_map_object_exactly(aid, time_page_id, VM_PROT_USER_READ, USER_TIME_PAGE_BASE);
+}
+
 /* lulls thread for a given count of timer ticks */
 status_t timer_lull_thread(thread_t *thread, uint ticks)
 {
     event_t *new_evt;
     unsigned long irqs_state;
+    bigtime_t slack;
+    uint scaled;
 
     /*
      * Debug checks.
      * Thread must be locked before call and be in
      * READY or RUNNING state.
     */
-    ASSERT_MSG(thread->lock != 0,
+    ASSERT_MSG(spin_locked(&thread->lock),
         "timer_lull_thread(): thread was not locked!\n");
     ASSERT_MSG(thread->state == THREAD_STATE_READY ||
         thread->state == THREAD_STATE_RUNNING,
@@ -409,8 +948,8 @@ status_t timer_lull_thread(thread_t *thread, uint ticks)
      * Anyway, be careful!
      */
 
-    /* allocate memory for new event */
-    new_evt = (event_t*)kmalloc(sizeof(event_t));
+    /* allocate new event */
+    new_evt = alloc_event();
     if(!new_evt)
         panic("timer_lull_thread(): out of kernel heap!\n");
 
@@ -427,12 +966,86 @@ status_t timer_lull_thread(thread_t *thread, uint ticks)
     /* acquire events lock */
     irqs_state = spin_lock_irqsave(&events_lock);
 
-    /* add event to queue */
-    add_new_event_nolock(new_evt, ticks);
+    /* default slack is below tick, so slack grows with sleep length.
+     * zero slack still means exact sleep.
+     */
+    slack = thread->timer_slack / TIMER_NSEC_PER_TICK;
+    if(thread->timer_slack) {
+        scaled = ticks >> SYSCFG_TIMER_SLACK_TICKS_SHIFT;
+        if(scaled > TIMER_MSEC_TO_TICKS(SYSCFG_TIMER_SLACK_MAX_MSEC))
+            scaled = TIMER_MSEC_TO_TICKS(SYSCFG_TIMER_SLACK_MAX_MSEC);
+        if(slack < scaled)
+            slack = scaled;
+    }
+
+    /* add event to queue, expiration may be coalesced within slack */
+    ticks = add_new_event_nolock(new_evt, ticks,
+                (slack < TIMER_WHEEL_MAX_TICKS) ? (uint)slack : TIMER_WHEEL_MAX_TICKS);
 
     /* release events lock */
     spin_unlock_irqrstor(&events_lock, irqs_state);
 
+#if SYSCFG_DYNAMIC_TICK
+    timer_check_wakeup(ticks);
+#endif
+
+    return NO_ERROR;
+}
+
+/* lulls thread until given count of nanoseconds elapsed */
+status_t timer_lull_thread_nsec(thread_t *thread, bigtime_t nsec)
+{
+    event_t *new_evt;
+    bigtime_t deadline;
+    unsigned long irqs_state;
+    bool first;
+
+    /* no high-resolution clock, round up to timer ticks */
+    if(!hr_clock)
+        return timer_lull_thread(thread, (uint)((nsec + TIMER_NSEC_PER_TICK - 1) / TIMER_NSEC_PER_TICK));
+
+    /* Debug checks. Same as for timer_lull_thread(). */
+    ASSERT_MSG(spin_locked(&thread->lock),
+        "timer_lull_thread_nsec(): thread was not locked!\n");
+    ASSERT_MSG(thread->state == THREAD_STATE_READY ||
+        thread->state == THREAD_STATE_RUNNING,
+        "timer_lull_thread_nsec(): thread in wrong state\n");
+    ASSERT_MSG(thread->next_state == THREAD_STATE_READY ||
+        thread->next_state == THREAD_STATE_RUNNING,
+        "timer_lull_thread_nsec(): thread has wrong next state\n");
+
+    /* allocate new event */
+    new_evt = alloc_event();
+    if(!new_evt)
+        panic("timer_lull_thread_nsec(): out of kernel heap!\n");
+
+    /* set thread states */
+    thread->next_state = THREAD_STATE_SLEEPING;
+    /* if was taken directly from runqueue - update current state */
+    if(IS_THREAD_STATE_READY(thread))
+        thread->state = THREAD_STATE_SLEEPING;
+
+    /* set event data */
+    deadline = timer_get_time_nsec() + nsec;
+    new_evt->thread = thread;
+    new_evt->deadline = deadline;
+    new_evt->timeout = false; /* not a timeout call */
+    new_evt->level = -1;      /* not in timing wheel */
+
+    /* add event to queue */
+    irqs_state = spin_lock_irqsave(&hr_events_lock);
+    first = add_new_hr_event_nolock(new_evt, thread->timer_slack);
+    deadline = new_evt->deadline;
+    spin_unlock(&hr_events_lock);
+
+    /* event may be freed already, so deadline copy is used */
+#if SYSCFG_DYNAMIC_TICK
+    if(first)
+        timer_hr_program(deadline);
+#endif
+
+    local_irqs_restore(irqs_state);
+
     return NO_ERROR;
 }
 
@@ -442,8 +1055,8 @@ timeout_id timer_timeout_sched(timeout_routine_t routine, void *data, uint ticks
     event_t *new_evt;
     unsigned long irqs_state;
 
-    /* allocate memory for new event */
-    new_evt = (event_t*)kmalloc(sizeof(event_t));
+    /* allocate new event */
+    new_evt = alloc_event();
     if(!new_evt)
          panic("timer_timeout_sched(): out of kernel heap!\n");
 
@@ -453,69 +1066,96 @@ timeout_id timer_timeout_sched(timeout_routine_t routine, void *data, uint ticks
      new_evt->canceled = false;
      new_evt->timeout_routine = routine;
      new_evt->data = data;
+     new_evt->cpu = get_current_processor();
+     work_init(&new_evt->work, &timeout_call_work, WORK_PRIORITY_NORMAL);
      spin_init(&new_evt->run_lock);
 
      /* acquire events lock */
      irqs_state = spin_lock_irqsave(&events_lock);
-     spin_lock(&timeouts_lock);
 
-     /* add event to queue */
-     add_new_event_nolock(new_evt, ticks);
-     /* ...and to avl-tree */
-     if(!avl_tree_add(&timeouts_tree, new_evt))
-         panic("timer_timeout_sched(): failed to add event into tree!\n");;
+     /* add event to timing wheel */
+     add_new_event_nolock(new_evt, ticks, 0);
+     /* ...and to hash table */
+     hash_table_insert(timeouts_hash, new_evt);
 
      /* release events lock */
-     spin_unlock(&timeouts_lock);
      spin_unlock_irqrstor(&events_lock, irqs_state);
 
+#if SYSCFG_DYNAMIC_TICK
+     timer_check_wakeup(ticks);
+#endif
+
      return new_evt->id; /* return event id */
 }
 
 /* cancel timeout call */
 void timer_timeout_cancel(timeout_id tid)
 {
-    event_t *look_for, *evt;
+    event_t *evt;
     unsigned long irqs_state;
 
-    look_for = containerof(&tid, event_t, id);
-
     /* acquire events lock */
-    irqs_state = spin_lock_irqsave(&timeouts_lock);
+    irqs_state = spin_lock_irqsave(&events_lock);
 
-    /* find event in tree and set canceled flag */
-    evt = avl_tree_find(&timeouts_tree, look_for, NULL);
-    if(evt)
-        evt->canceled = true;
+    /* find event in hash table */
+    evt = hash_table_lookup(timeouts_hash, &tid);
+    if(evt) {
+        if(evt->level >= 0) {
+            /* not expired yet, remove it */
+            timer_wheel_remove(evt);
+            hash_table_remove(timeouts_hash, evt);
+        } else {
+            /* already queued to handler, set canceled flag */
+            evt->canceled = true;
+            evt = NULL;
+        }
+    }
 
     /* release events lock */
-    spin_unlock_irqrstor(&timeouts_lock, irqs_state);
+    spin_unlock_irqrstor(&events_lock, irqs_state);
+
+    if(evt)
+        free_event(evt);
 }
 
 /* cancel timeout call (synchronized) */
 void timer_timeout_cancel_sync(timeout_id tid)
 {
-    event_t *look_for, *evt;
+    event_t *evt;
     unsigned long irqs_state;
     int retry;
 
-    look_for = containerof(&tid, event_t, id);
-
     do {
         retry = 0; /* clear retry state */
 
         /* acquire events lock */
-        irqs_state = spin_lock_irqsave(&timeouts_lock);
+        irqs_state = spin_lock_irqsave(&events_lock);
 
-        /* find event in tree and set canceled flag */
-        evt = avl_tree_find(&timeouts_tree, look_for, NULL);
+        /* find event in hash table */
+        evt = hash_table_lookup(timeouts_hash, &tid);
         if(evt) {
-            retry = !spin_trylock(&evt->run_lock);
-            if(!retry) evt->canceled = true;
+            if(evt->level >= 0) {
+                /* not expired yet, remove it */
+                timer_wheel_remove(evt);
+                hash_table_remove(timeouts_hash, evt);
+            } else {
+                /* already queued to handler, set canceled
+                 * flag if routine is not running.
+                 */
+                retry = !spin_trylock(&evt->run_lock);
+                if(!retry) {
+                    evt->canceled = true;
+                    spin_unlock(&evt->run_lock);
+                }
+                evt = NULL;
+            }
         }
 
         /* release events lock */
-        spin_unlock_irqrstor(&timeouts_lock, irqs_state);
+        spin_unlock_irqrstor(&events_lock, irqs_state);
+
+        if(evt)
+            free_event(evt);
 
         /* Oops... Retry required. Wait a little. */
         if(retry)
@@ -5,6 +5,7 @@
 */
 #include <string.h>
 #include <phlox/heap.h>
+#include <phlox/processor.h>
 #include <phlox/hash_table.h>
 
 
@@ -159,6 +160,9 @@ int hash_table_insert(hash_table_t table, void *elem)
     /* prepend chain */
     PUT_IN_NEXT(ht, elem, ht->table[hash]);
 
+    /* link must be visible before element is published to lockless readers */
+    smp_wmb();
+
     /* update bucket */
     if(ht->table[hash] == NULL)
         ht->num_buckets++;
@@ -187,6 +191,9 @@ int hash_table_insert_safe(hash_table_t table, void *elem)
     /* prepend chain */
     PUT_IN_NEXT(ht, elem, ht->table[hash]);
 
+    /* link must be visible before element is published to lockless readers */
+    smp_wmb();
+
     /* update hash table bucket */
     if(ht->table[hash] == NULL)
         ht->num_buckets++;
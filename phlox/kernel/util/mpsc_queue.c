@@ -0,0 +1,61 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/ktypes.h>
+#include <phlox/atomic.h>
+#include <phlox/mpsc_queue.h>
+
+
+void mpsc_queue_init(mpsc_queue_t *q)
+{
+    q->in = NULL;
+    q->out = NULL;
+}
+
+bool mpsc_queue_push(mpsc_queue_t *q, mpsc_queue_elem_t *e)
+{
+    mpsc_queue_elem_t *first;
+
+    /* link element before publishing it.
+     * Note: atomic operation is a full memory barrier.
+     */
+    do {
+        first = q->in;
+        e->next = first;
+    } while(!atomic_test_and_set((atomic_t*)&q->in, (int)(addr_t)e, (int)(addr_t)first));
+
+    return first == NULL;
+}
+
+mpsc_queue_elem_t *mpsc_queue_pop(mpsc_queue_t *q)
+{
+    mpsc_queue_elem_t *e, *next;
+
+    /* consumer side is empty, take all pushed elements and
+     * reverse them into order of pushing.
+     */
+    if(q->out == NULL && q->in != NULL) {
+        e = (mpsc_queue_elem_t *)(addr_t)atomic_set_ret((atomic_t*)&q->in, 0);
+        while(e != NULL) {
+            next = e->next;
+            e->next = q->out;
+            q->out = e;
+            e = next;
+        }
+    }
+
+    /* extract first element */
+    e = q->out;
+    if(e != NULL) {
+        q->out = e->next;
+        e->next = NULL;
+    }
+
+    return e;
+}
+
+bool mpsc_queue_isempty(mpsc_queue_t *q)
+{
+    return q->out == NULL && q->in == NULL;
+}
@@ -3,25 +3,210 @@
 * Distributed under the terms of the PhloxOS License.
 */
 #include <phlox/errors.h>
+#include <phlox/atomic.h>
 #include <phlox/sem.h>
+#include <phlox/processor.h>
 #include <phlox/thread.h>
+#include <phlox/scheduler.h>
 #include <phlox/mutex.h>
 
 
+/* Max. count of spins while waiting for running holder */
+#define MUTEX_SPIN_LIMIT  10000
+
+/* Max. count of threads sleeping on mutex semaphore */
+#define MUTEX_SEM_MAX_COUNT  0x7FFFFFFF
+
+/* Mutex holder thread id */
+#define mutex_get_holder(mtx)  ((thread_id)atomic_get(&(mtx)->holder))
+
+
+/*** Priority inheritance ***/
+
+/* init priority inheritance data */
+static void mutex_pi_init(mutex_pi_t *pi)
+{
+    spin_init(&pi->lock);
+    pi->waiters = 0;
+    pi->prio = 0;
+}
+
+/* current thread is going to block on mutex, boost mutex holder */
+static void mutex_pi_wait(mutex_pi_t *pi, thread_id holder)
+{
+    thread_t *curr = thread_get_current_thread();
+    unsigned long irqs_state;
+    thread_t *th;
+    int prio;
+
+    irqs_state = spin_lock_irqsave(&pi->lock);
+    pi->waiters++;
+    if(curr->d_prio > pi->prio)
+        pi->prio = curr->d_prio;
+    prio = pi->prio;
+    spin_unlock(&pi->lock);
+
+    /* Note: holder may release mutex at this point, boost is
+     * applied only if it still holds some priority inheriting locks.
+     */
+    th = (holder != INVALID_THREADID) ? thread_get_thread_struct(holder) : NULL;
+    if(th != NULL) {
+        thread_lock_thread(th);
+        /* structure may be reused by another thread since lookup */
+        if(th->id == holder && th->pi_locks)
+            sched_inherit_priority(th, prio);
+        thread_unlock_thread(th);
+    }
+
+    local_irqs_restore(irqs_state);
+}
+
+/* current thread stopped waiting on mutex.
+ * returns priority of other blocked threads.
+ */
+static int mutex_pi_unwait(mutex_pi_t *pi)
+{
+    unsigned long irqs_state;
+    int prio;
+
+    irqs_state = spin_lock_irqsave(&pi->lock);
+    if(!--pi->waiters)
+        pi->prio = 0;
+    prio = pi->prio;
+    spin_unlock_irqrstor(&pi->lock, irqs_state);
+
+    return prio;
+}
+
+/* current thread acquired mutex, it inherits priority of blocked threads */
+static void mutex_pi_acquired(thread_t *curr, int prio)
+{
+    unsigned long irqs_state;
+
+    /* Note: counter is changed by owning thread only */
+    curr->pi_locks++;
+    if(!prio)
+        return;
+
+    irqs_state = spin_lock_irqsave(&curr->lock);
+    sched_inherit_priority(curr, prio);
+    spin_unlock_irqrstor(&curr->lock, irqs_state);
+}
+
+/* current thread released mutex, inherited priority is dropped with last one */
+static void mutex_pi_released(thread_t *curr)
+{
+    unsigned long irqs_state;
+
+    if(--curr->pi_locks || !curr->pi_prio)
+        return;
+
+    irqs_state = spin_lock_irqsave(&curr->lock);
+    sched_restore_priority(curr);
+    spin_unlock_irqrstor(&curr->lock, irqs_state);
+}
+
+/* returns true if waiter should spin instead of sleeping */
+static bool mutex_holder_running(mutex_t *mtx, thread_id holder)
+{
+#if SYSCFG_SMP_SUPPORT
+    thread_t *th = mtx->holder_thread;
+
+    /* Note: thread structures are never freed, so holder structure
+     * may be safely read even if holder is gone already.
+     */
+    return th != NULL && th->id == holder &&
+           th->state == THREAD_STATE_RUNNING &&
+           th->cpu != NULL && th->cpu->cpu_num != get_current_processor();
+#else
+    return false;
+#endif
+}
+
+/* mutex is free, try to acquire it */
+static inline bool mutex_try_acquire(mutex_t *mtx, thread_t *curr)
+{
+    if(!atomic_test_and_set(&mtx->holder, curr->id, INVALID_THREADID))
+        return false;
+
+    mtx->holder_thread = curr;
+    return true;
+}
+
+/* contended mutex acquire: spin while holder is running, then sleep */
+static status_t mutex_lock_slow(mutex_t *mtx, thread_t *curr)
+{
+    thread_id holder = mutex_get_holder(mtx);
+    status_t err = NO_ERROR;
+    uint spins;
+    int prio;
+
+    /* announce waiter and boost holder */
+    mutex_pi_wait(&mtx->pi, holder);
+
+    while(!mutex_try_acquire(mtx, curr)) {
+        holder = mutex_get_holder(mtx);
+        if(holder == INVALID_THREADID)
+            continue;
+
+        /* holder is going to release mutex soon, if it is running */
+        for(spins = 0; spins < MUTEX_SPIN_LIMIT && mutex_get_holder(mtx) == holder &&
+                       mutex_holder_running(mtx, holder); spins++)
+            cpu_relax();
+
+        if(mutex_get_holder(mtx) != holder)
+            continue;
+
+        /* sleep until mutex is released */
+        err = sem_down(mtx->sem, 1);
+        if(err != NO_ERROR)
+            break;
+    }
+
+    /* stop waiting and inherit priority of other waiters */
+    prio = mutex_pi_unwait(&mtx->pi);
+    if(err == NO_ERROR)
+        mutex_pi_acquired(curr, prio);
+
+    return err;
+}
+
+/* release mutex held by current thread */
+static void mutex_release(mutex_t *mtx, thread_t *curr)
+{
+    mtx->holder_thread = NULL;
+
+    /* Note: exchange is a full barrier, so waiters counter
+     *       is read after mutex became free.
+     */
+    atomic_set_ret(&mtx->holder, INVALID_THREADID);
+    if(mtx->pi.waiters)
+        sem_up(mtx->sem, 1);
+
+    /* waiter is woken up, drop inherited priority */
+    mutex_pi_released(curr);
+}
+
+
+/*** Mutex ***/
 
 /* init mutex data */
 void mutex_init(mutex_t *mtx)
 {
     mtx->sem = INVALID_SEMID;
     mtx->holder = INVALID_THREADID;
+    mtx->holder_thread = NULL;
+    mutex_pi_init(&mtx->pi);
 }
 
 /* create mutex */
 status_t mutex_create(mutex_t *mtx, const char *name)
 {
-    /* init holder field and create semaphore */
+    /* init holder fields and create semaphore */
     mtx->holder = INVALID_THREADID;
-    mtx->sem = sem_create(name, 1, 1);
+    mtx->holder_thread = NULL;
+    mutex_pi_init(&mtx->pi);
+    mtx->sem = sem_create(name, MUTEX_SEM_MAX_COUNT, 0);
 
     /* return status */
     if(mtx->sem == INVALID_SEMID)
@@ -37,6 +222,7 @@ status_t mutex_destroy(mutex_t *mtx)
 
     mtx->sem = INVALID_SEMID;
     mtx->holder = INVALID_THREADID;
+    mtx->holder_thread = NULL;
 
     return (retc == NO_ERROR) ? NO_ERROR : ERR_MTX_SEM_FAILURE;
 }
@@ -44,54 +230,48 @@ status_t mutex_destroy(mutex_t *mtx)
 /* acquire mutex */
 status_t mutex_lock(mutex_t *mtx)
 {
-    status_t retc = ERR_MTX_INVALID_MUTEX;
+    thread_t *curr = thread_get_current_thread();
 
-    if(mtx->sem != INVALID_SEMID)
-        retc = (sem_down(mtx->sem, 1) == NO_ERROR) ? NO_ERROR : ERR_MTX_SEM_FAILURE;
+    if(mtx->sem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
 
-    if(retc == NO_ERROR)
-        mtx->holder = thread_get_current_thread_id();
+    /* fast path: mutex is free */
+    if(mutex_try_acquire(mtx, curr)) {
+        mutex_pi_acquired(curr, mtx->pi.prio);
+        return NO_ERROR;
+    }
 
-    return retc;
+    return (mutex_lock_slow(mtx, curr) == NO_ERROR) ? NO_ERROR : ERR_MTX_SEM_FAILURE;
 }
 
 /* try acquire mutex */
 status_t mutex_trylock(mutex_t *mtx)
 {
-    status_t retc = ERR_MTX_INVALID_MUTEX;
-
-    if(mtx->sem != INVALID_SEMID) {
-        switch( sem_down_ex(mtx->sem, 1, 0, SEMF_TRY) ) {
-            case NO_ERROR:
-              retc = NO_ERROR;
-              break;
-            case ERR_SEM_TRY_FAILED:
-              retc = ERR_MTX_TRY_FAILED;
-              break;
-            default:
-              retc = ERR_MTX_SEM_FAILURE;
-              break;
-        }
-    }
+    thread_t *curr = thread_get_current_thread();
+
+    if(mtx->sem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
+
+    if(!mutex_try_acquire(mtx, curr))
+        return ERR_MTX_TRY_FAILED;
 
-    if(retc == NO_ERROR)
-        mtx->holder = thread_get_current_thread_id();
+    mutex_pi_acquired(curr, mtx->pi.prio);
 
-    return retc;
+    return NO_ERROR;
 }
 
 /* release mutex */
 status_t mutex_unlock(mutex_t *mtx)
 {
+    thread_t *curr = thread_get_current_thread();
+
     if(mtx->sem == INVALID_SEMID)
         return ERR_MTX_INVALID_MUTEX;
 
-    if(mtx->holder != thread_get_current_thread_id())
+    if(mutex_get_holder(mtx) != curr->id)
         return ERR_MTX_NOT_AN_OWNER;
 
-    mtx->holder = INVALID_THREADID;
-
-    sem_up(mtx->sem, 1);
+    mutex_release(mtx, curr);
 
     return NO_ERROR;
 }
@@ -99,55 +279,34 @@ status_t mutex_unlock(mutex_t *mtx)
 /* init recursive mutex data */
 void rmutex_init(rmutex_t *mtx)
 {
-    mtx->sem = INVALID_SEMID;
-    mtx->holder = INVALID_THREADID;
+    mutex_init(&mtx->mtx);
     mtx->recurs = 0;
 }
 
 /* create recursive mutex */
 status_t rmutex_create(rmutex_t *mtx, const char *name)
 {
-    /* init holder and recursion fields and create semaphore */
-    mtx->holder = INVALID_THREADID;
     mtx->recurs = 0;
-    mtx->sem = sem_create(name, 1, 1);
-
-    /* return status */
-    if(mtx->sem == INVALID_SEMID)
-        return ERR_MTX_SEM_FAILURE;
-    else
-        return NO_ERROR;
+    return mutex_create(&mtx->mtx, name);
 }
 
 /* destroy recursive mutex */
 status_t rmutex_destroy(rmutex_t *mtx)
 {
-    status_t retc = sem_delete(mtx->sem);
-
-    mtx->sem = INVALID_SEMID;
-    mtx->holder = INVALID_THREADID;
     mtx->recurs = 0;
-
-    return (retc == NO_ERROR) ? NO_ERROR : ERR_MTX_SEM_FAILURE;
+    return mutex_destroy(&mtx->mtx);
 }
 
 /* acquire recursive mutex */
 status_t rmutex_lock(rmutex_t *mtx)
 {
-    status_t r = sem_down_ex(mtx->sem, 1, 0, SEMF_TRY);
-    thread_id tid = thread_get_current_thread_id();
-
-    /* check for errors */
-    if(r != NO_ERROR && r != ERR_SEM_TRY_FAILED)
-        return ERR_MTX_SEM_FAILURE;
+    status_t err;
 
-    if(r == NO_ERROR) {  /* semaphore successfully acquired */
-        mtx->holder = tid;
-        mtx->recurs = 0;
-    } else if(r == ERR_SEM_TRY_FAILED && mtx->holder != tid) { /* not an owner */
-        if( sem_down(mtx->sem, 1) ) /* wait on semaphore */
-            return ERR_MTX_SEM_FAILURE;
-        mtx->holder = tid;
+    /* not an owner, acquire mutex */
+    if(mutex_get_holder(&mtx->mtx) != thread_get_current_thread_id()) {
+        err = mutex_lock(&mtx->mtx);
+        if(err != NO_ERROR)
+            return err;
         mtx->recurs = 0;
     }
 
@@ -160,18 +319,14 @@ status_t rmutex_lock(rmutex_t *mtx)
 /* try acquire recursive mutex */
 status_t rmutex_trylock(rmutex_t *mtx)
 {
-    status_t r = sem_down_ex(mtx->sem, 1, 0, SEMF_TRY);
-    thread_id tid = thread_get_current_thread_id();
-
-    /* check for errors */
-    if(r != NO_ERROR && r != ERR_SEM_TRY_FAILED)
-        return ERR_MTX_SEM_FAILURE;
+    status_t err;
 
-    if(r == NO_ERROR) {  /* semaphore successfully acquired */
-        mtx->holder = tid;
+    /* not an owner, try acquire mutex */
+    if(mutex_get_holder(&mtx->mtx) != thread_get_current_thread_id()) {
+        err = mutex_trylock(&mtx->mtx);
+        if(err != NO_ERROR)
+            return err;
         mtx->recurs = 0;
-    } else if(r == ERR_SEM_TRY_FAILED && mtx->holder != tid) { /* not an owner */
-        return ERR_MTX_TRY_FAILED;
     }
 
     /* increment recursion level */
@@ -183,17 +338,181 @@ status_t rmutex_trylock(rmutex_t *mtx)
 /* release recursive mutex */
 status_t rmutex_unlock(rmutex_t *mtx)
 {
-    if(mtx->sem == INVALID_SEMID)
+    thread_t *curr = thread_get_current_thread();
+
+    if(mtx->mtx.sem == INVALID_SEMID)
         return ERR_MTX_INVALID_MUTEX;
 
-    if(mtx->holder != thread_get_current_thread_id())
+    if(mutex_get_holder(&mtx->mtx) != curr->id)
         return ERR_MTX_NOT_AN_OWNER;
 
     /* countdown recursion level */
-    if(!--mtx->recurs) {
-        mtx->holder = INVALID_THREADID;
-        sem_up(mtx->sem, 1);
+    if(!--mtx->recurs)
+        mutex_release(&mtx->mtx, curr);
+
+    return NO_ERROR;
+}
+
+
+/*** Reader-writer mutex ***/
+
+/* create reader-writer mutex */
+status_t rwmutex_create(rwmutex_t *mtx, const char *name)
+{
+    spin_init(&mtx->lock);
+    mtx->readers = 0;
+    mtx->writer = false;
+    mtx->wait_readers = 0;
+    mtx->wait_writers = 0;
+
+    mtx->wsem = sem_create(name, MUTEX_SEM_MAX_COUNT, 0);
+    if(mtx->wsem == INVALID_SEMID)
+        return ERR_MTX_SEM_FAILURE;
+
+    mtx->rsem = sem_create(NULL, MUTEX_SEM_MAX_COUNT, 0);
+    if(mtx->rsem == INVALID_SEMID) {
+        sem_delete(mtx->wsem);
+        mtx->wsem = INVALID_SEMID;
+        return ERR_MTX_SEM_FAILURE;
+    }
+
+    return NO_ERROR;
+}
+
+/* destroy reader-writer mutex */
+status_t rwmutex_destroy(rwmutex_t *mtx)
+{
+    status_t retc = sem_delete(mtx->wsem);
+
+    if(sem_delete(mtx->rsem) != NO_ERROR)
+        retc = ERR_MTX_SEM_FAILURE;
+
+    mtx->wsem = INVALID_SEMID;
+    mtx->rsem = INVALID_SEMID;
+
+    return (retc == NO_ERROR) ? NO_ERROR : ERR_MTX_SEM_FAILURE;
+}
+
+/* acquire reader-writer mutex for reading */
+status_t rwmutex_read_lock(rwmutex_t *mtx)
+{
+    unsigned long irqs_state;
+
+    if(mtx->rsem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
+
+    irqs_state = spin_lock_irqsave(&mtx->lock);
+
+    /* no writers, enter at once */
+    if(!mtx->writer && !mtx->wait_writers) {
+        mtx->readers++;
+        spin_unlock_irqrstor(&mtx->lock, irqs_state);
+        return NO_ERROR;
     }
 
+    mtx->wait_readers++;
+    spin_unlock_irqrstor(&mtx->lock, irqs_state);
+
+    /* sleep until last writer hands lock off to readers */
+    if(sem_down(mtx->rsem, 1) != NO_ERROR)
+        return ERR_MTX_SEM_FAILURE;
+
+    return NO_ERROR;
+}
+
+/* release reader-writer mutex acquired for reading */
+status_t rwmutex_read_unlock(rwmutex_t *mtx)
+{
+    unsigned long irqs_state;
+    bool wake_writer = false;
+
+    if(mtx->rsem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
+
+    irqs_state = spin_lock_irqsave(&mtx->lock);
+
+    if(mtx->writer || mtx->readers <= 0) {
+        spin_unlock_irqrstor(&mtx->lock, irqs_state);
+        return ERR_MTX_NOT_AN_OWNER;
+    }
+
+    /* last reader hands lock off to writer */
+    if(!--mtx->readers && mtx->wait_writers) {
+        mtx->wait_writers--;
+        mtx->writer = true;
+        wake_writer = true;
+    }
+
+    spin_unlock_irqrstor(&mtx->lock, irqs_state);
+
+    if(wake_writer)
+        sem_up(mtx->wsem, 1);
+
+    return NO_ERROR;
+}
+
+/* acquire reader-writer mutex for writing */
+status_t rwmutex_write_lock(rwmutex_t *mtx)
+{
+    unsigned long irqs_state;
+
+    if(mtx->wsem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
+
+    irqs_state = spin_lock_irqsave(&mtx->lock);
+
+    /* mutex is free, take it at once */
+    if(!mtx->writer && !mtx->readers) {
+        mtx->writer = true;
+        spin_unlock_irqrstor(&mtx->lock, irqs_state);
+        return NO_ERROR;
+    }
+
+    mtx->wait_writers++;
+    spin_unlock_irqrstor(&mtx->lock, irqs_state);
+
+    /* sleep until lock is handed off to us */
+    if(sem_down(mtx->wsem, 1) != NO_ERROR)
+        return ERR_MTX_SEM_FAILURE;
+
+    return NO_ERROR;
+}
+
+/* release reader-writer mutex acquired for writing */
+status_t rwmutex_write_unlock(rwmutex_t *mtx)
+{
+    unsigned long irqs_state;
+    uint wake_readers = 0;
+    bool wake_writer = false;
+
+    if(mtx->wsem == INVALID_SEMID)
+        return ERR_MTX_INVALID_MUTEX;
+
+    irqs_state = spin_lock_irqsave(&mtx->lock);
+
+    if(!mtx->writer) {
+        spin_unlock_irqrstor(&mtx->lock, irqs_state);
+        return ERR_MTX_NOT_AN_OWNER;
+    }
+
+    /* hand lock off to all sleeping readers, or to next writer */
+    if(mtx->wait_readers) {
+        wake_readers = mtx->wait_readers;
+        mtx->readers = mtx->wait_readers;
+        mtx->wait_readers = 0;
+        mtx->writer = false;
+    } else if(mtx->wait_writers) {
+        mtx->wait_writers--;
+        wake_writer = true;
+    } else
+        mtx->writer = false;
+
+    spin_unlock_irqrstor(&mtx->lock, irqs_state);
+
+    if(wake_readers)
+        sem_up(mtx->rsem, wake_readers);
+    else if(wake_writer)
+        sem_up(mtx->wsem, 1);
+
     return NO_ERROR;
 }
@@ -149,7 +149,7 @@ status_t vm_init(kernel_args_t *kargs)
         aspace_id kid = vm_get_kernel_aspace_id();
         object_id id;
         char name[SYS_MAX_OS_NAME_LEN];
-        int i;
+        uint i;
 
         /* create kernel_image memory object and its mapping */
         id = vm_create_physmem_object(VM_NAME_KERNEL_IMAGE, kargs->phys_kernel_addr.start,
@@ -168,7 +168,7 @@ status_t vm_init(kernel_args_t *kargs)
             panic("vm_init: failed to init counters for kernel_image object!\n");
 
         /* create kernel stacks memory objects and mappings */
-        for(i = 0; i < SYSCFG_MAX_CPUS; i++) {
+        for(i = 0; i < kargs->num_cpus; i++) {
             snprintf(name, SYS_MAX_OS_NAME_LEN, VM_NAME_KERNEL_CPU_STACK_FMT, i);
             id = vm_create_physmem_object(name, kargs->phys_cpu_kstack[i].start,
                                           kargs->phys_cpu_kstack[i].size, VM_OBJECT_PROTECT_ALL);
@@ -9,8 +9,11 @@
 #include <phlox/heap.h>
 #include <phlox/list.h>
 #include <phlox/avl_tree.h>
+#include <phlox/hash_table.h>
 #include <phlox/atomic.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
+#include <phlox/rcu.h>
 #include <phlox/thread.h>
 #include <phlox/arch/vm_translation_map.h>
 #include <phlox/vm_private.h>
@@ -21,17 +24,23 @@
 /* Redefinition for convenience */
 typedef xlist_t aspace_list_t;
 
+/* Buckets count of address spaces hash table */
+#define ASPACES_HASH_SIZE  64
+
 /* Next available address space id */
 static vuint next_aspace_id;
 
 /* List of address spaces */
 static aspace_list_t aspaces_list;
 
-/* AVL tree of address spaces for fast find by id */
-static avl_tree_t aspaces_tree;
+/* Hash table of address spaces for fast find by id.
+ * Lookups are lockless inside RCU read-side sections.
+ */
+static hash_table_t aspaces_hash;
+static addr_t aspaces_hash_area[HASH_TABLE_STATIC_SIZE(ASPACES_HASH_SIZE) / sizeof(addr_t)];
 
-/* Spinlock for operations on address spaces list and tree */
-static spinlock_t aspaces_lock;
+/* Lock for modifications of address spaces list and hash table */
+static rwlock_t aspaces_lock;
 
 /* Kernel address space */
 static vm_address_space_t *kernel_aspace = NULL;
@@ -39,14 +48,17 @@ static vm_address_space_t *kernel_aspace = NULL;
 
 /*** Locally used routines ***/
 
-/* compare routine for address spaces AVL tree */
-static int compare_aspace_id(const void *a1, const void *a2)
+/* compare routine for address spaces hash table */
+static int compare_aspace_id(const void *elem, const void *key)
 {
-    if( ((vm_address_space_t *)a1)->id > ((vm_address_space_t *)a2)->id )
-        return 1;
-    if( ((vm_address_space_t *)a1)->id < ((vm_address_space_t *)a2)->id )
-        return -1;
-    return 0;
+    return ((vm_address_space_t *)elem)->id != *(const aspace_id *)key;
+}
+
+/* hash routine for address spaces hash table */
+static uint32 hash_aspace_id(const void *elem, const void *key, uint range)
+{
+    aspace_id aid = elem ? ((vm_address_space_t *)elem)->id : *(const aspace_id *)key;
+    return aid % range;
 }
 
 /* compare routine for mappings AVL tree */
@@ -85,17 +97,19 @@ static void put_aspace_to_list(vm_address_space_t *aspace)
     unsigned long irqs_state;
 
     /* acquire lock before touching list */
-    irqs_state = spin_lock_irqsave(&aspaces_lock);
+    irqs_state = rw_write_lock_irqsave(&aspaces_lock);
 
     /* add item */
     xlist_add_last(&aspaces_list, &aspace->list_node);
 
-    /* additionally put it it into tree */
-    if(!avl_tree_add(&aspaces_tree, aspace))
-      panic("put_aspace_to_list(): failed to add aspace into tree!\n");
+    /* lists own one reference until address space deletion */
+    atomic_inc((atomic_t*)&aspace->ref_count);
+
+    /* additionally put it into hash table */
+    hash_table_insert(aspaces_hash, aspace);
 
     /* release lock */
-    spin_unlock_irqrstor(&aspaces_lock, irqs_state);
+    rw_write_unlock_irqrstor(&aspaces_lock, irqs_state);
 }
 
 /* removes address space from list */
@@ -104,17 +118,17 @@ static void remove_aspace_from_list(vm_address_space_t *aspace)
     unsigned long irqs_state;
 
     /* acquire lock before */
-    irqs_state = spin_lock_irqsave(&aspaces_lock);
+    irqs_state = rw_write_lock_irqsave(&aspaces_lock);
 
     /* remove item */
     xlist_remove_unsafe(&aspaces_list, &aspace->list_node);
 
-    /* and remove from tree */
-    if(!avl_tree_remove(&aspaces_tree, aspace))
-      panic("remove_aspace_from_list(): failed to remove aspace from tree!\n");
+    /* and remove from hash table */
+    if(hash_table_remove(aspaces_hash, aspace))
+      panic("remove_aspace_from_list(): failed to remove aspace from hash table!\n");
 
     /* release lock */
-    spin_unlock_irqrstor(&aspaces_lock, irqs_state);
+    rw_write_unlock_irqrstor(&aspaces_lock, irqs_state);
 }
 
 /* locates free gap in memory map of address space (no lock acquired for access) */
@@ -282,6 +296,16 @@ error:
     return NULL; /* failed */
 }
 
+/* frees address space structure after grace period */
+static void free_aspace_rcu(rcu_head_t *head)
+{
+    vm_address_space_t *aspace = containerof(head, vm_address_space_t, rcu);
+
+    if(aspace->name)
+        kfree(aspace->name);
+    kfree(aspace);
+}
+
 /* common routine for deleting address space and freeing occupied memory */
 static void delete_aspace_common(vm_address_space_t *aspace)
 {
@@ -308,10 +332,8 @@ static void delete_aspace_common(vm_address_space_t *aspace)
         vm_aspace_delete_mapping(aspace, mapping);
     }
 
-    /* delete address space structure */
-    if(aspace->name)
-        kfree(aspace->name);
-    kfree(aspace);
+    /* delete address space structure when lockless readers are gone */
+    call_rcu(&aspace->rcu, free_aspace_rcu);
 }
 
 
@@ -324,15 +346,15 @@ status_t vm_address_spaces_init(kernel_args_t *kargs)
     next_aspace_id = 1;
 
     /* init spinlock for list access */
-    spin_init(&aspaces_lock);
+    rw_init(&aspaces_lock);
 
     /* init address spaces list */
     xlist_init(&aspaces_list);
 
-    /* init address spaces AVL tree */
-    avl_tree_create( &aspaces_tree, compare_aspace_id,
-                     sizeof(vm_address_space_t),
-                     offsetof(vm_address_space_t, tree_node) );
+    /* init address spaces hash table */
+    aspaces_hash = hash_table_init_static( aspaces_hash_area, sizeof(aspaces_hash_area),
+                                           offsetof(vm_address_space_t, hash_node),
+                                           compare_aspace_id, hash_aspace_id );
 
     return NO_ERROR;
 }
@@ -501,8 +523,10 @@ status_t vm_delete_aspace(aspace_id aid)
     if(!aspace)
         return ERR_VM_INVALID_ASPACE;
 
-    /* set DELETION state */
-    aspace->state = VM_ASPACE_STATE_DELETION;
+    /* set DELETION state, first deleter also puts reference owned by lists */
+    if(atomic_test_and_set((atomic_t*)&aspace->state, VM_ASPACE_STATE_DELETION,
+                           VM_ASPACE_STATE_NORMAL))
+        vm_put_aspace(aspace);
 
     /* put address space back, this can force actual destruction */
     vm_put_aspace(aspace);
@@ -575,26 +599,23 @@ aspace_id vm_get_current_user_aspace_id(void)
 /* returns address space by its id */
 vm_address_space_t* vm_get_aspace_by_id(aspace_id aid)
 {
-    vm_address_space_t *look_for, *aspace;
+    vm_address_space_t *aspace;
     unsigned long irqs_state;
 
-    /* init search for item */
-    look_for = containerof(&aid, vm_address_space_t, id);
+    /* lockless search, structure is not freed until we leave */
+    irqs_state = rcu_read_lock();
 
-    /* acquire lock before accessing tree */
-    irqs_state = spin_lock_irqsave(&aspaces_lock);
+    /* search hash table */
+    aspace = hash_table_lookup(aspaces_hash, &aid);
 
-    /* search tree */
-    aspace = avl_tree_find(&aspaces_tree, look_for, NULL);
-
-    /* increase references count if aspace found and in proper state */
-    if(aspace && aspace->state == VM_ASPACE_STATE_NORMAL)
-        atomic_inc((atomic_t*)&aspace->ref_count);
-    else
+    /* increase references count if aspace found and in proper state,
+     * zero count means that destruction is already started.
+     */
+    if(!aspace || aspace->state != VM_ASPACE_STATE_NORMAL ||
+       !atomic_inc_not_zero((atomic_t*)&aspace->ref_count))
         aspace = NULL;
 
-    /* release lock */
-    spin_unlock_irqrstor(&aspaces_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return aspace;
 }
@@ -602,13 +623,11 @@ vm_address_space_t* vm_get_aspace_by_id(aspace_id aid)
 /* put previously taken address space */
 void vm_put_aspace(vm_address_space_t *aspace)
 {
-    /* decrease references count */
-    atomic_dec((atomic_t*)&aspace->ref_count);
-
-    /* if state is DELETION and no more referers exists, start
-     * destruction stage or exit.
+    /* decrease references count. lists own one reference until
+     * deletion, so only the one who dropped the last reference
+     * starts destruction stage.
     */
-    if(aspace->state != VM_ASPACE_STATE_DELETION || aspace->ref_count != 0)
+    if(atomic_dec_ret((atomic_t*)&aspace->ref_count) != 1)
         return;
 
     /* remove address space from all control structures */
@@ -656,7 +675,7 @@ aspace_id vm_find_aspace_by_name(const char *name)
         return VM_INVALID_ASPACEID;
 
     /* acquire lock before touching list */
-    irqs_state = spin_lock_irqsave(&aspaces_lock);
+    irqs_state = rw_read_lock_irqsave(&aspaces_lock);
 
     /* start search from first list item */
     item = xlist_peek_first(&aspaces_list);
@@ -679,7 +698,7 @@ aspace_id vm_find_aspace_by_name(const char *name)
     }
 
     /* release lock */
-    spin_unlock_irqrstor(&aspaces_lock, irqs_state);
+    rw_read_unlock_irqrstor(&aspaces_lock, irqs_state);
 
     return id;
 }
@@ -754,17 +773,15 @@ vm_address_space_t *vm_inc_aspace_refcnt(vm_address_space_t *aspace)
 {
     unsigned long irqs_state;
 
-    /* acquire address spaces lock  */
-    irqs_state = spin_lock_irqsave(&aspaces_lock);
+    /* structure is not freed while inside read-side section */
+    irqs_state = rcu_read_lock();
 
     /* increase references count only if aspace is in proper state */
-    if(aspace->state == VM_ASPACE_STATE_NORMAL)
-        atomic_inc((atomic_t*)&aspace->ref_count);
-    else
+    if(aspace->state != VM_ASPACE_STATE_NORMAL ||
+       !atomic_inc_not_zero((atomic_t*)&aspace->ref_count))
         aspace = NULL;
 
-    /* release lock */
-    spin_unlock_irqrstor(&aspaces_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return aspace;
 }
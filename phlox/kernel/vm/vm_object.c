@@ -9,8 +9,11 @@
 #include <phlox/heap.h>
 #include <phlox/list.h>
 #include <phlox/avl_tree.h>
+#include <phlox/hash_table.h>
 #include <phlox/atomic.h>
 #include <phlox/spinlock.h>
+#include <phlox/rwlock.h>
+#include <phlox/rcu.h>
 #include <phlox/vm_page.h>
 #include <phlox/vm_private.h>
 #include <phlox/vm.h>
@@ -19,29 +22,38 @@
 /* Redefinition for convenience */
 typedef xlist_t object_list_t;
 
+/* Buckets count of objects hash table */
+#define OBJECTS_HASH_SIZE  256
+
 /* Next available object id */
 static vuint next_object_id;
 
 /* Objects list */
 static object_list_t objects_list;
 
-/* AVL tree of objects for fast find by id */
-static avl_tree_t objects_tree;
+/* Hash table of objects for fast find by id.
+ * Lookups are lockless inside RCU read-side sections.
+ */
+static hash_table_t objects_hash;
+static addr_t objects_hash_area[HASH_TABLE_STATIC_SIZE(OBJECTS_HASH_SIZE) / sizeof(addr_t)];
 
-/* Spinlock for operations on objects list and tree */
-static spinlock_t objects_lock;
+/* Lock for modifications of objects list and hash table */
+static rwlock_t objects_lock;
 
 
 /*** Locally used routines ***/
 
-/* compare routine for objects AVL tree */
-static int compare_object_id(const void *o1, const void *o2)
+/* compare routine for objects hash table */
+static int compare_object_id(const void *elem, const void *key)
 {
-    if( ((vm_object_t *)o1)->id > ((vm_object_t *)o2)->id )
-        return 1;
-    if( ((vm_object_t *)o1)->id < ((vm_object_t *)o2)->id )
-        return -1;
-    return 0;
+    return ((vm_object_t *)elem)->id != *(const object_id *)key;
+}
+
+/* hash routine for objects hash table */
+static uint32 hash_object_id(const void *elem, const void *key, uint range)
+{
+    object_id oid = elem ? ((vm_object_t *)elem)->id : *(const object_id *)key;
+    return oid % range;
 }
 
 /* compare routine for universal pages tree */
@@ -74,17 +86,19 @@ static void put_object_to_list(vm_object_t *object)
     unsigned long irqs_state;
 
     /* acquire lock before touching list */
-    irqs_state = spin_lock_irqsave(&objects_lock);
+    irqs_state = rw_write_lock_irqsave(&objects_lock);
 
     /* add item */
     xlist_add_last(&objects_list, &object->list_node);
 
-    /* put object into tree */
-    if(!avl_tree_add(&objects_tree, object))
-      panic("put_object_to_list(): failed to add object into tree!\n");
+    /* lists own one reference until object deletion */
+    atomic_inc((atomic_t*)&object->ref_count);
+
+    /* put object into hash table */
+    hash_table_insert(objects_hash, object);
 
     /* release lock */
-    spin_unlock_irqrstor(&objects_lock, irqs_state);
+    rw_write_unlock_irqrstor(&objects_lock, irqs_state);
 }
 
 /* remove object from list */
@@ -93,17 +107,17 @@ static void remove_object_from_list(vm_object_t *object)
     unsigned long irqs_state;
 
     /* acquire lock before modifying list */
-    irqs_state = spin_lock_irqsave(&objects_lock);
+    irqs_state = rw_write_lock_irqsave(&objects_lock);
 
     /* remove item */
     xlist_remove_unsafe(&objects_list, &object->list_node);
 
-    /* and remove it from tree */
-    if(!avl_tree_remove(&objects_tree, object))
-      panic("remove_object_from_list(): failed to remove object from tree!\n");
+    /* and remove it from hash table */
+    if(hash_table_remove(objects_hash, object))
+      panic("remove_object_from_list(): failed to remove object from hash table!\n");
 
     /* release lock */
-    spin_unlock_irqrstor(&objects_lock, irqs_state);
+    rw_write_unlock_irqrstor(&objects_lock, irqs_state);
 }
 
 /* put upage into tree and list of the object keeping list sorted
@@ -265,6 +279,16 @@ error:
     return NULL; /* failed to create object */
 }
 
+/* frees object structure after grace period */
+static void free_object_rcu(rcu_head_t *head)
+{
+    vm_object_t *object = containerof(head, vm_object_t, rcu);
+
+    if(object->name)
+        kfree(object->name);
+    kfree(object);
+}
+
 /* common delete routine for memory objects.
  * releases all occupied memory by object structures.
  */
@@ -295,10 +319,8 @@ static void delete_object_common(vm_object_t *object)
         kfree(upage);
     }
 
-    /* delete object structure */
-    if(object->name)
-        kfree(object->name);
-    kfree(object);
+    /* delete object structure when lockless readers are gone */
+    call_rcu(&object->rcu, free_object_rcu);
 }
 
 
@@ -311,15 +333,15 @@ status_t vm_objects_init(kernel_args_t *kargs)
     next_object_id = 1;
 
     /* init spinlock for list access */
-    spin_init(&objects_lock);
+    rw_init(&objects_lock);
 
     /* init objects list */
     xlist_init(&objects_list);
 
-    /* init objects AVL tree */
-    avl_tree_create( &objects_tree, compare_object_id,
-                     sizeof(vm_object_t),
-                     offsetof(vm_object_t, tree_node) );
+    /* init objects hash table */
+    objects_hash = hash_table_init_static( objects_hash_area, sizeof(objects_hash_area),
+                                           offsetof(vm_object_t, hash_node),
+                                           compare_object_id, hash_object_id );
 
     return NO_ERROR;
 }
@@ -637,8 +659,10 @@ status_t vm_delete_object(object_id oid)
     if(object == NULL)
         return ERR_VM_INVALID_OBJECT;
 
-    /* set deletion state */
-    object->state = VM_OBJECT_STATE_DELETION;
+    /* set deletion state, first deleter also puts reference owned by lists */
+    if(atomic_test_and_set((atomic_t*)&object->state, VM_OBJECT_STATE_DELETION,
+                           VM_OBJECT_STATE_NORMAL))
+        vm_put_object(object);
 
     /* put object back, this can force actual destruction of the object */
     vm_put_object(object);
@@ -650,26 +674,23 @@ status_t vm_delete_object(object_id oid)
 /* returns object by its id */
 vm_object_t *vm_get_object_by_id(object_id oid)
 {
-    vm_object_t *search4, *object;
+    vm_object_t *object;
     unsigned long irqs_state;
 
-    /* search cookie */
-    search4 = containerof(&oid, vm_object_t, id);
-
-    /* acquire lock before accessing tree */
-    irqs_state = spin_lock_irqsave(&objects_lock);
+    /* lockless search, structure is not freed until we leave */
+    irqs_state = rcu_read_lock();
 
-    /* search tree */
-    object = avl_tree_find(&objects_tree, search4, NULL);
+    /* search hash table */
+    object = hash_table_lookup(objects_hash, &oid);
 
-    /* if object found and in proper state - increase references count */
-    if(object && object->state == VM_OBJECT_STATE_NORMAL)
-        atomic_inc((atomic_t*)&object->ref_count);
-    else
+    /* if object found and in proper state - increase references count,
+     * zero count means that destruction is already started.
+     */
+    if(!object || object->state != VM_OBJECT_STATE_NORMAL ||
+       !atomic_inc_not_zero((atomic_t*)&object->ref_count))
         object = NULL;
 
-    /* release lock */
-    spin_unlock_irqrstor(&objects_lock, irqs_state);
+    rcu_read_unlock(irqs_state);
 
     return object;
 }
@@ -677,13 +698,11 @@ vm_object_t *vm_get_object_by_id(object_id oid)
 /* put previously taken object */
 void vm_put_object(vm_object_t *object)
 {
-    /* decrease references count */
-    atomic_dec((atomic_t*)&object->ref_count);
-
-    /* if state is DELETION and no more referers exists, start object
-     * destruction stage or exit.
+    /* decrease references count. lists own one reference until
+     * deletion, so only the one who dropped the last reference
+     * starts object destruction stage.
     */
-    if(object->state != VM_OBJECT_STATE_DELETION || object->ref_count != 0)
+    if(atomic_dec_ret((atomic_t*)&object->ref_count) != 1)
         return;
 
     /* remove object from all control structures */
@@ -707,7 +726,7 @@ object_id vm_find_object_by_name(const char *name)
         return VM_INVALID_OBJECTID;
 
     /* acquire lock before touching list */
-    irqs_state = spin_lock_irqsave(&objects_lock);
+    irqs_state = rw_read_lock_irqsave(&objects_lock);
 
     /* start search from first list item */
     item = xlist_peek_first(&objects_list);
@@ -728,7 +747,7 @@ object_id vm_find_object_by_name(const char *name)
     }
 
     /* release lock */
-    spin_unlock_irqrstor(&objects_lock, irqs_state);
+    rw_read_unlock_irqrstor(&objects_lock, irqs_state);
 
     return id;
 }
@@ -0,0 +1,241 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <sys/debug.h>
+#include <phlox/kernel.h>
+#include <phlox/param.h>
+#include <phlox/errors.h>
+#include <phlox/processor.h>
+#include <phlox/smp.h>
+#include <phlox/thread.h>
+#include <phlox/thread_private.h>
+#include <phlox/scheduler.h>
+#include <phlox/workqueue.h>
+
+
+/**************************************************
+ * Macro definitions
+ **************************************************/
+
+/* Real-time priority of high priority workers */
+#define WORKQUEUE_HIGH_RT_PRIO  0
+
+
+/**************************************************
+ * Types definitions
+ **************************************************/
+
+/* Worker */
+typedef struct {
+    mpsc_queue_t  queue;   /* queued works, consumed by worker thread only */
+    thread_t     *thread;  /* worker thread */
+} worker_t;
+
+
+/**************************************************
+ * Internally used data structures
+ **************************************************/
+
+/* Per cpu workers */
+static worker_t workers[SYSCFG_MAX_CPUS][WORK_PRIORITIES_COUNT];
+
+/* Workers names suffixes */
+static const char *workers_names[WORK_PRIORITIES_COUNT] = {
+    "normal",
+    "high"
+};
+
+
+/**************************************************
+ * Internally used routines
+ **************************************************/
+
+/* suspend worker until new works are queued */
+static void worker_suspend(worker_t *worker)
+{
+    thread_t *thread;
+
+    local_irqs_disable();
+
+    /* announce suspension before final check of queue, so
+     * producer queueing work after the check resumes us.
+     */
+    thread = thread_get_current_thread_locked();
+    thread->next_state = THREAD_STATE_SUSPENDED;
+    thread_unlock_thread(thread);
+
+    if(!mpsc_queue_isempty(&worker->queue)) {
+        thread_lock_thread(thread);
+        thread->next_state = THREAD_STATE_READY;
+        thread_unlock_thread(thread);
+        local_irqs_enable();
+        return;
+    }
+
+    sched_reschedule();
+    /* NOTE: interrupts will be reenabled during rescheduling. */
+}
+
+/* resume suspended worker */
+static void worker_wakeup(worker_t *worker)
+{
+    thread_t *thread = worker->thread;
+    unsigned long irqs_state;
+
+    /* not started yet, queue will be checked on start */
+    if(!thread)
+        return;
+
+    local_irqs_save_and_disable(irqs_state);
+    thread_lock_thread(thread);
+
+    /* add to scheduler if was suspended */
+    if(thread->state == THREAD_STATE_SUSPENDED)
+        sched_add_thread(thread);
+    /* cancel suspended state on next reschedule */
+    if(thread->next_state == THREAD_STATE_SUSPENDED)
+        thread->next_state = THREAD_STATE_READY;
+
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+}
+
+/* worker thread routine */
+static int worker_thread(void *data)
+{
+    worker_t *worker = (worker_t *)data;
+    mpsc_queue_elem_t *e;
+    work_t *work;
+
+    while(1) {
+        e = mpsc_queue_pop(&worker->queue);
+
+        /* suspend if no works in queue, will be resumed
+         * when new work be queued.
+         */
+        if(!e) {
+            worker_suspend(worker);
+            continue;
+        }
+
+        /* work may be queued again since now and routine
+         * may free it, so it is not touched after call.
+         */
+        work = containerof(e, work_t, queue_node);
+        atomic_set(&work->pending, 0);
+        work->func(work);
+    }
+
+    return 0; /* control never goes here, but keep compiler happy */
+}
+
+/* create worker thread for given cpu and priority */
+static status_t worker_create(uint cpu, int priority)
+{
+    worker_t *worker = &workers[cpu][priority];
+    char name[SYS_MAX_OS_NAME_LEN];
+    unsigned long irqs_state;
+    thread_t *thread;
+    thread_id id;
+    status_t err = NO_ERROR;
+
+    snprintf(name, SYS_MAX_OS_NAME_LEN, "worker_thread_%d_%s", cpu, workers_names[priority]);
+
+    /* created suspended to be set up before start */
+    id = thread_create_kernel_thread(name, &worker_thread, worker, true);
+    if(id == INVALID_THREADID)
+        return ERR_MT_GENERAL;
+
+    /* get pointer to thread structure */
+    thread = thread_get_thread_struct(id);
+    if(thread == NULL)
+        return ERR_MT_GENERAL;
+
+    local_irqs_save_and_disable(irqs_state);
+    thread_lock_thread(thread);
+
+    /* start on its own cpu */
+    thread->cpu = &ProcessorSet.processors[cpu];
+    if(priority == WORK_PRIORITY_HIGH)
+        err = sched_set_thread_class(thread, THREAD_SCHED_RR, WORKQUEUE_HIGH_RT_PRIO);
+
+    thread_unlock_thread(thread);
+    local_irqs_restore(irqs_state);
+
+    if(err != NO_ERROR)
+        return err;
+
+    worker->thread = thread;
+
+    return thread_resume(id);
+}
+
+
+/**************************************************
+ * Public routines
+ **************************************************/
+
+/* create worker threads */
+status_t workqueue_init(kernel_args_t *kargs)
+{
+    uint cpu, num_cpus = smp_get_num_cpus();
+    int prio;
+    status_t err;
+
+    for(cpu = 0; cpu < SYSCFG_MAX_CPUS; cpu++) {
+        for(prio = 0; prio < WORK_PRIORITIES_COUNT; prio++) {
+            mpsc_queue_init(&workers[cpu][prio].queue);
+            workers[cpu][prio].thread = NULL;
+        }
+    }
+
+    for(cpu = 0; cpu < num_cpus; cpu++) {
+        for(prio = 0; prio < WORK_PRIORITIES_COUNT; prio++) {
+            err = worker_create(cpu, prio);
+            if(err != NO_ERROR)
+                return err;
+        }
+    }
+
+    return NO_ERROR;
+}
+
+/* init work item */
+void work_init(work_t *work, void (*func)(work_t *work), int priority)
+{
+    ASSERT_MSG(priority >= 0 && priority < WORK_PRIORITIES_COUNT,
+        "work_init(): invalid work priority!\n");
+
+    work->queue_node.next = NULL;
+    work->func = func;
+    work->priority = priority;
+    work->pending = 0;
+}
+
+/* queue work to worker of current cpu */
+bool work_queue(work_t *work)
+{
+    return work_queue_on(work, get_current_processor());
+}
+
+/* queue work to worker of given cpu */
+bool work_queue_on(work_t *work, uint cpu)
+{
+    worker_t *worker;
+
+    /* already queued */
+    if(!atomic_test_and_set(&work->pending, 1, 0))
+        return false;
+
+    /* cpu has no workers, use bootstrap cpu ones */
+    if(cpu >= smp_get_num_cpus())
+        cpu = 0;
+
+    /* resume worker if queue was empty, otherwise it is already resumed */
+    worker = &workers[cpu][work->priority];
+    if(mpsc_queue_push(&worker->queue, &work->queue_node))
+        worker_wakeup(worker);
+
+    return true;
+}
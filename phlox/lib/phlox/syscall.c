@@ -112,3 +112,65 @@ status_t sys_virtmem_free(void *ptr)
 {
     return __syscall1(SYSCALL_VIRTMEM_FREE, (ulong)ptr);
 }
+
+/* get thread and process execution times */
+status_t sys_thread_times(thread_id tid, thread_times_t *times)
+{
+    return __syscall2(SYSCALL_THREAD_TIMES, (ulong)tid, (ulong)times);
+}
+
+/* set thread scheduling class */
+status_t sys_thread_set_sched(thread_id tid, int sched_class, int rt_prio)
+{
+    return __syscall3(SYSCALL_THREAD_SET_SCHED, (ulong)tid, (ulong)sched_class, (ulong)rt_prio);
+}
+
+/* block on word */
+status_t sys_futex_wait(volatile int *addr, int val, unsigned timeout_msec)
+{
+    return __syscall3(SYSCALL_FUTEX_WAIT, (ulong)addr, (ulong)val, (ulong)timeout_msec);
+}
+
+/* wake up threads blocked on word */
+int sys_futex_wake(volatile int *addr, unsigned count)
+{
+    return __syscall2(SYSCALL_FUTEX_WAKE, (ulong)addr, (ulong)count);
+}
+
+/* count down any of semaphores */
+int sys_sem_down_any(const sem_id *ids, unsigned count, unsigned timeout_msec, flags_t flags)
+{
+    return __syscall4(SYSCALL_SEM_DOWN_ANY, (ulong)ids, (ulong)count, (ulong)timeout_msec,
+            (ulong)flags);
+}
+
+/* count one semaphore up and another one down */
+status_t sys_sem_up_and_down(sem_id up_id, sem_id down_id, unsigned timeout_msec, flags_t flags)
+{
+    return __syscall4(SYSCALL_SEM_UP_AND_DOWN, (ulong)up_id, (ulong)down_id, (ulong)timeout_msec,
+            (ulong)flags);
+}
+
+/* get time since system booted up */
+status_t sys_system_time(bigtime_t *nsec)
+{
+    return __syscall1(SYSCALL_SYSTEM_TIME, (ulong)nsec);
+}
+
+/* put thread into high-resolution sleep */
+void sys_thread_usleep(unsigned usec)
+{
+    __syscall1(SYSCALL_THREAD_USLEEP, (ulong)usec);
+}
+
+/* set thread timer slack */
+status_t sys_thread_set_timer_slack(thread_id tid, unsigned usec)
+{
+    return __syscall2(SYSCALL_THREAD_SET_TIMER_SLACK, (ulong)tid, (ulong)usec);
+}
+
+/* print spinlocks statistics */
+status_t sys_spin_stats(unsigned count, flags_t flags)
+{
+    return __syscall2(SYSCALL_SPIN_STATS, (ulong)count, (ulong)flags);
+}
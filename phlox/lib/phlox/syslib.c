@@ -39,6 +39,37 @@ status_t service_load(const char *path)
     return sys_svc_load(path, (unsigned)strlen(path), PROCESS_ROLE_SERVICE);
 }
 
+/* get nanoseconds since system booted up.
+ * read from shared time page without entering the kernel.
+ */
+bigtime_t system_time(void)
+{
+    const time_page_t *page = (const time_page_t *)USER_TIME_PAGE_BASE;
+    bigtime_t base, ticks, nsec_per_tick;
+    unsigned long long cycles;
+    unsigned seq, khz;
+
+    /* take consistent snapshot of page */
+    do {
+        while((seq = page->seq) & 1)
+            ; /* kernel is updating page */
+        __asm__ __volatile__ ("" : : : "memory");
+        khz = page->cycles_khz;
+        base = page->cycles_base;
+        ticks = page->ticks;
+        nsec_per_tick = page->nsec_per_tick;
+        __asm__ __volatile__ ("" : : : "memory");
+    } while(seq != page->seq);
+
+    /* tick resolution only */
+    if(!khz)
+        return ticks * nsec_per_tick;
+
+    /* convert cycles to nanoseconds without overflow */
+    cycles = (unsigned long long)(read_cycles_counter() - base);
+    return (bigtime_t)((cycles / khz) * 1000000 + ((cycles % khz) * 1000000) / khz);
+}
+
 /* create new semaphore */
 sem_id semaphore_create(const char *name, unsigned max_count, unsigned init_count)
 {
@@ -69,14 +100,287 @@ status_t semaphore_down_timeout(sem_id id, unsigned count, unsigned timeout_msec
     return sys_sem_down(id, count, timeout_msec, SYS_SEMF_TIMEOUT);
 }
 
+/* count down any of semaphores */
+int semaphore_down_any(const sem_id *ids, unsigned count)
+{
+    return sys_sem_down_any(ids, count, 0, SYS_SEMF_NOFLAGS);
+}
+
+/* count down any of semaphores with timeout */
+int semaphore_down_any_timeout(const sem_id *ids, unsigned count, unsigned timeout_msec)
+{
+    return sys_sem_down_any(ids, count, timeout_msec, SYS_SEMF_TIMEOUT);
+}
+
 /* count up semaphore */
 status_t semaphore_up(sem_id id, unsigned count)
 {
     return sys_sem_up(id, count);
 }
 
+/* count one semaphore up and wait for another one */
+status_t semaphore_up_and_down(sem_id up_id, sem_id down_id)
+{
+    return sys_sem_up_and_down(up_id, down_id, 0, SYS_SEMF_NOFLAGS);
+}
+
 /* get named semaphore */
 sem_id semaphore_get_by_name(const char *name)
 {
     return sys_sem_get_by_name(name, (unsigned)strlen(name));
 }
+
+/* try to take one count of user space semaphore */
+static bool usem_take(usem_t *sem)
+{
+    int c;
+
+    while((c = sem->count) > 0) {
+        if(atomic_cmpxchg(&sem->count, c - 1, c))
+            return true;
+    }
+
+    return false;
+}
+
+/* count down user space semaphore */
+static status_t usem_down_ex(usem_t *sem, unsigned timeout_msec, flags_t flags)
+{
+    status_t err = NO_ERROR;
+
+    /* fast path: no kernel entrance */
+    if(usem_take(sem))
+        return NO_ERROR;
+    if(flags & SYS_SEMF_TRY)
+        return ERR_SEM_TRY_FAILED;
+
+    /* announce waiter, so count up enters kernel to wake us */
+    atomic_fetch_add(&sem->waiters, 1);
+
+    while(!usem_take(sem)) {
+        /* block while count is zero.
+         * Note: timeout is restarted after each wake up.
+         */
+        err = sys_futex_wait(&sem->count, 0, (flags & SYS_SEMF_TIMEOUT) ? timeout_msec : 0);
+        if(err == ERR_FTX_TIMEOUT) {
+            err = ERR_SEM_TIMEOUT;
+            break;
+        } else if(err != NO_ERROR && err != ERR_FTX_WOULD_BLOCK)
+            break;
+        err = NO_ERROR;
+    }
+
+    atomic_fetch_add(&sem->waiters, -1);
+
+    return err;
+}
+
+/* init user space semaphore */
+void usem_init(usem_t *sem, unsigned init_count)
+{
+    sem->count = (int)init_count;
+    sem->waiters = 0;
+}
+
+/* count down user space semaphore */
+status_t usem_down(usem_t *sem)
+{
+    return usem_down_ex(sem, 0, SYS_SEMF_NOFLAGS);
+}
+
+/* try to count down user space semaphore */
+status_t usem_try_down(usem_t *sem)
+{
+    return usem_down_ex(sem, 0, SYS_SEMF_TRY);
+}
+
+/* count down user space semaphore with timeout */
+status_t usem_down_timeout(usem_t *sem, unsigned timeout_msec)
+{
+    if(!timeout_msec)
+        return usem_try_down(sem) == NO_ERROR ? NO_ERROR : ERR_SEM_TIMEOUT;
+
+    return usem_down_ex(sem, timeout_msec, SYS_SEMF_TIMEOUT);
+}
+
+/* count up user space semaphore */
+status_t usem_up(usem_t *sem, unsigned count)
+{
+    if(!count)
+        return NO_ERROR;
+
+    atomic_fetch_add(&sem->count, (int)count);
+
+    /* slow path: somebody waits */
+    if(sem->waiters) {
+        int woken = sys_futex_wake(&sem->count, count);
+        if(woken < 0)
+            return woken;
+    }
+
+    return NO_ERROR;
+}
+
+/* init user space condition variable */
+void ucond_init(ucond_t *cond)
+{
+    cond->seq = 0;
+    cond->waiters = 0;
+}
+
+/* wait on user space condition variable with timeout */
+static status_t ucond_wait_ex(ucond_t *cond, usem_t *mtx, unsigned timeout_msec)
+{
+    int seq = cond->seq;
+    status_t err;
+
+    /* announce waiter before mutex release, signal sent after
+     * release changes sequence number, so it is never missed.
+     */
+    atomic_fetch_add(&cond->waiters, 1);
+
+    err = usem_up(mtx, 1);
+    if(err != NO_ERROR) {
+        atomic_fetch_add(&cond->waiters, -1);
+        return err;
+    }
+
+    err = sys_futex_wait(&cond->seq, seq, timeout_msec);
+    if(err == ERR_FTX_TIMEOUT)
+        err = ERR_CND_TIMEOUT;
+    else if(err == ERR_FTX_WOULD_BLOCK)
+        err = NO_ERROR; /* signaled before we blocked */
+
+    atomic_fetch_add(&cond->waiters, -1);
+
+    /* acquire mutex back */
+    usem_down(mtx);
+
+    return err;
+}
+
+/* wait on user space condition variable */
+status_t ucond_wait(ucond_t *cond, usem_t *mtx)
+{
+    return ucond_wait_ex(cond, mtx, 0);
+}
+
+/* wait on user space condition variable with timeout */
+status_t ucond_wait_timeout(ucond_t *cond, usem_t *mtx, unsigned timeout_msec)
+{
+    if(!timeout_msec)
+        return ERR_CND_TIMEOUT;
+
+    return ucond_wait_ex(cond, mtx, timeout_msec);
+}
+
+/* wake up threads waiting on user space condition variable */
+static status_t ucond_wake(ucond_t *cond, unsigned count)
+{
+    atomic_fetch_add(&cond->seq, 1);
+
+    /* slow path: somebody waits */
+    if(cond->waiters) {
+        int woken = sys_futex_wake(&cond->seq, count);
+        if(woken < 0)
+            return woken;
+    }
+
+    return NO_ERROR;
+}
+
+/* signal user space condition variable */
+status_t ucond_signal(ucond_t *cond)
+{
+    return ucond_wake(cond, 1);
+}
+
+/* broadcast user space condition variable */
+status_t ucond_broadcast(ucond_t *cond)
+{
+    return ucond_wake(cond, (unsigned)-1);
+}
+
+/* init user space event */
+void uevent_init(uevent_t *ev, int manual_reset, int init_state)
+{
+    ev->state = init_state ? 1 : 0;
+    ev->waiters = 0;
+    ev->manual = manual_reset;
+}
+
+/* take event state. returns true if event was set. */
+static bool uevent_take(uevent_t *ev)
+{
+    if(ev->manual)
+        return ev->state != 0;
+
+    return atomic_cmpxchg(&ev->state, 0, 1) != 0;
+}
+
+/* wait on user space event */
+static status_t uevent_wait_ex(uevent_t *ev, unsigned timeout_msec)
+{
+    status_t err = NO_ERROR;
+
+    /* fast path: no kernel entrance */
+    if(uevent_take(ev))
+        return NO_ERROR;
+
+    /* announce waiter, so set enters kernel to wake us */
+    atomic_fetch_add(&ev->waiters, 1);
+
+    while(!uevent_take(ev)) {
+        /* block while event is reset.
+         * Note: timeout is restarted after each wake up.
+         */
+        err = sys_futex_wait(&ev->state, 0, timeout_msec);
+        if(err == ERR_FTX_TIMEOUT) {
+            err = ERR_CND_TIMEOUT;
+            break;
+        } else if(err != NO_ERROR && err != ERR_FTX_WOULD_BLOCK)
+            break;
+        err = NO_ERROR;
+    }
+
+    atomic_fetch_add(&ev->waiters, -1);
+
+    return err;
+}
+
+/* wait on user space event */
+status_t uevent_wait(uevent_t *ev)
+{
+    return uevent_wait_ex(ev, 0);
+}
+
+/* wait on user space event with timeout */
+status_t uevent_wait_timeout(uevent_t *ev, unsigned timeout_msec)
+{
+    if(!timeout_msec)
+        return uevent_take(ev) ? NO_ERROR : ERR_CND_TIMEOUT;
+
+    return uevent_wait_ex(ev, timeout_msec);
+}
+
+/* set user space event */
+status_t uevent_set(uevent_t *ev)
+{
+    /* Note: locked instruction orders state store before waiters read */
+    atomic_cmpxchg(&ev->state, 1, 0);
+
+    /* slow path: somebody waits */
+    if(ev->waiters) {
+        int woken = sys_futex_wake(&ev->state, ev->manual ? (unsigned)-1 : 1);
+        if(woken < 0)
+            return woken;
+    }
+
+    return NO_ERROR;
+}
+
+/* reset user space event */
+void uevent_reset(uevent_t *ev)
+{
+    ev->state = 0;
+}
@@ -8,7 +8,16 @@ TEST_MAIN_SRC +=               \
 	$(LOCDIR)/test3.c      \
 	$(LOCDIR)/test4.c      \
 	$(LOCDIR)/test5.c      \
-	$(LOCDIR)/test6.c
+	$(LOCDIR)/test6.c      \
+	$(LOCDIR)/test7.c      \
+	$(LOCDIR)/test8.c      \
+	$(LOCDIR)/test9.c      \
+	$(LOCDIR)/test10.c     \
+	$(LOCDIR)/test11.c     \
+	$(LOCDIR)/test12.c     \
+	$(LOCDIR)/test13.c     \
+	$(LOCDIR)/test14.c     \
+	$(LOCDIR)/test15.c
 
 TEST_MAIN_DEP = $(LIBPHLOX) $(LIBSTRING)
 
@@ -0,0 +1,96 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Condition variable and events ******************************************/
+
+#define COND_THREADS  4
+
+static usem_t cond_lock;
+static ucond_t cond_var;
+static uevent_t cond_start;
+static usem_t cond_done;
+static volatile int cond_ready = 0;
+static volatile int cond_go = 0;
+static volatile int cond_woken = 0;
+
+static int cond_thread_func(void *data)
+{
+    /* wait on manual-reset event released for everybody */
+    if(uevent_wait_timeout(&cond_start, 5000) != NO_ERROR)
+        return 0;
+
+    /* wait for broadcast */
+    usem_down(&cond_lock);
+    cond_ready++;
+    while(!cond_go)
+        ucond_wait(&cond_var, &cond_lock);
+    cond_woken++;
+    usem_up(&cond_lock, 1);
+
+    usem_up(&cond_done, 1);
+
+    return 0;
+}
+
+int test10(void)
+{
+    uevent_t ev;
+    thread_id tid;
+    int i, ready;
+
+    usem_init(&cond_lock, 1);
+    usem_init(&cond_done, 0);
+    ucond_init(&cond_var);
+    uevent_init(&cond_start, 1, 0);
+
+    /* auto-reset event is taken once */
+    uevent_init(&ev, 0, 1);
+    if(uevent_wait_timeout(&ev, 0) != NO_ERROR)
+        return 0;
+    if(uevent_wait_timeout(&ev, 20) != ERR_CND_TIMEOUT)
+        return 0;
+
+    /* condition wait timeout */
+    usem_down(&cond_lock);
+    if(ucond_wait_timeout(&cond_var, &cond_lock, 20) != ERR_CND_TIMEOUT)
+        return 0;
+    usem_up(&cond_lock, 1);
+
+    for(i = 0; i < COND_THREADS; ++i) {
+        tid = sys_create_thread(cond_thread_func, NULL, false, 0);
+        if(tid == INVALID_THREADID)
+            return 0;
+    }
+
+    /* release all threads */
+    uevent_set(&cond_start);
+
+    /* wait until all threads are waiting on condition */
+    for(i = 0; i < 500; ++i) {
+        usem_down(&cond_lock);
+        ready = cond_ready;
+        usem_up(&cond_lock, 1);
+        if(ready == COND_THREADS)
+            break;
+        sys_thread_yield();
+    }
+
+    /* wake up everybody with single call */
+    usem_down(&cond_lock);
+    cond_go = 1;
+    ucond_broadcast(&cond_var);
+    usem_up(&cond_lock, 1);
+
+    for(i = 0; i < COND_THREADS; ++i) {
+        if(usem_down_timeout(&cond_done, 5000) != NO_ERROR)
+            return 0;
+    }
+
+    return cond_woken == COND_THREADS ? 1 : 0;
+}
@@ -0,0 +1,74 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Waiting for many semaphores ********************************************/
+
+#define ANY_SEMS   3
+#define ANY_LOOPS  30
+
+static sem_id any_sems[ANY_SEMS];
+static volatile int any_received[ANY_SEMS];
+
+static int any_thread_func(void *data)
+{
+    int i;
+
+    /* signal semaphores in turn */
+    for(i = 0; i < ANY_LOOPS; ++i) {
+        semaphore_up(any_sems[i % ANY_SEMS], 1);
+        if(!(i & 3))
+            sys_thread_yield();
+    }
+
+    return 0;
+}
+
+int test11(void)
+{
+    thread_id tid;
+    int i, idx;
+
+    for(i = 0; i < ANY_SEMS; ++i) {
+        any_sems[i] = semaphore_create(NULL, ANY_LOOPS, 0);
+        if(any_sems[i] == INVALID_SEMID)
+            return 0;
+        any_received[i] = 0;
+    }
+
+    /* nothing signaled yet */
+    if(sys_sem_down_any(any_sems, ANY_SEMS, 0, SYS_SEMF_TRY) != ERR_SEM_TRY_FAILED)
+        return 0;
+    if(semaphore_down_any_timeout(any_sems, ANY_SEMS, 20) != ERR_SEM_TIMEOUT)
+        return 0;
+
+    /* index of signaled semaphore is returned */
+    semaphore_up(any_sems[2], 1);
+    if(semaphore_down_any(any_sems, ANY_SEMS) != 2)
+        return 0;
+
+    /* receive signals from other thread */
+    tid = sys_create_thread(any_thread_func, NULL, false, 0);
+    if(tid == INVALID_THREADID)
+        return 0;
+
+    for(i = 0; i < ANY_LOOPS; ++i) {
+        idx = semaphore_down_any_timeout(any_sems, ANY_SEMS, 5000);
+        if(idx < 0 || idx >= ANY_SEMS)
+            return 0;
+        any_received[idx]++;
+    }
+
+    for(i = 0; i < ANY_SEMS; ++i) {
+        if(any_received[i] != ANY_LOOPS / ANY_SEMS)
+            return 0;
+        semaphore_delete(any_sems[i]);
+    }
+
+    return 1;
+}
@@ -0,0 +1,71 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Semaphore request and reply hand-off ***********************************/
+
+#define HANDOFF_LOOPS  100
+
+static sem_id handoff_req, handoff_reply;
+static volatile int handoff_value;
+
+static int handoff_server_func(void *data)
+{
+    /* wait for first request */
+    if(semaphore_down(handoff_req, 1) != NO_ERROR)
+        return 0;
+
+    /* serve requests until semaphore deleted */
+    do {
+        handoff_value++;
+    } while(semaphore_up_and_down(handoff_reply, handoff_req) == NO_ERROR);
+
+    return 0;
+}
+
+int test12(void)
+{
+    thread_id tid;
+    int i;
+
+    handoff_req = semaphore_create(NULL, 1, 0);
+    handoff_reply = semaphore_create(NULL, 1, 0);
+    if(handoff_req == INVALID_SEMID || handoff_reply == INVALID_SEMID)
+        return 0;
+
+    /* invalid semaphore is not waited for */
+    if(sys_sem_up_and_down(handoff_reply, INVALID_SEMID, 0, SYS_SEMF_NOFLAGS) != ERR_SEM_INVALID_HANDLE)
+        return 0;
+    if(semaphore_down(handoff_reply, 1) != NO_ERROR)
+        return 0;
+
+    tid = sys_create_thread(handoff_server_func, NULL, false, 0);
+    if(tid == INVALID_THREADID)
+        return 0;
+
+    /* each request is served before reply */
+    for(i = 0; i < HANDOFF_LOOPS; ++i) {
+        handoff_value = i;
+        if(semaphore_up_and_down(handoff_req, handoff_reply) != NO_ERROR)
+            return 0;
+        if(handoff_value != i + 1)
+            return 0;
+    }
+
+    /* reply timeout */
+    if(sys_sem_up_and_down(handoff_reply, handoff_reply, 0, SYS_SEMF_TRY) != NO_ERROR)
+        return 0;
+    if(sys_sem_up_and_down(handoff_reply, handoff_req, 10, SYS_SEMF_TIMEOUT) != ERR_SEM_TIMEOUT)
+        return 0;
+
+    /* server exits */
+    semaphore_delete(handoff_req);
+    semaphore_delete(handoff_reply);
+
+    return 1;
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** High-resolution clock and sleeps ***************************************/
+
+#define HRES_LOOPS       20
+#define HRES_SLEEP_USEC  250
+
+int test13(void)
+{
+    bigtime_t prev, now, start;
+    int i;
+
+    /* invalid argument */
+    if(sys_system_time(NULL) != ERR_INVALID_ARGS)
+        return 0;
+
+    /* clock never goes backward */
+    prev = system_time();
+    for(i = 0; i < HRES_LOOPS * 10; ++i) {
+        now = system_time();
+        if(now < prev)
+            return 0;
+        prev = now;
+    }
+
+    /* sleeps last at least given time */
+    for(i = 0; i < HRES_LOOPS; ++i) {
+        start = system_time();
+        sys_thread_usleep(HRES_SLEEP_USEC);
+        now = system_time();
+        if(now - start < HRES_SLEEP_USEC * 1000LL)
+            return 0;
+    }
+
+    /* zero sleep just yields */
+    sys_thread_usleep(0);
+
+    return 1;
+}
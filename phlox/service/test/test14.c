@@ -0,0 +1,42 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Shared time page *******************************************************/
+
+#define TPAGE_LOOPS      100
+#define TPAGE_TOLERANCE  10000000LL  /* 10 msec, more than one tick */
+#define TPAGE_MAX_DELTA  1000000000LL
+
+int test14(void)
+{
+    const time_page_t *page = (const time_page_t *)USER_TIME_PAGE_BASE;
+    bigtime_t before, kernel, after;
+    int i;
+
+    /* page is published */
+    if(!page->nsec_per_tick)
+        return 0;
+
+    /* page time agrees with kernel time */
+    for(i = 0; i < TPAGE_LOOPS; ++i) {
+        before = system_time();
+        if(sys_system_time(&kernel) != NO_ERROR)
+            return 0;
+        after = system_time();
+
+        if(after < before)
+            return 0;
+        if(kernel + TPAGE_TOLERANCE < before || after + TPAGE_TOLERANCE < kernel)
+            return 0;
+        if(after - before > TPAGE_MAX_DELTA)
+            return 0;
+    }
+
+    return 1;
+}
@@ -0,0 +1,95 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Timer slack ************************************************************/
+
+#define SLACK_LOOPS       20
+#define SLACK_USEC        2000
+#define SLACK_SLEEP_USEC  500
+#define SLACK_MAX_NSEC    100000000LL  /* sleep + slack + scheduling delays */
+
+#define COALESCE_SLEEP_MSEC      100
+#define COALESCE_EARLY_MSEC      4        /* one timer tick earlier */
+#define COALESCE_SLACK_USEC      8000
+#define COALESCE_MAX_DIFF_NSEC   2000000LL  /* half of timer tick */
+#define COALESCE_WAIT_LOOPS      10000
+
+static volatile bigtime_t coalesce_start, coalesce_wake;
+
+static int coalesce_thread_func(void *data)
+{
+    /* exact sleep, its expiration is joined by main thread */
+    sys_thread_set_timer_slack(0, 0);
+
+    coalesce_start = system_time();
+    sys_thread_sleep(COALESCE_SLEEP_MSEC);
+    coalesce_wake = system_time();
+
+    return 0;
+}
+
+int test15(void)
+{
+    bigtime_t start, now;
+    thread_id tid;
+    int i;
+
+    /* invalid thread */
+    if(sys_thread_set_timer_slack(-1, SLACK_USEC) != ERR_MT_INVALID_HANDLE)
+        return 0;
+
+    /* sleeps with slack last at least given time, but not much longer */
+    if(sys_thread_set_timer_slack(0, SLACK_USEC) != NO_ERROR)
+        return 0;
+
+    for(i = 0; i < SLACK_LOOPS; ++i) {
+        start = system_time();
+        sys_thread_usleep(SLACK_SLEEP_USEC);
+        now = system_time();
+        if(now - start < SLACK_SLEEP_USEC * 1000LL || now - start > SLACK_MAX_NSEC)
+            return 0;
+    }
+
+    /* exact sleeps */
+    if(sys_thread_set_timer_slack(sys_current_thread_id(), 0) != NO_ERROR)
+        return 0;
+
+    start = system_time();
+    sys_thread_usleep(SLACK_SLEEP_USEC);
+    now = system_time();
+    if(now - start < SLACK_SLEEP_USEC * 1000LL)
+        return 0;
+
+    /* tick sleep with slack window covering expiration of other
+     * thread wakes up on the same tick, not one tick earlier.
+     */
+    coalesce_start = coalesce_wake = 0;
+    tid = sys_create_thread(coalesce_thread_func, NULL, false, 0);
+    if(tid == INVALID_THREADID)
+        return 0;
+    for(i = 0; i < COALESCE_WAIT_LOOPS && !coalesce_start; ++i)
+        sys_thread_yield();
+    if(!coalesce_start)
+        return 0;
+
+    if(sys_thread_set_timer_slack(0, COALESCE_SLACK_USEC) != NO_ERROR)
+        return 0;
+    sys_thread_sleep(COALESCE_SLEEP_MSEC - COALESCE_EARLY_MSEC);
+    now = system_time();
+
+    for(i = 0; i < COALESCE_WAIT_LOOPS && !coalesce_wake; ++i)
+        sys_thread_yield();
+    if(!coalesce_wake)
+        return 0;
+    if(now - coalesce_wake > COALESCE_MAX_DIFF_NSEC ||
+       coalesce_wake - now > COALESCE_MAX_DIFF_NSEC)
+        return 0;
+
+    return 1;
+}
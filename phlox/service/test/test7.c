@@ -0,0 +1,41 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Thread execution time accounting test **********************************/
+
+int test7(void)
+{
+    volatile unsigned sum = 0;
+    thread_times_t times;
+    unsigned i;
+    status_t err;
+
+    /* burn some user-side time */
+    for(i = 0; i < 10000000; ++i)
+        sum += i;
+
+    /* query times of current thread */
+    err = sys_thread_times(0, &times);
+    if(err != NO_ERROR)
+        return 0;
+
+    /* thread spent time in user space */
+    if(times.thread_user_time <= 0)
+        return 0;
+
+    /* process times include thread times */
+    if(times.process_user_time < times.thread_user_time ||
+       times.process_kernel_time < times.thread_kernel_time)
+        return 0;
+
+    /* unknown thread id is rejected */
+    err = sys_thread_times((thread_id)-1, &times);
+
+    return err != NO_ERROR ? 1 : 0;
+}
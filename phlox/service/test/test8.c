@@ -0,0 +1,69 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** Real-time scheduling class *********************************************/
+
+static volatile int rt_counter = 0;
+
+static int rt_thread_func(void *data)
+{
+    int i;
+
+    /* run as real-time thread, yield does not lower our priority */
+    for(i = 0; i < 10; ++i) {
+        ++rt_counter;
+        sys_thread_yield();
+    }
+
+    /* back to ordinary scheduling */
+    if(sys_thread_set_sched(0, SYS_SCHED_NORMAL, 0) != NO_ERROR)
+        rt_counter = -1;
+
+    return 0;
+}
+
+int test8(void)
+{
+    thread_id tid;
+    status_t err;
+
+    /* wrong class and priority values are rejected */
+    if(sys_thread_set_sched(0, 10, 0) == NO_ERROR)
+        return 0;
+    if(sys_thread_set_sched(0, SYS_SCHED_FIFO, 100) == NO_ERROR)
+        return 0;
+
+    /* current thread may become real-time and return back */
+    err = sys_thread_set_sched(0, SYS_SCHED_RR, 1);
+    if(err != NO_ERROR)
+        return 0;
+    sys_thread_yield();
+    err = sys_thread_set_sched(0, SYS_SCHED_NORMAL, 0);
+    if(err != NO_ERROR)
+        return 0;
+
+    /* create real-time thread in suspended state */
+    tid = sys_create_thread(rt_thread_func, NULL, true, 0);
+    if(tid == INVALID_THREADID)
+        return 0;
+
+    err = sys_thread_set_sched(tid, SYS_SCHED_FIFO, 5);
+    if(err != NO_ERROR)
+        return 0;
+
+    /* let it run */
+    err = sys_thread_resume(tid);
+    if(err != NO_ERROR)
+        return 0;
+
+    /* wait for its completion */
+    sys_thread_sleep(100);
+
+    return rt_counter == 10 ? 1 : 0;
+}
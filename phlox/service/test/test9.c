@@ -0,0 +1,77 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <phlox/errors.h>
+#include <app/syslib.h>
+#include "tests.h"
+
+
+/***** User space semaphore ***************************************************/
+
+#define USEM_THREADS  4
+#define USEM_LOOPS    1000
+
+static usem_t usem_lock;
+static usem_t usem_done;
+static volatile int usem_counter = 0;
+
+static int usem_thread_func(void *data)
+{
+    int i, tmp;
+
+    /* increment counter inside of critical section */
+    for(i = 0; i < USEM_LOOPS; ++i) {
+        usem_down(&usem_lock);
+        tmp = usem_counter;
+        if(!(i & 0x3F))
+            sys_thread_yield(); /* let others contend for lock */
+        usem_counter = tmp + 1;
+        usem_up(&usem_lock, 1);
+    }
+
+    usem_up(&usem_done, 1);
+
+    return 0;
+}
+
+int test9(void)
+{
+    thread_id tid;
+    int i;
+
+    /* semaphore used as lock */
+    usem_init(&usem_lock, 1);
+    usem_init(&usem_done, 0);
+
+    /* uncontended operations */
+    if(usem_try_down(&usem_lock) != NO_ERROR)
+        return 0;
+    if(usem_try_down(&usem_lock) != ERR_SEM_TRY_FAILED)
+        return 0;
+    if(usem_up(&usem_lock, 1) != NO_ERROR)
+        return 0;
+
+    /* timeout expires on zero count */
+    if(usem_down_timeout(&usem_done, 20) != ERR_SEM_TIMEOUT)
+        return 0;
+
+    /* waiting on word with other value returns at once */
+    if(sys_futex_wait(&usem_lock.count, 5, 0) != ERR_FTX_WOULD_BLOCK)
+        return 0;
+
+    /* contended lock */
+    for(i = 0; i < USEM_THREADS; ++i) {
+        tid = sys_create_thread(usem_thread_func, NULL, false, 0);
+        if(tid == INVALID_THREADID)
+            return 0;
+    }
+
+    /* wait for threads completion */
+    for(i = 0; i < USEM_THREADS; ++i) {
+        if(usem_down_timeout(&usem_done, 5000) != NO_ERROR)
+            return 0;
+    }
+
+    return usem_counter == USEM_THREADS * USEM_LOOPS ? 1 : 0;
+}
@@ -7,6 +7,9 @@
 #include "tests.h"
 
 
+/* Count of hottest spinlocks reported after tests */
+#define TESTS_SPIN_STATS_COUNT  16
+
 /* Test descriptor */
 struct test_spec {
     const char *name;          /* Test name */
@@ -59,6 +62,60 @@ struct test_spec tests_table[] = {
         .func   = test6,
         .result = 0
     },
+    {
+        .name   = TEST7_NAME,
+        .skip   = 0,
+        .func   = test7,
+        .result = 0
+    },
+    {
+        .name   = TEST8_NAME,
+        .skip   = 0,
+        .func   = test8,
+        .result = 0
+    },
+    {
+        .name   = TEST9_NAME,
+        .skip   = 0,
+        .func   = test9,
+        .result = 0
+    },
+    {
+        .name   = TEST10_NAME,
+        .skip   = 0,
+        .func   = test10,
+        .result = 0
+    },
+    {
+        .name   = TEST11_NAME,
+        .skip   = 0,
+        .func   = test11,
+        .result = 0
+    },
+    {
+        .name   = TEST12_NAME,
+        .skip   = 0,
+        .func   = test12,
+        .result = 0
+    },
+    {
+        .name   = TEST13_NAME,
+        .skip   = 0,
+        .func   = test13,
+        .result = 0
+    },
+    {
+        .name   = TEST14_NAME,
+        .skip   = 0,
+        .func   = test14,
+        .result = 0
+    },
+    {
+        .name   = TEST15_NAME,
+        .skip   = 0,
+        .func   = test15,
+        .result = 0
+    },
 };
 const int nr_tests = sizeof(tests_table) / sizeof(tests_table[0]);
 
@@ -133,6 +190,9 @@ int main(int argc, char **argv)
     /* print summary */
     print_summary();
 
+    /* report hottest kernel spinlocks, if collected */
+    sys_spin_stats(TESTS_SPIN_STATS_COUNT, SYS_SPIN_STATS_RESET);
+
     /* report to init service */
     signal_completion();
 
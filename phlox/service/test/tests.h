@@ -27,5 +27,32 @@ extern int test5(void);
 #define TEST6_NAME "Virtual memory allocation stress test"
 extern int test6(void);
 
+#define TEST7_NAME "Thread execution time accounting"
+extern int test7(void);
+
+#define TEST8_NAME "Real-time scheduling class"
+extern int test8(void);
+
+#define TEST9_NAME "User space semaphore"
+extern int test9(void);
+
+#define TEST10_NAME "Condition variable and events"
+extern int test10(void);
+
+#define TEST11_NAME "Waiting for many semaphores"
+extern int test11(void);
+
+#define TEST12_NAME "Semaphore hand-off"
+extern int test12(void);
+
+#define TEST13_NAME "High-resolution clock and sleeps"
+extern int test13(void);
+
+#define TEST14_NAME "Shared time page"
+extern int test14(void);
+
+#define TEST15_NAME "Timer slack"
+extern int test15(void);
+
 
 #endif
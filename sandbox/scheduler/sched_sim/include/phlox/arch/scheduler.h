@@ -0,0 +1,32 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_ARCH_SCHEDULER_H_
+#define _PHLOX_ARCH_SCHEDULER_H_
+
+/*
+ * Scheduler simulator shim: host implementation of arch hooks.
+ */
+#include <phlox/types.h>
+#include <phlox/kargs.h>
+
+/* find index of most significant set bit in non-zero 32-bit word */
+#define arch_sched_find_msb(w)  (31 - __builtin_clz((uint32)(w)))
+
+static inline status_t arch_scheduler_init(kernel_args_t *kargs)
+{
+    (void)kargs;
+    return 0;
+}
+
+static inline status_t arch_scheduler_init_per_cpu(kernel_args_t *kargs, uint curr_cpu)
+{
+    (void)kargs; (void)curr_cpu;
+    return 0;
+}
+
+/* switches simulated cpu to another thread */
+void arch_sched_context_switch(struct thread *t_from, struct thread *t_to);
+
+#endif
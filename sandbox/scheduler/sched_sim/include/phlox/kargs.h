@@ -0,0 +1,15 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_KARGS_H_
+#define _PHLOX_KARGS_H_
+
+/*
+ * Scheduler simulator shim: kernel args are not used.
+ */
+typedef struct {
+    unsigned num_cpus;
+} kernel_args_t;
+
+#endif
@@ -0,0 +1,22 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_KERNEL_H_
+#define _PHLOX_KERNEL_H_
+
+/*
+ * Scheduler simulator shim: only macroses used by scheduler and lists.
+ */
+#include <phlox/ktypes.h>
+
+#define MIN(a, b)  ((a) < (b) ? (a) : (b))
+#define MAX(a, b)  ((a) > (b) ? (a) : (b))
+
+#define containerof(ptr, type, member) \
+    ((type *)((addr_t)(ptr) - offsetof(type, member)))
+
+/* prints message and aborts simulation */
+int panic(const char *fmt, ...);
+
+#endif
@@ -0,0 +1,15 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_KTYPES_H
+#define _PHLOX_KTYPES_H
+
+/*
+ * Scheduler simulator shim: addresses are host pointers.
+ */
+#include <phlox/types.h>
+
+typedef uintptr_t addr_t;
+
+#endif
@@ -0,0 +1,44 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_PROCESSOR_H_
+#define _PHLOX_PROCESSOR_H_
+
+/*
+ * Scheduler simulator shim: simulated processors.
+ */
+#include <phlox/ktypes.h>
+
+/* Bootstrap processor */
+#define BOOTSTRAP_CPU  0
+
+/* processor data */
+typedef struct {
+    uint  cpu_num;   /* processor number */
+} processor_t;
+
+/* processor set data */
+typedef struct {
+    uint         processors_num;               /* processors count */
+    processor_t  processors[SYSCFG_MAX_CPUS];  /* processors array */
+} processor_set_t;
+
+extern processor_set_t ProcessorSet;
+
+/* cpu currently stepped by simulator */
+extern uint sim_curr_cpu;
+
+static inline uint get_current_processor(void)
+{
+    return sim_curr_cpu;
+}
+
+/* simulated cpus are never interrupted in the middle of scheduler code */
+#define local_irqs_disable()    do { } while(0)
+#define local_irqs_enable()     do { } while(0)
+#define local_irqs_disabled()   (true)
+#define local_irqs_save_and_disable(flags) do { (flags) = 0; } while(0)
+#define local_irqs_restore(flags) do { (void)(flags); } while(0)
+
+#endif
@@ -0,0 +1,17 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_RCU_H_
+#define _PHLOX_RCU_H_
+
+/*
+ * Scheduler simulator shim: nothing is reclaimed in simulation,
+ * so quiescent states are not tracked.
+ */
+#include <phlox/types.h>
+
+/* note quiescent state of cpu */
+static inline void rcu_note_context_switch(uint cpu, bool idle) { }
+
+#endif
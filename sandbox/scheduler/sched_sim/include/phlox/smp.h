@@ -0,0 +1,20 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_SMP_H_
+#define _PHLOX_SMP_H_
+
+/*
+ * Scheduler simulator shim: inter-CPU interrupts are delivered
+ * when simulator steps target cpu next time.
+ */
+#include <phlox/types.h>
+
+/* returns true if simulated cpu exists */
+bool smp_cpu_is_active(uint cpu);
+
+/* request reschedule on cpu */
+void smp_send_reschedule(uint cpu);
+
+#endif
@@ -0,0 +1,59 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_SPINLOCK_H_
+#define _PHLOX_SPINLOCK_H_
+
+/*
+ * Scheduler simulator shim.
+ * Simulated cpus are stepped one by one on a single host thread,
+ * so locks only track state. Taking a held lock is a simulation bug.
+ */
+#include <phlox/kernel.h>
+
+typedef volatile int spinlock_t;
+
+static inline void spin_init(spinlock_t *lock)
+{
+    *lock = 0;
+}
+
+static inline bool spin_trylock(spinlock_t *lock)
+{
+    if(*lock)
+        return false;
+    *lock = 1;
+    return true;
+}
+
+static inline void spin_lock(spinlock_t *lock)
+{
+    if(*lock)
+        panic("spin_lock(): deadlock in simulation!\n");
+    *lock = 1;
+}
+
+static inline void spin_unlock(spinlock_t *lock)
+{
+    *lock = 0;
+}
+
+static inline int spin_locked(spinlock_t *lock)
+{
+    return *lock;
+}
+
+static inline unsigned long spin_lock_irqsave(spinlock_t *lock)
+{
+    spin_lock(lock);
+    return 0;
+}
+
+static inline void spin_unlock_irqrstor(spinlock_t *lock, unsigned long irqs_state)
+{
+    (void)irqs_state;
+    spin_unlock(lock);
+}
+
+#endif
@@ -0,0 +1,47 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_THREAD_H_
+#define _PHLOX_THREAD_H_
+
+/*
+ * Scheduler simulator shim: current thread of simulated cpu and
+ * thread locking.
+ */
+#include <phlox/types.h>
+#include <phlox/ktypes.h>
+#include <phlox/kargs.h>
+#include <phlox/thread_types.h>
+
+/* threads running on simulated cpus */
+extern thread_t *sim_curr_thread[SYSCFG_MAX_CPUS];
+
+static inline thread_t *thread_get_current_thread(void)
+{
+    return sim_curr_thread[ get_current_processor() ];
+}
+
+static inline bool thread_trylock_thread(thread_t *thread)
+{
+    return spin_trylock(&thread->lock);
+}
+
+static inline void thread_lock_thread(thread_t *thread)
+{
+    spin_lock(&thread->lock);
+}
+
+static inline void thread_unlock_thread(thread_t *thread)
+{
+    spin_unlock(&thread->lock);
+}
+
+static inline thread_t *thread_get_current_thread_locked(void)
+{
+    thread_t *thread = thread_get_current_thread();
+    thread_lock_thread(thread);
+    return thread;
+}
+
+#endif
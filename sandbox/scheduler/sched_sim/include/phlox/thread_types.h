@@ -0,0 +1,114 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_THREAD_TYPES_H_
+#define _PHLOX_THREAD_TYPES_H_
+
+/*
+ * Scheduler simulator shim: thread and process structures reduced
+ * to fields used by scheduler. Keep in sync with kernel's
+ * phlox/thread_types.h when scheduler starts using new fields.
+ */
+#include <phlox/ktypes.h>
+#include <phlox/list.h>
+#include <phlox/processor.h>
+#include <phlox/spinlock.h>
+
+
+/* Scheduling policy */
+typedef union {
+    struct {
+        uint type : 4;   /* Scheduling policy type */
+    } policy;            /* Scheduling policy structure */
+    uint raw;            /* Raw value of scheduling policy */
+} sched_policy_t;
+
+/* Scheduling policies names */
+enum {
+  SCHED_POLICY_ORDINARY = 0,
+  SCHED_POLICY_INTERACTIVE,
+  SCHED_POLICY_SERVICE,
+  SCHED_POLICY_REAL_TIME,
+  SCHED_POLICY_KERNEL,
+  SCHED_POLICY_HW_HANDLER,
+  SCHED_POLICY_INTERRUPT,
+  SCHED_POLICIES_COUNT
+};
+
+/* Process */
+typedef struct process {
+    proc_id  id;            /* Process id */
+    uint     flags;         /* Process flags */
+    uint     process_role;  /* Process role */
+} process_t;
+
+/* Thread */
+typedef struct thread {
+    thread_id        id;                 /* Thread id */
+    process_t        *process;           /* Owning process */
+    processor_t      *cpu;               /* CPU thread ran on last time */
+    spinlock_t       lock;               /* Access lock */
+    /* Thread state params */
+    int              state;              /* Thread state */
+    int              next_state;         /* Thread state after reschedule */
+    uint             flags;              /* Thread flags */
+    int              preempt_count;      /* Thread is not preempted while >0 */
+    /* Fields used by scheduler */
+    int              jiffies;            /* Current jiffies count */
+    int              ijiffies;           /* Initial jiffies count */
+    sched_policy_t   sched_policy;       /* Scheduling policy */
+    int              sched_class;        /* Scheduling class */
+    int              rt_prio;            /* Real-time priority */
+    int              s_prio;             /* Static priority */
+    int              d_prio;             /* Current dynamic priority */
+    int              sched_subqueue;     /* Priority subqueue index */
+    int              pi_prio;            /* Inherited priority, 0 if not inherited */
+    int              pi_locks;           /* Held priority inheriting locks count */
+    bigtime_t        sched_stamp;        /* Scheduler's timestamp */
+    int              carrots_sticks;     /* Carrots and Sticks Policy value */
+    list_elem_t      sched_list_node;    /* List node for execution scheduling */
+    /* Simulator data */
+    void             *data;              /* Workload thread data */
+} thread_t;
+
+/* Thread states */
+enum {
+  THREAD_STATE_READY = 0,
+  THREAD_STATE_BIRTH,
+  THREAD_STATE_DEATH,
+  THREAD_STATE_RUNNING,
+  THREAD_STATE_WAITING,
+  THREAD_STATE_SLEEPING,
+  THREAD_STATE_SUSPENDED,
+  THREAD_STATE_DEAD
+};
+
+/* Thread scheduling classes */
+enum {
+  THREAD_SCHED_NORMAL = 0,
+  THREAD_SCHED_FIFO,
+  THREAD_SCHED_RR
+};
+
+/* Thread flags */
+enum {
+  THREAD_FLAG_NONE        = 0x0,
+  THREAD_FLAG_RESCHEDULE  = 0x1
+};
+
+/* Process roles */
+enum {
+  PROCESS_ROLE_KERNEL = 0,
+  PROCESS_ROLE_SERVICE,
+  PROCESS_ROLE_USER,
+  PROCESS_ROLES_COUNT
+};
+
+/* Process flags */
+enum {
+  PROCESS_FLAG_NONE        = 0x0,
+  PROCESS_FLAG_INTERACTIVE = 0x1
+};
+
+#endif
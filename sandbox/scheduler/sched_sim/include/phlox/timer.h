@@ -0,0 +1,18 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_TIMER_H_
+#define _PHLOX_TIMER_H_
+
+/*
+ * Scheduler simulator shim: simulated cpus always tick.
+ */
+#include <phlox/types.h>
+
+static inline bool timer_idle_exit(void)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,40 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef _PHLOX_TYPES_H
+#define _PHLOX_TYPES_H
+
+/*
+ * Scheduler simulator shim: kernel types built on top of host types.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int8_t    int8;
+typedef int16_t   int16;
+typedef int32_t   int32;
+typedef int64_t   int64;
+typedef uint8_t   uint8;
+typedef uint16_t  uint16;
+typedef uint32_t  uint32;
+typedef uint64_t  uint64;
+
+typedef unsigned char   uchar;
+typedef unsigned short  ushort;
+typedef unsigned int    uint;
+typedef unsigned long   ulong;
+typedef volatile int    vint;
+typedef volatile unsigned int vuint;
+
+typedef int bool;
+#define false ((bool)0)
+#define true  ((bool)(-1))
+
+typedef int32  status_t;
+typedef uint32 flags_t;
+typedef int64  bigtime_t;
+typedef uint   thread_id;
+typedef uint   proc_id;
+
+#endif
@@ -0,0 +1,67 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "sim.h"
+
+/*
+ * Host-side scheduler simulator.
+ *
+ * Kernel's scheduler.c is built against simulator shims and driven
+ * by synthetic or recorded workloads. Scheduler tuning parameters
+ * may be changed at build time, for example:
+ *
+ *   make CFLAGS_EXTRA="-DSCHED_FACTOR_A=100 -DSCHED_QUEUE_BONUS_THRESHOLD2=3"
+ */
+
+static void usage(const char *prog)
+{
+    printf("usage: %s [-w workload | -f file] [-c cpus] [-t sec] [-s seed] [-l]\n", prog);
+    printf("  -w  built-in workload (default: mixed)\n");
+    printf("  -f  recorded workload file\n");
+    printf("  -c  simulated cpus count (default: 2)\n");
+    printf("  -t  simulated time in seconds (default: 10)\n");
+    printf("  -s  random seed (default: 1)\n");
+    printf("  -l  list built-in workloads\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *workload = "mixed";
+    const char *file = NULL;
+    uint ncpus = 2;
+    uint secs = 10;
+    uint seed = 1;
+    int opt;
+
+    while((opt = getopt(argc, argv, "w:f:c:t:s:lh")) != -1) {
+        switch(opt) {
+            case 'w': workload = optarg; break;
+            case 'f': file = optarg; break;
+            case 'c': ncpus = atoi(optarg); break;
+            case 't': secs = atoi(optarg); break;
+            case 's': seed = atoi(optarg); break;
+            case 'l': workload_list_builtin(); return 0;
+            default: usage(argv[0]); return 1;
+        }
+    }
+
+    if(!ncpus || ncpus > SYSCFG_MAX_CPUS || !secs) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    sim_srand(seed);
+    sim_init(ncpus);
+
+    if(file ? workload_load_file(file) : workload_load_builtin(workload))
+        return 1;
+
+    sim_run((bigtime_t)secs * 1000000);
+    sim_report();
+
+    return 0;
+}
@@ -0,0 +1,379 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <phlox/errors.h>
+#include <phlox/thread.h>
+#include <phlox/scheduler.h>
+#include <phlox/scheduler_private.h>
+#include "sim.h"
+
+
+/* kernel globals provided by simulator */
+processor_set_t ProcessorSet;
+uint sim_curr_cpu = BOOTSTRAP_CPU;
+thread_t *sim_curr_thread[SYSCFG_MAX_CPUS];
+
+/* simulation state */
+sim_t Sim;
+
+static thread_t idle_threads[SYSCFG_MAX_CPUS];
+static process_t kernel_process;
+static kernel_args_t kargs;
+
+
+/*** Kernel hooks ***/
+
+int panic(const char *fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "panic at %lld usec: ", (long long)Sim.now);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+
+    exit(2);
+    return 0;
+}
+
+bool smp_cpu_is_active(uint cpu)
+{
+    return cpu < Sim.ncpus;
+}
+
+void smp_send_reschedule(uint cpu)
+{
+    Sim.ici_pending[cpu] = true;
+}
+
+void arch_sched_context_switch(thread_t *t_from, thread_t *t_to)
+{
+    sim_thread_t *st = (sim_thread_t *)t_to->data;
+
+    if(t_from == t_to)
+        return;
+
+    Sim.switches++;
+    sim_curr_thread[sim_curr_cpu] = t_to;
+
+    /* thread woken up reaches cpu */
+    if(st && st->ready_at >= 0) {
+        if(Sim.latencies_num == Sim.latencies_max) {
+            Sim.latencies_max = Sim.latencies_max ? Sim.latencies_max * 2 : 4096;
+            Sim.latencies = realloc(Sim.latencies, Sim.latencies_max * sizeof(uint64));
+            if(!Sim.latencies)
+                panic("out of memory\n");
+        }
+        Sim.latencies[Sim.latencies_num++] = Sim.now - st->ready_at;
+        st->ready_at = -1;
+    }
+}
+
+
+/*** Thread operations on simulated cpus ***/
+
+/* make thread ready, current cpu acts as waker */
+static void sim_wake(sim_thread_t *st)
+{
+    thread_lock_thread(&st->th);
+    sched_add_thread(&st->th);
+    thread_unlock_thread(&st->th);
+
+    st->ready_at = Sim.now;
+}
+
+/* block current thread of current cpu */
+static void sim_block(int state)
+{
+    thread_t *th = thread_get_current_thread_locked();
+
+    th->next_state = state;
+    thread_unlock_thread(th);
+    sched_reschedule();
+}
+
+/* act like interrupt or syscall return path */
+static void sim_check_preempt(void)
+{
+    if(sched_need_resched())
+        sched_reschedule();
+}
+
+/* choose length of next burst */
+static void sim_next_burst(sim_thread_t *st)
+{
+    if(st->kind == SIM_KIND_REPLAY)
+        st->run_left = st->phases[st->phase][0];
+    else
+        st->run_left = sim_rand(st->run_min, st->run_max);
+
+    if(st->run_left <= 0)
+        st->run_left = SIM_STEP_USEC;
+}
+
+/* semaphore count up for ping-pong partner */
+static void sim_sem_up(sim_thread_t *st)
+{
+    if(st->th.state == THREAD_STATE_WAITING) {
+        /* partner takes token at once */
+        sim_next_burst(st);
+        sim_wake(st);
+    } else
+        st->tokens++;
+}
+
+/* start next burst of current thread. returns false if thread blocked. */
+static bool sim_begin_burst(sim_thread_t *st)
+{
+    if(st->kind == SIM_KIND_PINGPONG) {
+        if(!st->tokens) {
+            sim_block(THREAD_STATE_WAITING);
+            return false;
+        }
+        st->tokens--;
+    }
+
+    sim_next_burst(st);
+
+    return true;
+}
+
+/* current thread completed its burst */
+static void sim_end_burst(sim_thread_t *st)
+{
+    uint sleep = 0;
+
+    st->bursts++;
+    st->run_left = 0;
+
+    switch(st->kind) {
+        case SIM_KIND_INTERACTIVE:
+            sleep = sim_rand(st->sleep_min, st->sleep_max);
+            break;
+
+        case SIM_KIND_REPLAY:
+            sleep = st->phases[st->phase][1];
+            st->phase = (st->phase + 1) % st->phases_num;
+            break;
+
+        case SIM_KIND_PINGPONG:
+            /* pass token to partner and wait for reply */
+            sim_sem_up(st->peer);
+            sim_check_preempt();
+            if(thread_get_current_thread() == &st->th)
+                sim_begin_burst(st);
+            return;
+
+        default:
+            break;
+    }
+
+    if(sleep) {
+        /* sleeping thread is woken up by timer */
+        st->wake_at = Sim.now + sleep;
+        sim_block(THREAD_STATE_SLEEPING);
+    }
+}
+
+/* run current thread of cpu for one step */
+static void sim_execute(uint cpu)
+{
+    thread_t *th = sim_curr_thread[cpu];
+    sim_thread_t *st = (sim_thread_t *)th->data;
+
+    if(!st) {
+        Sim.idle_usec[cpu] += SIM_STEP_USEC;
+        return;
+    }
+
+    /* thread starts new burst */
+    if(st->run_left <= 0 && !sim_begin_burst(st)) {
+        Sim.idle_usec[cpu] += SIM_STEP_USEC;
+        return;
+    }
+
+    st->cpu_time += SIM_STEP_USEC;
+    st->run_left -= SIM_STEP_USEC;
+
+    if(st->run_left <= 0)
+        sim_end_burst(st);
+}
+
+/* timer interrupt on cpu */
+static void sim_timer_tick(uint cpu)
+{
+    bool resched;
+    uint i;
+
+    resched = scheduler_timer(1);
+
+    /* timer events are handled by bootstrap cpu */
+    if(cpu == BOOTSTRAP_CPU) {
+        for(i = 0; i < Sim.threads_num; i++) {
+            sim_thread_t *st = Sim.threads[i];
+            if(st->th.state == THREAD_STATE_SLEEPING && st->wake_at <= Sim.now)
+                sim_wake(st);
+        }
+    }
+
+    if(resched)
+        sched_reschedule();
+    else
+        sim_check_preempt();
+}
+
+
+/*** Public routines ***/
+
+/* init simulated system */
+void sim_init(uint ncpus)
+{
+    uint i;
+
+    memset(&Sim, 0, sizeof(Sim));
+    Sim.ncpus = ncpus;
+
+    ProcessorSet.processors_num = ncpus;
+    for(i = 0; i < ncpus; i++)
+        ProcessorSet.processors[i].cpu_num = i;
+
+    kargs.num_cpus = ncpus;
+    kernel_process.process_role = PROCESS_ROLE_KERNEL;
+
+    scheduler_init(&kargs);
+
+    for(i = 0; i < ncpus; i++) {
+        sim_curr_cpu = i;
+        scheduler_init_per_cpu(&kargs, i);
+
+        /* each cpu starts running its idle thread */
+        idle_threads[i].process = &kernel_process;
+        idle_threads[i].cpu = &ProcessorSet.processors[i];
+        sim_curr_thread[i] = &idle_threads[i];
+        sched_add_idle_thread(&idle_threads[i], i);
+    }
+
+    sim_curr_cpu = BOOTSTRAP_CPU;
+}
+
+/* add workload thread to scheduling */
+void sim_start_thread(sim_thread_t *st)
+{
+    if(Sim.threads_num == SIM_MAX_THREADS)
+        panic("too many threads\n");
+
+    Sim.threads[Sim.threads_num++] = st;
+
+    st->th.id = Sim.threads_num;
+    st->th.state = THREAD_STATE_BIRTH;
+    st->th.data = st;
+    st->ready_at = -1;
+
+    sim_curr_cpu = BOOTSTRAP_CPU;
+    sim_wake(st);
+}
+
+/* run simulation for a given time */
+void sim_run(bigtime_t usec)
+{
+    bigtime_t end = Sim.now + usec;
+    uint cpu;
+
+    for(; Sim.now < end; Sim.now += SIM_STEP_USEC) {
+        for(cpu = 0; cpu < Sim.ncpus; cpu++) {
+            sim_curr_cpu = cpu;
+
+            /* timer interrupt */
+            if(Sim.now % SIM_TICK_USEC == 0)
+                sim_timer_tick(cpu);
+
+            /* reschedule request from other cpu */
+            if(Sim.ici_pending[cpu]) {
+                Sim.ici_pending[cpu] = false;
+                sched_reschedule();
+            }
+
+            sim_execute(cpu);
+        }
+    }
+}
+
+static int latency_cmp(const void *a, const void *b)
+{
+    uint64 x = *(const uint64 *)a, y = *(const uint64 *)b;
+    return (x > y) - (x < y);
+}
+
+static uint64 latency_percentile(double p)
+{
+    uint idx;
+
+    if(!Sim.latencies_num)
+        return 0;
+
+    idx = (uint)(p * (Sim.latencies_num - 1) / 100.0 + 0.5);
+    return Sim.latencies[idx];
+}
+
+/* print simulation results */
+void sim_report(void)
+{
+    double secs = (double)Sim.now / 1000000.0;
+    uint64 idle = 0, busy = 0;
+    uint g, i;
+
+    for(i = 0; i < Sim.ncpus; i++)
+        idle += Sim.idle_usec[i];
+    for(i = 0; i < Sim.threads_num; i++)
+        busy += Sim.threads[i]->cpu_time;
+
+    printf("simulated %.2f sec on %u cpus, HZ=%d\n", secs, Sim.ncpus, HZ);
+    printf("parameters: quanta=%d/%d granularity=%d factor_a=%d factor_bthr=%d"
+           " factor_bmax=%d\n",
+           THREAD_DEFAULT_QUANTA, THREAD_MINIMUM_QUANTA, THREAD_QUANTA_GRANULARITY,
+           SCHED_FACTOR_A, SCHED_FACTOR_BTHR, SCHED_FACTOR_BMAX);
+    printf("utilization:        %6.2f %%\n",
+           100.0 * (1.0 - (double)idle / ((double)Sim.ncpus * Sim.now)));
+    printf("context switches:   %10.1f /sec\n", Sim.switches / secs);
+
+    /* per group throughput and fairness */
+    printf("\n%-12s %7s %5s %8s %12s %9s\n",
+           "group", "threads", "prio", "cpu %", "bursts/sec", "fairness");
+    for(g = 0; g < Sim.groups_num; g++) {
+        double sum = 0.0, sum_sq = 0.0;
+        uint64 bursts = 0;
+        uint n = 0;
+
+        for(i = 0; i < Sim.threads_num; i++) {
+            sim_thread_t *st = Sim.threads[i];
+            if(st->group != g)
+                continue;
+            sum += (double)st->cpu_time;
+            sum_sq += (double)st->cpu_time * (double)st->cpu_time;
+            bursts += st->bursts;
+            n++;
+        }
+
+        /* Jain's fairness index of cpu time within group */
+        printf("%-12s %7u %5u %8.2f %12.1f %9.3f\n",
+               Sim.groups[g].name, n, Sim.groups[g].prio,
+               busy ? 100.0 * sum / busy : 0.0,
+               bursts / secs,
+               sum_sq > 0.0 ? (sum * sum) / (n * sum_sq) : 1.0);
+    }
+
+    /* wakeup latency */
+    qsort(Sim.latencies, Sim.latencies_num, sizeof(uint64), latency_cmp);
+    printf("\nwakeup latency (usec, %u samples):\n", Sim.latencies_num);
+    printf("  p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu\n",
+           (unsigned long long)latency_percentile(50.0),
+           (unsigned long long)latency_percentile(90.0),
+           (unsigned long long)latency_percentile(99.0),
+           (unsigned long long)latency_percentile(99.9),
+           (unsigned long long)latency_percentile(100.0));
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <phlox/thread.h>
+#include <phlox/param.h>
+
+/* simulation step and timer tick lengths (usec) */
+#define SIM_STEP_USEC   10
+#define SIM_TICK_USEC   (1000000 / HZ)
+
+/* limits */
+#define SIM_MAX_THREADS  1024
+#define SIM_MAX_GROUPS   16
+#define SIM_MAX_PHASES   64
+
+/* workload thread kinds */
+enum {
+    SIM_KIND_CPU = 0,     /* never blocks */
+    SIM_KIND_INTERACTIVE, /* short bursts, then sleeps */
+    SIM_KIND_PINGPONG,    /* pairs passing token through semaphore */
+    SIM_KIND_REPLAY       /* recorded run/sleep sequence */
+};
+
+/* workload thread */
+typedef struct sim_thread {
+    thread_t           th;          /* scheduler's view of thread */
+    int                kind;        /* workload kind */
+    uint               group;       /* workload group index */
+    uint               run_min;     /* burst length range (usec) */
+    uint               run_max;
+    uint               sleep_min;   /* sleep length range (usec) */
+    uint               sleep_max;
+    uint               phases_num;  /* recorded run/sleep pairs */
+    uint               phase;
+    uint               phases[SIM_MAX_PHASES][2];
+    struct sim_thread  *peer;       /* ping-pong partner */
+    uint               tokens;      /* pending semaphore count */
+    bigtime_t          run_left;    /* usec left in current burst */
+    bigtime_t          wake_at;     /* wake up time for sleeping thread */
+    bigtime_t          ready_at;    /* time thread became ready or -1 */
+    /* statistics */
+    bigtime_t          cpu_time;    /* consumed cpu time (usec) */
+    uint               bursts;      /* completed bursts */
+} sim_thread_t;
+
+/* workload group, one line of workload description */
+typedef struct {
+    char  name[32];   /* group kind name */
+    int   kind;       /* workload kind */
+    uint  count;      /* threads count */
+    uint  prio;       /* static priority */
+    int   sched_class;
+    uint  rt_prio;
+    process_t proc;   /* process owning group threads */
+} sim_group_t;
+
+/* simulation state */
+typedef struct {
+    uint          ncpus;
+    bigtime_t     now;                            /* current time (usec) */
+    sim_thread_t  *threads[SIM_MAX_THREADS];
+    uint          threads_num;
+    sim_group_t   groups[SIM_MAX_GROUPS];
+    uint          groups_num;
+    bool          ici_pending[SYSCFG_MAX_CPUS];   /* reschedule requests */
+    /* statistics */
+    uint64        switches;                       /* context switches */
+    uint64        idle_usec[SYSCFG_MAX_CPUS];     /* idle time per cpu */
+    uint64        *latencies;                     /* wakeup latencies */
+    uint          latencies_num;
+    uint          latencies_max;
+} sim_t;
+
+extern sim_t Sim;
+
+/* simulator */
+void sim_init(uint ncpus);
+void sim_start_thread(sim_thread_t *st);
+void sim_run(bigtime_t usec);
+void sim_report(void);
+
+/* workloads */
+int workload_load_builtin(const char *name);
+int workload_load_file(const char *path);
+void workload_list_builtin(void);
+void sim_srand(uint seed);
+uint sim_rand(uint min, uint max);
+
+#endif
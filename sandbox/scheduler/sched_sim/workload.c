@@ -0,0 +1,282 @@
+/*
+* Copyright 2007-2013, Stepan V.Karpenko. All rights reserved.
+* Distributed under the terms of the PhloxOS License.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <phlox/kargs.h>
+#include <phlox/thread.h>
+#include <phlox/thread_private.h>
+#include "sim.h"
+
+/*
+ * Workload description is a text, one threads group per line:
+ *
+ *   <kind> <count> <prio> <class> <params...>
+ *
+ * kind    - cpu, interactive, pingpong or replay;
+ * count   - threads count (pairs count for pingpong);
+ * prio    - static priority;
+ * class   - normal, fifo:<rt_prio> or rr:<rt_prio>;
+ * params  - cpu:         <run_min> <run_max>
+ *           interactive: <run_min> <run_max> <sleep_min> <sleep_max>
+ *           pingpong:    <run_min> <run_max>
+ *           replay:      <run>:<sleep> <run>:<sleep> ...
+ *
+ * All times are in microseconds. Replay lines hold run/sleep
+ * sequences recorded on real system, thread cycles through them.
+ * Empty lines and lines starting with '#' are ignored.
+ */
+
+/* built-in synthetic workloads */
+static const struct {
+    const char *name;
+    const char *text;
+} builtin_workloads[] = {
+    { "cpu",
+      "cpu          8 56 normal 10000 10000\n" },
+    { "interactive",
+      "interactive 16 56 normal 200 2000 5000 50000\n" },
+    { "pingpong",
+      "pingpong     4 56 normal 20 200\n" },
+    { "mixed",
+      "cpu          4 56 normal 10000 10000\n"
+      "interactive  8 56 normal 200 2000 5000 50000\n"
+      "pingpong     2 56 normal 20 200\n" },
+    { "realtime",
+      "cpu          4 56 normal 10000 10000\n"
+      "interactive  2 56 fifo:10 100 300 2000 2000\n"
+      "pingpong     1 56 rr:5 20 200\n" },
+};
+
+#define BUILTIN_COUNT (sizeof(builtin_workloads) / sizeof(builtin_workloads[0]))
+
+/* simulator random numbers are reproducible with same seed */
+static uint64 rand_state = 88172645463325252ULL;
+
+void sim_srand(uint seed)
+{
+    rand_state = 88172645463325252ULL ^ seed;
+    if(!rand_state)
+        rand_state = 1;
+}
+
+uint sim_rand(uint min, uint max)
+{
+    /* xorshift64 */
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 7;
+    rand_state ^= rand_state << 17;
+
+    if(max <= min)
+        return min;
+
+    return min + (uint)(rand_state % (max - min + 1));
+}
+
+/* parse scheduling class */
+static int parse_class(const char *str, sim_group_t *g)
+{
+    if(!strcmp(str, "normal")) {
+        g->sched_class = THREAD_SCHED_NORMAL;
+        return 0;
+    } else if(!strncmp(str, "fifo:", 5)) {
+        g->sched_class = THREAD_SCHED_FIFO;
+        g->rt_prio = atoi(str + 5);
+    } else if(!strncmp(str, "rr:", 3)) {
+        g->sched_class = THREAD_SCHED_RR;
+        g->rt_prio = atoi(str + 3);
+    } else
+        return -1;
+
+    return (g->rt_prio < THREAD_NUM_RT_PRIORITY_LEVELS) ? 0 : -1;
+}
+
+/* allocate thread for group */
+static sim_thread_t *new_thread(sim_group_t *g, uint group)
+{
+    sim_thread_t *st = calloc(1, sizeof(sim_thread_t));
+    if(!st)
+        panic("out of memory\n");
+
+    st->kind = g->kind;
+    st->group = group;
+    st->th.process = &g->proc;
+    st->th.s_prio = g->prio;
+    st->th.sched_policy.raw = SCHED_POLICY_ORDINARY;
+    st->th.sched_class = g->sched_class;
+    st->th.rt_prio = g->rt_prio;
+
+    return st;
+}
+
+/* parse one line of workload description */
+static int parse_line(char *line, int lineno)
+{
+    char *argv[2 + SIM_MAX_PHASES + 4];
+    uint argc = 0, i, n;
+    uint params[4] = { 0, 0, 0, 0 };
+    sim_group_t *g;
+    char *tok;
+
+    for(tok = strtok(line, " \t\r\n"); tok && argc < sizeof(argv)/sizeof(argv[0]);
+        tok = strtok(NULL, " \t\r\n"))
+        argv[argc++] = tok;
+
+    /* skip empty lines and comments */
+    if(!argc || argv[0][0] == '#')
+        return 0;
+
+    if(argc < 4 || Sim.groups_num == SIM_MAX_GROUPS)
+        goto error;
+
+    g = &Sim.groups[Sim.groups_num];
+    memset(g, 0, sizeof(*g));
+    snprintf(g->name, sizeof(g->name), "%s", argv[0]);
+    g->count = atoi(argv[1]);
+    g->prio = atoi(argv[2]);
+    g->proc.id = Sim.groups_num + 1;
+    g->proc.process_role = PROCESS_ROLE_USER;
+
+    if(!g->count || g->prio >= THREAD_NUM_PRIORITY_LEVELS || parse_class(argv[3], g))
+        goto error;
+
+    if(!strcmp(argv[0], "cpu"))
+        g->kind = SIM_KIND_CPU;
+    else if(!strcmp(argv[0], "interactive"))
+        g->kind = SIM_KIND_INTERACTIVE;
+    else if(!strcmp(argv[0], "pingpong"))
+        g->kind = SIM_KIND_PINGPONG;
+    else if(!strcmp(argv[0], "replay"))
+        g->kind = SIM_KIND_REPLAY;
+    else
+        goto error;
+
+    if(g->kind != SIM_KIND_REPLAY) {
+        for(i = 4; i < argc && i < 8; i++)
+            params[i-4] = atoi(argv[i]);
+        if(!params[0])
+            goto error;
+        if(params[1] < params[0])
+            params[1] = params[0];
+        if(params[3] < params[2])
+            params[3] = params[2];
+    } else if(argc < 5)
+        goto error;
+
+    Sim.groups_num++;
+
+    for(n = 0; n < g->count; n++) {
+        sim_thread_t *st = new_thread(g, Sim.groups_num - 1);
+
+        st->run_min = params[0];
+        st->run_max = params[1];
+        st->sleep_min = params[2];
+        st->sleep_max = params[3];
+
+        if(g->kind == SIM_KIND_REPLAY) {
+            for(i = 4; i < argc && st->phases_num < SIM_MAX_PHASES; i++) {
+                uint run = 0, sleep = 0;
+                if(sscanf(argv[i], "%u:%u", &run, &sleep) < 1 || !run) {
+                    free(st);
+                    goto error;
+                }
+                st->phases[st->phases_num][0] = run;
+                st->phases[st->phases_num][1] = sleep;
+                st->phases_num++;
+            }
+        }
+
+        if(g->kind == SIM_KIND_PINGPONG) {
+            /* partner starts waiting for token */
+            sim_thread_t *peer = new_thread(g, Sim.groups_num - 1);
+
+            *peer = *st;
+            st->peer = peer;
+            peer->peer = st;
+            st->tokens = 1;
+
+            sim_start_thread(st);
+            sim_start_thread(peer);
+        } else
+            sim_start_thread(st);
+    }
+
+    return 0;
+
+error:
+    fprintf(stderr, "workload: error at line %d\n", lineno);
+    return -1;
+}
+
+/* parse workload text */
+static int parse_text(const char *text)
+{
+    char line[1024];
+    const char *p = text;
+    int lineno = 0;
+
+    while(*p) {
+        size_t len = strcspn(p, "\n");
+        if(len >= sizeof(line))
+            len = sizeof(line) - 1;
+        memcpy(line, p, len);
+        line[len] = 0;
+        p += len;
+        if(*p == '\n') p++;
+
+        if(parse_line(line, ++lineno))
+            return -1;
+    }
+
+    return 0;
+}
+
+/* load one of built-in workloads */
+int workload_load_builtin(const char *name)
+{
+    uint i;
+
+    for(i = 0; i < BUILTIN_COUNT; i++) {
+        if(!strcmp(builtin_workloads[i].name, name))
+            return parse_text(builtin_workloads[i].text);
+    }
+
+    fprintf(stderr, "workload: unknown workload '%s'\n", name);
+    return -1;
+}
+
+/* load recorded workload from file */
+int workload_load_file(const char *path)
+{
+    char line[4096];
+    int lineno = 0;
+    FILE *f;
+
+    f = fopen(path, "r");
+    if(!f) {
+        perror(path);
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), f)) {
+        if(parse_line(line, ++lineno)) {
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+
+    return 0;
+}
+
+/* print built-in workloads */
+void workload_list_builtin(void)
+{
+    uint i;
+
+    for(i = 0; i < BUILTIN_COUNT; i++)
+        printf("%s:\n%s\n", builtin_workloads[i].name, builtin_workloads[i].text);
+}